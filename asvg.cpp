@@ -1,51 +1,345 @@
 #include "asvg.hpp"
 #include "lunasvg.h"
+#include "profiler.hpp"
 #include <charconv>
-#include "glew.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <utility>
 
 namespace asvg {
 
-svg_instance::~svg_instance() noexcept {
-	if(texture_handle != 0) {
-		glDeleteTextures(1, &texture_handle);
-		texture_handle = 0;
+namespace {
+
+struct replacement_scales {
+	float x_scale = 1.0f;
+	float y_scale = 1.0f;
+	float s_scale = 1.0f;
+	float l_scale = 1.0f;
+	float d_scale = 1.0f;
+	float p_scale = 1.0f;
+
+	replacement_scales(float size_x, float size_y, int32_t grid_size, int32_t base_width, int32_t base_height) {
+		x_scale = float(size_x * 500.0f) / float(base_width);
+		y_scale = float(size_y * 500.0f) / float(base_height);
+		s_scale = std::min(x_scale, y_scale);
+		l_scale = std::max(x_scale, y_scale);
+		d_scale = std::sqrt(x_scale * x_scale + y_scale * y_scale);
+		p_scale = 500.0f / float(grid_size);
 	}
+	float resolve(affine_replacement const& r) const {
+		float chosen_scale = x_scale;
+		switch(r.dimension) {
+			case dimension_relative::height: chosen_scale = y_scale; break;
+			case dimension_relative::width: chosen_scale = x_scale; break;
+			case dimension_relative::smaller: chosen_scale = s_scale; break;
+			case dimension_relative::larger: chosen_scale = l_scale; break;
+			case dimension_relative::diagonal: chosen_scale = d_scale; break;
+			case dimension_relative::pixel: chosen_scale = p_scale; break;
+		}
+		return chosen_scale * r.scale + r.offset;
+	}
+};
+
+// overwrites the whole marker, padding the number with spaces
+void write_replacement(char* destination, affine_replacement const& r, float value) {
+	char temp_buffer[128] = { 0 };
+	if(!r.emit_quotes) {
+		auto result = std::to_chars(temp_buffer, temp_buffer + 128, value);
+		memset(result.ptr, ' ', size_t((temp_buffer + 128) - result.ptr));
+		memcpy(destination, temp_buffer, size_t(std::min(r.end_position - r.start_position, uint32_t(128))));
+	} else {
+		auto result = std::to_chars(temp_buffer + 1, temp_buffer + 126, value);
+		memset(result.ptr, ' ', size_t((temp_buffer + 128) - result.ptr));
+		*result.ptr = '\"';
+		temp_buffer[0] = '\"';
+		memcpy(destination, temp_buffer, size_t(std::min(r.end_position - r.start_position, uint32_t(128))));
+	}
+}
+
+}
+
+std::string color_stylesheet(float r, float g, float b) {
+	return color_stylesheet(pack_render_color(r, g, b));
+}
+
+std::string color_stylesheet(uint32_t color) {
+	char cssstylesheet[] = ".primarycolor { fill: #000000; stroke: #000000; } ";
+	auto const clroffset = strlen(".primarycolor { fill: #");
+	auto const clroffset2 = strlen(".primarycolor { fill: #000000; stroke: #");
+	auto tohexdigit = [](uint32_t v) {
+		char table[] = "0123456789abcdef";
+		return table[v & 0x0F];
+	};
+	auto rv = color & 0xFF;
+	cssstylesheet[clroffset] = cssstylesheet[clroffset2] = tohexdigit(rv >> 4);
+	cssstylesheet[clroffset + 1] = cssstylesheet[clroffset2 + 1] = tohexdigit(rv);
+	auto gv = (color >> 8) & 0xFF;
+	cssstylesheet[clroffset + 2] = cssstylesheet[clroffset2 + 2] = tohexdigit(gv >> 4);
+	cssstylesheet[clroffset + 3] = cssstylesheet[clroffset2 + 3] = tohexdigit(gv);
+	auto bv = (color >> 16) & 0xFF;
+	cssstylesheet[clroffset + 4] = cssstylesheet[clroffset2 + 4] = tohexdigit(bv >> 4);
+	cssstylesheet[clroffset + 5] = cssstylesheet[clroffset2 + 5] = tohexdigit(bv);
+	return std::string(cssstylesheet);
+}
+
+primarycolor_use find_primarycolor_use(char const* data, size_t count) {
+	std::string_view text(data, count);
+	if(text.find("primarycolor") == std::string_view::npos)
+		return primarycolor_use::none;
+	// a mask turns the color into coverage; rather than working out what the mask contains, any mask rules out blending
+	if(text.find("<mask") != std::string_view::npos)
+		return primarycolor_use::direct;
+	return primarycolor_use::tinted;
+}
+
+lunasvg::Bitmap blend_tint(tint_layers const& layers, uint32_t color) {
+	if(layers.black.isNull() || layers.white.isNull())
+		return lunasvg::Bitmap{ };
+
+	profiler::scoped_zone zone("blend_tint");
+	auto width = layers.black.width();
+	auto height = layers.black.height();
+	lunasvg::Bitmap result(width, height);
+	// the pixels are premultiplied ARGB words, so the channels are in b, g, r, a order in memory; alpha does not depend on the color
+	int32_t const weights[4] = { int32_t((color >> 16) & 0xFF), int32_t((color >> 8) & 0xFF), int32_t(color & 0xFF), 0 };
+	for(int32_t y = 0; y < height; ++y) {
+		auto black = layers.black.data() + size_t(y) * size_t(layers.black.stride());
+		auto white = layers.white.data() + size_t(y) * size_t(layers.white.stride());
+		auto out = result.data() + size_t(y) * size_t(result.stride());
+		for(int32_t i = 0; i < width * 4; ++i) {
+			auto low = int32_t(black[i]);
+			out[i] = uint8_t(low + ((int32_t(white[i]) - low) * weights[i & 3] + 127) / 255);
+		}
+	}
+	return result;
+}
+
+namespace {
+
+bool same_column(lunasvg::Bitmap const& a, int32_t a_x, lunasvg::Bitmap const& b, int32_t b_x) {
+	for(int32_t y = 0; y < a.height(); ++y) {
+		if(std::memcmp(a.data() + size_t(y) * size_t(a.stride()) + size_t(a_x) * 4, b.data() + size_t(y) * size_t(b.stride()) + size_t(b_x) * 4, 4) != 0)
+			return false;
+	}
+	return true;
+}
+
+bool same_row(lunasvg::Bitmap const& a, int32_t a_y, lunasvg::Bitmap const& b, int32_t b_y) {
+	return std::memcmp(a.data() + size_t(a_y) * size_t(a.stride()), b.data() + size_t(b_y) * size_t(b.stride()), size_t(a.width()) * 4) == 0;
+}
+
+}
+
+stretch_slices find_stretch_slices(lunasvg::Bitmap const& probe) {
+	stretch_slices result;
+	if(probe.isNull())
+		return result;
+
+	profiler::scoped_zone zone("find_stretch_slices");
+	auto width = probe.width();
+	auto height = probe.height();
+	// the longest runs of identical columns and rows through the middle are what gets stretched
+	auto first_column = width / 2;
+	auto end_column = first_column + 1;
+	while(first_column > 0 && same_column(probe, first_column - 1, probe, first_column))
+		--first_column;
+	while(end_column < width && same_column(probe, end_column, probe, end_column - 1))
+		++end_column;
+	auto first_row = height / 2;
+	auto end_row = first_row + 1;
+	while(first_row > 0 && same_row(probe, first_row - 1, probe, first_row))
+		--first_row;
+	while(end_row < height && same_row(probe, end_row, probe, end_row - 1))
+		++end_row;
+
+	result.stretchable = true;
+	result.left = first_column;
+	result.top = first_row;
+	result.right = width - end_column;
+	result.bottom = height - end_row;
+	return result;
+}
+
+bool stretches_to(lunasvg::Bitmap const& probe, stretch_slices const& slices, lunasvg::Bitmap const& other) {
+	if(!slices.stretchable || probe.isNull() || other.isNull())
+		return false;
+	if(other.width() <= slices.left + slices.right || other.height() <= slices.top + slices.bottom)
+		return false;
+
+	profiler::scoped_zone zone("stretches_to");
+	for(int32_t y = 0; y < other.height(); ++y) {
+		auto from_y = y < slices.top ? y : (y >= other.height() - slices.bottom ? y - other.height() + probe.height() : slices.top);
+		auto row = other.data() + size_t(y) * size_t(other.stride());
+		auto probe_row = probe.data() + size_t(from_y) * size_t(probe.stride());
+		// the left border, the middle strip and the right border
+		if(std::memcmp(row, probe_row, size_t(slices.left) * 4) != 0)
+			return false;
+		for(int32_t x = slices.left; x < other.width() - slices.right; ++x) {
+			if(std::memcmp(row + size_t(x) * 4, probe_row + size_t(slices.left) * 4, 4) != 0)
+				return false;
+		}
+		if(std::memcmp(row + size_t(other.width() - slices.right) * 4, probe_row + size_t(probe.width() - slices.right) * 4, size_t(slices.right) * 4) != 0)
+			return false;
+	}
+	return true;
+}
+
+tint_cache common_tint_cache::cache{ };
+
+namespace {
+
+constexpr uint32_t black_color = 0;
+constexpr uint32_t white_color = 0xFFFFFF;
+
+size_t bitmap_bytes(lunasvg::Bitmap const& bitmap) {
+	return bitmap.isNull() ? size_t(0) : size_t(bitmap.stride()) * size_t(bitmap.height());
+}
+
+}
+
+std::optional<lunasvg::Bitmap> tint_cache::find(std::shared_ptr<void const> const& owner, render_key const& key) {
+	texture_cache::cache_key id{ owner.get(), key };
+	id.key.color = 0;
+	std::shared_ptr<tint_layers const> layers;
+	{
+		std::lock_guard lock(guard);
+		auto it = entries.find(id);
+		if(it == entries.end() || it->second.owner.expired() || !it->second.layers.valid())
+			return std::nullopt;
+		if(it->second.layers.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return std::nullopt;
+		it->second.last_use = ++use_clock;
+		layers = it->second.layers.get();
+	}
+	return blend_tint(*layers, key.color);
 }
 
-svg_instance::svg_instance(char const* bytes, int32_t sx, int32_t sy) {
-	glGenTextures(1, &texture_handle);
-	if(texture_handle) {
-		glBindTexture(GL_TEXTURE_2D, texture_handle);
-		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, sx, sy);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, sx, sy, GL_RGBA, GL_UNSIGNED_BYTE, bytes);
+lunasvg::Bitmap tint_cache::render(std::shared_ptr<void const> const& owner, render_key const& key, std::function<lunasvg::Bitmap(uint32_t)> const& render) {
+	texture_cache::cache_key id{ owner.get(), key };
+	id.key.color = 0;
+
+	std::unique_lock lock(guard);
+	if(byte_budget == 0) {
+		lock.unlock();
+		return render(key.color);
+	}
+	auto it = entries.find(id);
+	if(it != entries.end() && it->second.owner.expired()) { // a dead owner whose address has been reused
+		bytes_used -= it->second.bytes;
+		entries.erase(it);
+		it = entries.end();
+	}
+
+	if(it == entries.end()) {
+		auto& e = entries[id];
+		e.owner = owner;
+		e.first_color = key.color;
+		e.last_use = ++use_clock;
+		trim();
+		lock.unlock();
+
+		auto bmp = render(key.color);
+		if(key.color != black_color && key.color != white_color)
+			return bmp;
+		lock.lock();
+		// the entry may have been dropped, or moved on to its layers, while the render was being made
+		if(auto again = entries.find(id); again != entries.end() && !again->second.layers.valid() && again->second.first_color == key.color && again->second.first_render.isNull()) {
+			again->second.first_render = bmp;
+			again->second.bytes = bitmap_bytes(bmp);
+			bytes_used += again->second.bytes;
+			trim();
+		}
+		return bmp;
+	}
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	auto& e = it->second;
+	e.last_use = ++use_clock;
+	if(e.layers.valid()) {
+		auto layers = e.layers;
+		lock.unlock();
+		return blend_tint(*layers.get(), key.color);
+	}
+	if(e.first_color == key.color) { // the same color again, after its texture was evicted
+		lock.unlock();
+		return render(key.color);
+	}
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+	// a second color: make the layers, which every later color is blended from
+	std::promise<std::shared_ptr<tint_layers const>> made;
+	e.layers = made.get_future().share();
+	auto first_color = e.first_color;
+	auto first_render = std::move(e.first_render);
+	e.first_render = lunasvg::Bitmap{ };
+	bytes_used -= e.bytes;
+	e.bytes = 0;
+	lock.unlock();
+
+	auto layers = std::make_shared<tint_layers>();
+	{
+		profiler::scoped_zone zone("tint_cache::make_layers");
+		layers->black = first_color == black_color && !first_render.isNull() ? first_render : render(black_color);
+		layers->white = first_color == white_color && !first_render.isNull() ? first_render : render(white_color);
+	}
+	auto bytes = bitmap_bytes(layers->black) + bitmap_bytes(layers->white);
+	made.set_value(layers);
+
+	lock.lock();
+	if(auto again = entries.find(id); again != entries.end() && again->second.bytes == 0 && again->second.layers.valid()
+		&& again->second.layers.wait_for(std::chrono::seconds(0)) == std::future_status::ready && again->second.layers.get() == layers) {
+		again->second.bytes = bytes;
+		bytes_used += bytes;
+		trim();
 	}
+	lock.unlock();
+	return blend_tint(*layers, key.color);
 }
 
-svg_instance::svg_instance(svg_instance&& other) noexcept {
-	if(texture_handle != 0) {
-		glDeleteTextures(1, &texture_handle);
+void tint_cache::release_owner(void const* owner) {
+	std::lock_guard lock(guard);
+	for(auto it = entries.begin(); it != entries.end(); ) {
+		if(it->first.owner == owner) {
+			bytes_used -= it->second.bytes;
+			it = entries.erase(it);
+		} else {
+			++it;
+		}
 	}
-	texture_handle = other.texture_handle;
-	other.texture_handle = 0;
 }
 
-svg_instance& svg_instance::operator=(svg_instance&& other) noexcept {
-	if(texture_handle != 0) {
-		glDeleteTextures(1, &texture_handle);
+void tint_cache::set_budget(size_t bytes) {
+	std::lock_guard lock(guard);
+	byte_budget = bytes;
+	trim();
+}
+
+void tint_cache::clear() {
+	std::lock_guard lock(guard);
+	entries.clear();
+	bytes_used = 0;
+}
+
+void tint_cache::trim() {
+	// layers still being made stay, since their maker fills the entry in once they are done
+	auto in_progress = [](entry const& e) {
+		return e.layers.valid() && e.layers.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+	};
+	while(bytes_used > byte_budget || entries.size() > max_entries) {
+		auto oldest = entries.end();
+		for(auto it = entries.begin(); it != entries.end(); ++it) {
+			if(!in_progress(it->second) && (oldest == entries.end() || it->second.last_use < oldest->second.last_use))
+				oldest = it;
+		}
+		if(oldest == entries.end())
+			break;
+		bytes_used -= oldest->second.bytes;
+		entries.erase(oldest);
 	}
-	texture_handle = other.texture_handle;
-	other.texture_handle = 0;
-	return *this;
 }
 
-svg::svg(char const* data, size_t count, int32_t base_width, int32_t base_height) : svg_data(data, data+count), base_width(base_width), base_height(base_height) {
+svg_source::svg_source(char const* data, size_t count, int32_t base_width, int32_t base_height) : svg_data(data, data+count), revision(next_document_revision()), primarycolor(find_primarycolor_use(data, count)), dependencies_checked(common_file_bank::bank.change_count.load()) {
 	for(size_t i = 0; i < count; ++i) {
 		if(svg_data[i] == '[' && i + 1 < count && svg_data[i + 1] == '[') {
 			affine_replacement new_rep{ };
@@ -139,197 +433,539 @@ svg::svg(char const* data, size_t count, int32_t base_width, int32_t base_height
 			}
 		}
 	}
-}
-
-void svg::release_renders() {
-	renders.clear();
-}
 
-uint32_t svg::get_render(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
-	uint64_t colorid = uint64_t(r * 255.0f) | (uint64_t(g * 255.0f) << uint64_t(8)) | (uint64_t(b * 255.0f) << uint64_t(16));
-	uint64_t idx = uint64_t(uint32_t(size_x * grid_size)) | (uint64_t(uint32_t(size_y * grid_size)) << uint64_t(20)) | (colorid << 40);
+	separable_replacements = std::all_of(replacements.begin(), replacements.end(), [](affine_replacement const& r) {
+		return r.dimension == dimension_relative::width || r.dimension == dimension_relative::height || r.dimension == dimension_relative::pixel;
+	});
 
-	if(auto it = renders.find(idx); it != renders.end()) {
-		return it->second.texture_handle;
-	}
-	return make_new_render(size_x, size_y, grid_size, scale);
+	build_template(base_width, base_height);
 }
-uint32_t svg::try_get_render(float size_x, float size_y, int32_t grid_size, float r, float g, float b) {
-	uint64_t colorid = uint64_t(r * 255.0f) | (uint64_t(g * 255.0f) << uint64_t(8)) | (uint64_t(b * 255.0f) << uint64_t(16));
-	uint64_t idx = uint64_t(uint32_t(size_x * grid_size)) | (uint64_t(uint32_t(size_y * grid_size)) << uint64_t(20)) | (colorid << 40);
 
-	if(auto it = renders.find(idx); it != renders.end()) {
-		return it->second.texture_handle;
+void svg_source::build_template(int32_t base_width, int32_t base_height) {
+	templated = false;
+	idle_templates.clear();
+	// copies still out with a render are dropped when they come back
+	++template_generation;
+	{
+		std::lock_guard dependencies_lock(dependencies_guard);
+		dependencies.clear();
 	}
-	return 0;
-}
-uint32_t svg::make_new_render(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
+
 	if(svg_data.size() == 0)
-		return 0;
+		return;
 
-	char temp_buffer[128] = { 0 };
+	// any values will do for the initial parse; every render overwrites them
+	replacement_scales scales(float(base_width) / 500.0f, float(base_height) / 500.0f, 1, base_width, base_height);
+	for(auto& rep : replacements) {
+		write_replacement(svg_data.data() + rep.start_position, rep, scales.resolve(rep));
+	}
 
-	float x_scale = float(size_x * 500.0f) / float(base_width);
-	float y_scale = float(size_y * 500.0f) / float(base_height);
-	float s_scale = std::min(x_scale, y_scale);
-	float l_scale = std::max(x_scale, y_scale);
-	float d_scale = std::sqrt(x_scale * x_scale + y_scale * y_scale);
-	float p_scale = 500.0f / float(grid_size);
+	auto copy = parse_template(svg_data);
+	if(!copy)
+		return;
+	copy->generation = template_generation;
+	idle_templates.push_back(std::move(copy));
+	templated = true;
+}
 
-	for(auto& r : replacements) {
-		float chosen_scale = x_scale;
-		switch(r.dimension) {
-			case dimension_relative::height: chosen_scale = y_scale; break;
-			case dimension_relative::width: chosen_scale = x_scale; break;
-			case dimension_relative::smaller: chosen_scale = s_scale; break;
-			case dimension_relative::larger: chosen_scale = l_scale; break;
-			case dimension_relative::diagonal: chosen_scale = d_scale; break;
-			case dimension_relative::pixel: chosen_scale = p_scale; break;
+std::unique_ptr<template_document> svg_source::parse_template(std::vector<char> const& text) {
+	auto copy = std::make_unique<template_document>();
+	copy->text = text;
+	lunasvg::AttributeSourceList sources;
+	copy->document = parse(copy->text, &sources);
+	if(!copy->document)
+		return nullptr;
+	// content copied by <use> would not see later attribute changes
+	if(!copy->document->querySelectorAll("use").empty())
+		return nullptr;
+
+	uint32_t next_replacement = 0;
+	for(auto& src : sources) {
+		if(next_replacement >= replacements.size())
+			break;
+		if(src.begin == 0)
+			continue;
+
+		uint32_t value_start = uint32_t(src.begin - 1);
+		uint32_t value_end = uint32_t(src.end + 1);
+
+		parametric_attribute attr{ };
+		attr.source = src;
+		attr.start_position = value_start;
+		attr.end_position = value_end;
+		attr.first_replacement = next_replacement;
+		while(next_replacement < replacements.size() && replacements[next_replacement].start_position < value_end) {
+			if(replacements[next_replacement].start_position < value_start)
+				return nullptr; // a replacement outside of any attribute value (e.g. inside text or a <style> block)
+			attr.end_position = std::max(attr.end_position, replacements[next_replacement].end_position);
+			++next_replacement;
 		}
-		if(!r.emit_quotes) {
-			auto result = std::to_chars(temp_buffer, temp_buffer + 128, chosen_scale * r.scale + r.offset);
-			memset(result.ptr, ' ', size_t((temp_buffer + 128) - result.ptr));
-			memcpy(svg_data.data() + r.start_position, temp_buffer, size_t(std::min(r.end_position - r.start_position, uint32_t(128))));
-		} else {
-			auto result = std::to_chars(temp_buffer + 1, temp_buffer + 126, chosen_scale * r.scale + r.offset);
-			memset(result.ptr, ' ', size_t((temp_buffer + 128) - result.ptr));
-			*result.ptr = '\"';
-			temp_buffer[0] = '\"';
-			memcpy(svg_data.data() + r.start_position, temp_buffer, size_t(std::min(r.end_position - r.start_position, uint32_t(128))));
+		attr.replacement_count = next_replacement - attr.first_replacement;
+		if(attr.replacement_count != 0)
+			copy->attributes.push_back(attr);
+	}
+	if(next_replacement != replacements.size())
+		return nullptr;
+
+	return copy;
+}
+
+std::unique_ptr<template_document> svg_source::acquire_template() {
+	std::vector<char> text;
+	uint32_t generation = 0;
+	{
+		std::lock_guard lock(guard);
+		if(!templated)
+			return nullptr;
+		if(!idle_templates.empty()) {
+			auto copy = std::move(idle_templates.back());
+			idle_templates.pop_back();
+			return copy;
 		}
+		text = svg_data;
+		generation = template_generation;
 	}
 
-	char cssstylesheet[] = ".primarycolor { fill: #000000; stroke: #000000; } ";
-	auto const clroffset = strlen(".primarycolor { fill: #");
-	auto const clroffset2 = strlen(".primarycolor { fill: #000000; stroke: #");
-	auto tohexdigit = [](uint32_t v) { 
-		char table[] = "0123456789abcdef";
-		return table[v & 0x0F];
-	};
-	auto rv = uint32_t(r * 255.0f);
-	cssstylesheet[clroffset] = cssstylesheet[clroffset2] = tohexdigit(rv >> 4);
-	cssstylesheet[clroffset+1] = cssstylesheet[clroffset2 + 1] = tohexdigit(rv);
-	auto gv = uint32_t(g * 255.0f);
-	cssstylesheet[clroffset + 2] = cssstylesheet[clroffset2 + 2] = tohexdigit(gv >> 4);
-	cssstylesheet[clroffset + 3] = cssstylesheet[clroffset2 + 3] = tohexdigit(gv);
-	auto bv = uint32_t(b * 255.0f);
-	cssstylesheet[clroffset + 4] = cssstylesheet[clroffset2 + 4] = tohexdigit(bv >> 4);
-	cssstylesheet[clroffset + 5] = cssstylesheet[clroffset2 + 5] = tohexdigit(bv);
+	// every copy is busy with another size or color, so this render parses one of its own rather than waiting for them
+	auto copy = parse_template(text);
+	if(copy)
+		copy->generation = generation;
+	return copy;
+}
 
-	auto doc = lunasvg::Document::loadFromData(svg_data.data(), svg_data.size(), [](std::string_view file_name) {
-		return common_file_bank::bank.get_file_data(file_name);
-	});
+void svg_source::release_template(std::unique_ptr<template_document> copy) {
+	if(!copy)
+		return;
+	std::lock_guard lock(guard);
+	if(templated && copy->generation == template_generation)
+		idle_templates.push_back(std::move(copy));
+}
+
+lunasvg::Bitmap svg_source::rasterize(float size_x, float size_y, int32_t grid_size, float scale, int32_t base_width, int32_t base_height, uint32_t color) {
+	if(svg_data.size() == 0)
+		return lunasvg::Bitmap{ };
+
+	profiler::scoped_zone zone("svg_source::rasterize", profiler::counter::raster_us);
+	// the copy of the template belongs to this render alone until it is released, so nothing is locked while drawing
+	auto copy = acquire_template();
+	std::unique_ptr<lunasvg::Document> reparsed;
+	auto doc = apply_replacements(copy.get(), size_x, size_y, grid_size, base_width, base_height, reparsed);
 
-	if(!doc) std::abort(); // TODO: error message
-	doc->applyStyleSheet(cssstylesheet);
+	// a file caught half written by the editor saving it does not parse; the render comes out empty until it is saved again
+	parse_failed.store(!doc, std::memory_order_relaxed);
+	if(!doc)
+		return lunasvg::Bitmap{ };
+	doc->applyStyleSheet(color_stylesheet(color));
 
 	lunasvg::Bitmap bmp(
 		int32_t(size_x * scale * grid_size),
 		int32_t(size_y * scale * grid_size));
 
-	doc->render(bmp, lunasvg::Matrix{ }.scale(scale * float(grid_size) / 500.0f, scale * float(grid_size) / 500.0f));
+	{
+		profiler::scoped_zone render_zone("Document::render");
+		doc->render(bmp, lunasvg::Matrix{ }.scale(scale * float(grid_size) / 500.0f, scale * float(grid_size) / 500.0f));
+	}
 
-	bmp.convertToRGBA();
+	release_template(std::move(copy));
+	return bmp;
+}
 
-	svg_instance new_inst((char const*)(bmp.data()),
-		int32_t(size_x * scale * grid_size),
-		int32_t(size_y * scale * grid_size));
+lunasvg::Document* svg_source::apply_replacements(template_document* copy, float size_x, float size_y, int32_t grid_size, int32_t base_width, int32_t base_height, std::unique_ptr<lunasvg::Document>& reparsed) {
+	replacement_scales scales(size_x, size_y, grid_size, base_width, base_height);
 
-	auto h = new_inst.texture_handle;
+	if(copy) {
+		std::string value_text;
+		for(auto& attr : copy->attributes) {
+			value_text.assign(copy->text.data() + attr.start_position, copy->text.data() + attr.end_position);
+			for(uint32_t i = attr.first_replacement; i < attr.first_replacement + attr.replacement_count; ++i) {
+				auto& rep = replacements[i];
+				write_replacement(value_text.data() + (rep.start_position - attr.start_position), rep, scales.resolve(rep));
+			}
+			// the value runs from the opening quote to the next matching quote
+			auto close = value_text.find(value_text[0], 1);
+			copy->document->setSourceAttribute(attr.source, std::string_view(value_text).substr(1, close - 1));
+		}
+		return copy->document.get();
+	}
+
+	std::vector<char> text;
+	{
+		std::lock_guard lock(guard);
+		text = svg_data;
+	}
+	for(auto& rep : replacements) {
+		write_replacement(text.data() + rep.start_position, rep, scales.resolve(rep));
+	}
+	reparsed = parse(text, nullptr);
+	return reparsed.get();
+}
 
-	uint64_t colorid = uint64_t(r * 255.0f) | (uint64_t(g * 255.0f) << uint64_t(8)) | (uint64_t(b * 255.0f) << uint64_t(16));
-	uint64_t idx = uint64_t(uint32_t(size_x * grid_size)) | (uint64_t(uint32_t(size_y * grid_size)) << uint64_t(20)) | (colorid << 40);
-	renders[idx] = std::move(new_inst);
+std::unique_ptr<lunasvg::Document> svg_source::parse(std::vector<char> const& text, lunasvg::AttributeSourceList* sources) {
+	profiler::scoped_zone zone("Document::loadFromData");
+	// the template keeps these loaders, so files that a later attribute change loads are noted as well
+	auto add_dependency = [this](std::string_view file_name) {
+		std::lock_guard lock(dependencies_guard);
+		if(std::find(dependencies.begin(), dependencies.end(), file_name) == dependencies.end())
+			dependencies.emplace_back(file_name);
+	};
+	auto load_file = [add_dependency](std::string_view file_name) {
+		add_dependency(file_name);
+		return common_file_bank::bank.get_file_data(file_name);
+	};
+	auto load_image = [add_dependency](std::string_view file_name) {
+		add_dependency(file_name);
+		return common_file_bank::bank.get_image(file_name);
+	};
+	if(sources)
+		return lunasvg::Document::loadFromData(text.data(), text.size(), load_file, *sources, load_image);
+	return lunasvg::Document::loadFromData(text.data(), text.size(), load_file, load_image);
+}
 
-	return h;
+uint32_t svg_source::current_revision(int32_t base_width, int32_t base_height) {
+	auto changes = common_file_bank::bank.change_count.load(std::memory_order_acquire);
+	if(changes == dependencies_checked)
+		return revision;
+
+	std::lock_guard lock(guard);
+	auto seen = std::exchange(dependencies_checked, changes);
+	std::vector<std::string> file_names;
+	{
+		std::lock_guard dependencies_lock(dependencies_guard);
+		file_names = dependencies;
+	}
+	if(!common_file_bank::bank.changed_since(file_names, seen))
+		return revision;
+
+	// renders under the old revision are never asked for again, so they age out of the texture cache
+	revision = next_document_revision();
+	build_template(base_width, base_height);
+	return revision;
 }
 
+svg::svg(char const* data, size_t count, int32_t base_width, int32_t base_height) : source(std::make_shared<svg_source>(data, count, base_width, base_height)), base_width(base_width), base_height(base_height) {
 
-simple_svg::simple_svg(char const* data, size_t count) : svg_data(data, data + count) {
+}
 
+lunasvg::Bitmap svg::rasterize(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
+	if(!source)
+		return lunasvg::Bitmap{ };
+	return source->rasterize(size_x, size_y, grid_size, scale, base_width, base_height, pack_render_color(r, g, b));
 }
 
-void simple_svg::release_renders() {
-	renders.clear();
+lunasvg::Bitmap svg::rasterize_key(std::shared_ptr<svg_source> const& source, render_key const& key) {
+	auto render = [&](uint32_t color) {
+		return source->rasterize(key.size_x, key.size_y, key.grid_size, key.scale, key.base_width, key.base_height, color);
+	};
+	if(source->primarycolor == primarycolor_use::tinted)
+		return common_tint_cache::cache.render(source, key, render);
+	return render(key.color);
 }
 
-uint32_t simple_svg::get_render(int32_t size_x, int32_t size_y, float scale, float r, float g, float b) {
-	uint64_t colorid = uint64_t(r * 255.0f) | (uint64_t(g * 255.0f) << uint64_t(8)) | (uint64_t(b * 255.0f) << uint64_t(16));
-	uint64_t idx = uint64_t(uint32_t(size_x)) | (uint64_t(uint32_t(size_y)) << uint64_t(20)) | (colorid << 40);
+void file_dependencies::add(std::string_view file_name) {
+	std::lock_guard lock(guard);
+	if(std::find(file_names.begin(), file_names.end(), file_name) == file_names.end())
+		file_names.emplace_back(file_name);
+}
+
+simple_svg::simple_svg(char const* data, size_t count) : svg_data(std::make_shared<std::vector<char> const>(data, data + count)), dependencies(std::make_shared<file_dependencies>()), revision(next_document_revision()), primarycolor(find_primarycolor_use(data, count)) {
+	dependencies->checked = common_file_bank::bank.change_count.load();
 
-	if(auto it = renders.find(idx); it != renders.end()) {
-		return it->second.texture_handle;
-	}
-	return make_new_render(size_x, size_y, scale, r, g, b);
 }
-uint32_t simple_svg::try_get_render(int32_t size_x, int32_t size_y, float r, float g, float b) {
-	uint64_t colorid = uint64_t(r * 255.0f) | (uint64_t(g * 255.0f) << uint64_t(8)) | (uint64_t(b * 255.0f) << uint64_t(16));
-	uint64_t idx = uint64_t(uint32_t(size_x)) | (uint64_t(uint32_t(size_y)) << uint64_t(20)) | (colorid << 40);
 
-	if(auto it = renders.find(idx); it != renders.end()) {
-		return it->second.texture_handle;
-	}
-	return 0;
+lunasvg::Bitmap simple_svg::rasterize(int32_t size_x, int32_t size_y, float scale, float r, float g, float b) {
+	return rasterize_color(size_x, size_y, scale, pack_render_color(r, g, b));
 }
-uint32_t simple_svg::make_new_render(int32_t size_x, int32_t size_y, float scale, float r, float g, float b) {
-	if(svg_data.size() == 0)
-		return 0;
 
-	char cssstylesheet[] = ".primarycolor { fill: #000000; stroke: #000000; } ";
-	auto const clroffset = strlen(".primarycolor { fill: #");
-	auto const clroffset2 = strlen(".primarycolor { fill: #000000; stroke: #");
-	auto tohexdigit = [](uint32_t v) {
-		char table[] = "0123456789abcdef";
-		return table[v & 0x0F];
+lunasvg::Bitmap simple_svg::rasterize_key(render_key const& key) {
+	auto render = [&](uint32_t color) {
+		return rasterize_color(int32_t(key.size_x), int32_t(key.size_y), key.scale, color);
 	};
-	auto rv = uint32_t(r * 255.0f);
-	cssstylesheet[clroffset] = cssstylesheet[clroffset2] = tohexdigit(rv >> 4);
-	cssstylesheet[clroffset + 1] = cssstylesheet[clroffset2 + 1] = tohexdigit(rv);
-	auto gv = uint32_t(g * 255.0f);
-	cssstylesheet[clroffset + 2] = cssstylesheet[clroffset2 + 2] = tohexdigit(gv >> 4);
-	cssstylesheet[clroffset + 3] = cssstylesheet[clroffset2 + 3] = tohexdigit(gv);
-	auto bv = uint32_t(b * 255.0f);
-	cssstylesheet[clroffset + 4] = cssstylesheet[clroffset2 + 4] = tohexdigit(bv >> 4);
-	cssstylesheet[clroffset + 5] = cssstylesheet[clroffset2 + 5] = tohexdigit(bv);
+	if(primarycolor == primarycolor_use::tinted)
+		return common_tint_cache::cache.render(svg_data, key, render);
+	return render(key.color);
+}
 
-	auto doc = lunasvg::Document::loadFromData(svg_data.data(), svg_data.size(), [](std::string_view file_name) {
-		return common_file_bank::bank.get_file_data(file_name);
-	});
+lunasvg::Bitmap simple_svg::rasterize_color(int32_t size_x, int32_t size_y, float scale, uint32_t color) {
+	if(!svg_data || svg_data->size() == 0)
+		return lunasvg::Bitmap{ };
+
+	profiler::scoped_zone zone("simple_svg::rasterize", profiler::counter::raster_us);
+	std::unique_ptr<lunasvg::Document> doc;
+	{
+		profiler::scoped_zone parse_zone("Document::loadFromData");
+		doc = lunasvg::Document::loadFromData(svg_data->data(), svg_data->size(), [deps = dependencies.get()](std::string_view file_name) {
+			if(deps)
+				deps->add(file_name);
+			return common_file_bank::bank.get_file_data(file_name);
+		}, [deps = dependencies.get()](std::string_view file_name) {
+			if(deps)
+				deps->add(file_name);
+			return common_file_bank::bank.get_image(file_name);
+		});
+	}
 
-	if(!doc) std::abort(); // TODO: error message
-	doc->applyStyleSheet(cssstylesheet);
+	if(dependencies)
+		dependencies->parse_failed.store(!doc, std::memory_order_relaxed);
+	if(!doc)
+		return lunasvg::Bitmap{ };
+	doc->applyStyleSheet(color_stylesheet(color));
 
 	lunasvg::Bitmap bmp(
 		int32_t(size_x * scale),
 		int32_t(size_y * scale));
 
-	doc->render(bmp, lunasvg::Matrix{ }.scale(scale * size_x / float(doc->width()), scale * size_y / float(doc->height())));
-	bmp.convertToRGBA();
+	{
+		profiler::scoped_zone render_zone("Document::render");
+		doc->render(bmp, lunasvg::Matrix{ }.scale(scale * size_x / float(doc->width()), scale * size_y / float(doc->height())));
+	}
 
-	svg_instance new_inst((char const*)(bmp.data()),
-		int32_t(size_x * scale),
-		int32_t(size_y * scale));
+	return bmp;
+}
 
-	auto h = new_inst.texture_handle;
+uint32_t next_document_revision() {
+	static std::atomic<uint32_t> last_revision{ 0 };
+	return ++last_revision;
+}
 
-	uint64_t colorid = uint64_t(r * 255.0f) | (uint64_t(g * 255.0f) << uint64_t(8)) | (uint64_t(b * 255.0f) << uint64_t(16));
-	uint64_t idx = uint64_t(uint32_t(size_x)) | (uint64_t(uint32_t(size_y)) << uint64_t(20)) | (colorid << 40);
-	renders[idx] = std::move(new_inst);
+file_bank common_file_bank::bank{ };
 
+namespace {
+
+// only has to tell apart two versions of the same file, so it takes eight bytes at a time
+uint64_t hash_file_contents(char const* data, size_t size) {
+	uint64_t h = 0xcbf29ce484222325ull ^ size;
+	size_t i = 0;
+	for(; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, data + i, 8);
+		h = (h ^ word) * 0x100000001b3ull;
+		h ^= h >> 29;
+	}
+	for(; i < size; ++i) {
+		h = (h ^ uint8_t(data[i])) * 0x100000001b3ull;
+	}
 	return h;
 }
 
-file_bank common_file_bank::bank{ };
+}
+
+bank_file& file_bank::track(std::string_view file_name) {
+	if(auto it = files.find(file_name); it != files.end())
+		return it->second;
+
+	auto& f = files[std::string(file_name)];
+	f.full_path = root_directory + fs::utf8_to_native(file_name);
+	if(auto separator = f.full_path.find_last_of(L"\\/"); separator != std::wstring::npos)
+		watcher.watch(f.full_path.substr(0, separator + 1));
+	return f;
+}
+
+void file_bank::set_root_directory(std::wstring const& directory) {
+	std::lock_guard lock(guard);
+	root_directory = directory;
+	files.clear();
+	watcher.clear();
+	// every name now refers to a different file
+	change_count.fetch_add(1, std::memory_order_release);
+}
 
 std::pair<void const*, int> file_bank::get_file_data(std::string_view file_name) {
-	if(auto it = file_contents.find(file_name); it != file_contents.end()) {
-		return std::pair<void const*, int>{(void const*)(it->second.data()), int(it->second.size()) };
-	} else {
-		fs::file data{ root_directory + fs::utf8_to_native(file_name) };
-		std::vector<char> hold_data(data.content().data, data.content().data + data.content().file_size);
-		std::pair<void const*, int> result{ (void const*)(hold_data.data()), int(hold_data.size()) };
-		file_contents[file_name] = std::move(hold_data);
-		return result;
+	// keeps the contents alive for the caller when poll_changes drops them from another thread
+	thread_local std::shared_ptr<std::vector<char> const> held_contents;
+
+	std::lock_guard lock(guard);
+	auto& f = track(file_name);
+	if(!f.contents) {
+		profiler::scoped_zone zone("file_bank::get_file_data");
+		// read first, so that a write landing during the read is still seen as a change
+		f.write_time = fs::last_write_time(f.full_path);
+		fs::file data{ f.full_path };
+		f.contents = std::make_shared<std::vector<char> const>(data.content().data, data.content().data + data.content().file_size);
+		f.size = f.contents->size();
+		f.hash = hash_file_contents(f.contents->data(), f.contents->size());
+	}
+	held_contents = f.contents;
+	return std::pair<void const*, int>{ (void const*)(held_contents->data()), int(held_contents->size()) };
+}
+
+lunasvg::Bitmap file_bank::get_image(std::string_view file_name) {
+	std::wstring full_path;
+	int64_t write_time = 0;
+	{
+		std::lock_guard lock(guard);
+		full_path = track(file_name).full_path;
+		write_time = fs::last_write_time(full_path);
+		if(auto it = decoded_images.find(full_path); it != decoded_images.end()) {
+			if(it->second.write_time == write_time) {
+				it->second.last_use = ++image_use_clock;
+				return it->second.bitmap;
+			}
+			decoded_bytes -= it->second.bytes;
+			decoded_images.erase(it);
+		}
+	}
+
+	// decoded outside of the lock so that workers loading different images do not wait on each other
+	lunasvg::Bitmap bitmap;
+	uint64_t size = 0;
+	uint64_t hash = 0;
+	{
+		profiler::scoped_zone zone("file_bank::get_image");
+		fs::file data{ full_path };
+		if(data.content().data) {
+			size = data.content().file_size;
+			hash = hash_file_contents(data.content().data, size_t(size));
+			bitmap = lunasvg::Bitmap::loadFromData(data.content().data, int(data.content().file_size));
+		}
+	}
+
+	std::lock_guard lock(guard);
+	auto& f = track(file_name);
+	f.write_time = write_time;
+	f.size = size;
+	f.hash = hash;
+	if(bitmap.isNull())
+		return bitmap;
+
+	auto& entry = decoded_images[full_path];
+	decoded_bytes -= entry.bytes;
+	entry.bitmap = bitmap;
+	entry.write_time = write_time;
+	entry.bytes = size_t(bitmap.stride()) * size_t(bitmap.height());
+	entry.last_use = ++image_use_clock;
+	decoded_bytes += entry.bytes;
+	evict_images();
+	return bitmap;
+}
+
+std::vector<std::string> file_bank::poll_changes() {
+	std::lock_guard lock(guard);
+	auto changed_paths = watcher.poll();
+	if(changed_paths.empty())
+		return std::vector<std::string>{ };
+
+	profiler::scoped_zone zone("file_bank::poll_changes");
+	return find_changes(&changed_paths);
+}
+
+std::vector<std::string> file_bank::check_all_files() {
+	std::lock_guard lock(guard);
+	profiler::scoped_zone zone("file_bank::check_all_files");
+	return find_changes(nullptr);
+}
+
+std::vector<std::string> file_bank::find_changes(std::vector<std::wstring> const* changed_paths) {
+	std::vector<std::string> changed_files;
+	for(auto& [name, f] : files) {
+		// a path is either the file itself or the directory it is in
+		bool affected = !changed_paths;
+		for(size_t i = 0; !affected && i < changed_paths->size(); ++i) {
+			auto& path = (*changed_paths)[i];
+			affected = f.full_path.compare(0, path.size(), path) == 0;
+		}
+		if(!affected)
+			continue;
+
+		auto write_time = fs::last_write_time(f.full_path);
+		if(write_time == f.write_time)
+			continue;
+		f.write_time = write_time;
+		fs::file data{ f.full_path };
+		uint64_t size = data.content().file_size;
+		auto hash = data.content().data ? hash_file_contents(data.content().data, size_t(size)) : uint64_t(0);
+		if(size == f.size && hash == f.hash)
+			continue;
+
+		f.size = size;
+		f.hash = hash;
+		f.contents.reset();
+		if(auto it = decoded_images.find(f.full_path); it != decoded_images.end()) {
+			decoded_bytes -= it->second.bytes;
+			decoded_images.erase(it);
+		}
+		f.changed_at = change_count.fetch_add(1, std::memory_order_release) + 1;
+		changed_files.push_back(name);
+	}
+	return changed_files;
+}
+
+bool file_bank::changed_since(std::vector<std::string> const& file_names, uint32_t seen) {
+	std::lock_guard lock(guard);
+	for(auto& name : file_names) {
+		auto it = files.find(name);
+		if(it == files.end() || it->second.changed_at > seen)
+			return true;
+	}
+	return false;
+}
+
+void file_bank::evict_images() {
+	// the image just added has the newest use, so it goes last and only when it is over budget on its own
+	while(decoded_bytes > image_budget && !decoded_images.empty()) {
+		auto oldest = decoded_images.begin();
+		for(auto it = decoded_images.begin(); it != decoded_images.end(); ++it) {
+			if(it->second.last_use < oldest->second.last_use)
+				oldest = it;
+		}
+		decoded_bytes -= oldest->second.bytes;
+		decoded_images.erase(oldest);
+	}
+}
+
+void file_bank::clear_images() {
+	std::lock_guard lock(guard);
+	decoded_images.clear();
+	decoded_bytes = 0;
+}
+
+render_pool common_render_pool::pool{ };
+
+render_pool::~render_pool() {
+	{
+		std::lock_guard lock(guard);
+		stopping = true;
+		jobs.clear();
+	}
+	work_available.notify_all();
+	for(auto& w : workers)
+		w.join();
+}
+
+void render_pool::start_workers() {
+	// leave a core for the ui thread
+	auto count = std::max(2u, std::thread::hardware_concurrency()) - 1u;
+	for(uint32_t i = 0; i < count; ++i) {
+		workers.emplace_back([this]() { worker_loop(); });
+	}
+}
+
+std::future<lunasvg::Bitmap> render_pool::submit(std::function<lunasvg::Bitmap()> job) {
+	std::packaged_task<lunasvg::Bitmap()> task(std::move(job));
+	auto result = task.get_future();
+	{
+		std::lock_guard lock(guard);
+		if(workers.empty())
+			start_workers();
+		jobs.push_back(std::move(task));
+	}
+	work_available.notify_one();
+	return result;
+}
+
+void render_pool::worker_loop() {
+	while(true) {
+		std::packaged_task<lunasvg::Bitmap()> task;
+		{
+			std::unique_lock lock(guard);
+			work_available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if(stopping)
+				return;
+			task = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		task();
+		if(on_job_finished)
+			on_job_finished();
 	}
 }
 
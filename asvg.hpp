@@ -1,26 +1,23 @@
 #pragma once
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <deque>
+#include <list>
+#include <optional>
+#include <functional>
+#include <condition_variable>
+#include <atomic>
+#include <cstring>
 #include "filesystem.hpp"
+#include "lunasvg.h"
+#include "texture_atlas.hpp"
 
 namespace asvg {
 
-class svg_instance {
-public:
-	uint32_t texture_handle = 0;
-	svg_instance() { }
-	svg_instance(char const* bytes, int32_t sx, int32_t sy);
-	svg_instance(svg_instance&& other) noexcept;
-	svg_instance(svg_instance const& other) noexcept {
-		std::abort();
-	}
-	svg_instance& operator=(svg_instance&& other) noexcept;
-	svg_instance& operator=(svg_instance const& other) noexcept {
-		std::abort();
-	}
-	~svg_instance() noexcept;
-};
-
 enum class dimension_relative : uint8_t {
 	height, width, smaller, larger, diagonal, pixel
 };
@@ -34,11 +31,74 @@ struct affine_replacement {
 	bool emit_quotes = false;
 };
 
+// an attribute of the parsed template whose value contains one or more replacements
+struct parametric_attribute {
+	lunasvg::AttributeSource source;
+	uint32_t start_position = 0; // covers the opening quote through the end of the last replacement inside the value
+	uint32_t end_position = 0;
+	uint32_t first_replacement = 0;
+	uint32_t replacement_count = 0;
+};
+
+// an image referenced by a document, decoded once for every document that uses the same version of the file
+struct decoded_image {
+	lunasvg::Bitmap bitmap; // shares its pixels with the documents holding it, so eviction never pulls them out from under a render
+	int64_t write_time = 0;
+	size_t bytes = 0;
+	uint64_t last_use = 0;
+};
+
+// what the bank knows about a file that a document referred to
+struct bank_file {
+	std::wstring full_path;
+	std::shared_ptr<std::vector<char> const> contents; // null until requested through get_file_data, and again once the file changes
+	int64_t write_time = 0;
+	uint64_t size = 0;
+	uint64_t hash = 0; // so that a file which is saved without being edited does not count as a change
+	uint32_t changed_at = 0; // the change count of the bank when the file was last found to have changed
+};
+
+struct file_name_hash {
+	using is_transparent = void;
+	size_t operator()(std::string_view name) const noexcept {
+		return std::hash<std::string_view>{ }(name);
+	}
+};
+
+// files and decoded images shared by every document, under the names the documents use for them; safe to use from any thread
+// the directories of the files it has handed out are watched, and poll_changes forgets any file that has been edited since
 class file_bank {
 public:
-	std::wstring root_directory;
-	std::unordered_map<std::string_view, std::vector<char>> file_contents;
+	static constexpr size_t default_image_budget = size_t(128) << 20;
+
+	std::mutex guard;
+	std::wstring root_directory; // change through set_root_directory, since the names are relative to it
+	std::unordered_map<std::string, bank_file, file_name_hash, std::equal_to<>> files;
+	std::unordered_map<std::wstring, decoded_image> decoded_images; // keyed by resolved path
+	size_t decoded_bytes = 0;
+	size_t image_budget = default_image_budget; // least recently used images are dropped past this
+	uint64_t image_use_clock = 0;
+	fs::directory_watcher watcher;
+	// goes up whenever a file changes, so that users of the bank can skip checking their files while it stays put
+	std::atomic<uint32_t> change_count{ 0 };
+
+	void set_root_directory(std::wstring const& directory);
+	// the data stays valid until the calling thread asks the bank for another file, even if the file changes in the meantime
 	std::pair<void const*, int> get_file_data(std::string_view file_name);
+	lunasvg::Bitmap get_image(std::string_view file_name);
+	// forgets the files that were edited since they were loaded and returns their names
+	std::vector<std::string> poll_changes();
+	// the same, but reads every file it knows of again rather than only those the watcher reported
+	std::vector<std::string> check_all_files();
+	// whether any of the files has changed, or been forgotten, since change_count had the value seen
+	bool changed_since(std::vector<std::string> const& file_names, uint32_t seen);
+	void clear_images();
+private:
+	// the caller must hold guard
+	bank_file& track(std::string_view file_name);
+	// checks the files under any of the changed paths, or all of them when there are none given
+	std::vector<std::string> find_changes(std::vector<std::wstring> const* changed_paths);
+	void evict_images();
 };
 
 class common_file_bank {
@@ -46,40 +106,337 @@ public:
 	static file_bank bank;
 };
 
-class svg {
+// rasterizes on background threads; results are picked up on the main thread, which does the GL upload
+class render_pool {
 public:
-	std::unordered_map<uint64_t, svg_instance> renders;
+	std::mutex guard;
+	std::condition_variable work_available;
+	std::deque<std::packaged_task<lunasvg::Bitmap()>> jobs;
+	std::vector<std::thread> workers;
+	bool stopping = false;
+	// runs on the worker thread after each job, so that an idle ui thread can be woken to pick the result up
+	std::function<void()> on_job_finished;
+
+	render_pool() { }
+	~render_pool();
+
+	std::future<lunasvg::Bitmap> submit(std::function<lunasvg::Bitmap()> job);
+private:
+	void start_workers();
+	void worker_loop();
+};
+
+class common_render_pool {
+public:
+	static render_pool pool;
+};
+
+// every input that affects the pixels of a render
+struct render_key {
+	float size_x = 0.0f;
+	float size_y = 0.0f;
+	float scale = 1.0f;
+	int32_t grid_size = 0;
+	int32_t base_width = 0;
+	int32_t base_height = 0;
+	uint32_t color = 0; // the 8 bit channels exactly as they are written into the primarycolor stylesheet
+	uint32_t revision = 0; // of the svg contents
+
+	bool operator==(render_key const& o) const noexcept {
+		return size_x == o.size_x && size_y == o.size_y && scale == o.scale && grid_size == o.grid_size
+			&& base_width == o.base_width && base_height == o.base_height && color == o.color && revision == o.revision;
+	}
+};
+struct render_key_hash {
+	size_t operator()(render_key const& k) const noexcept {
+		uint32_t words[8];
+		static_assert(sizeof(words) == sizeof(render_key));
+		std::memcpy(words, &k, sizeof(words));
+		uint64_t h = 0xcbf29ce484222325ull;
+		for(auto w : words) {
+			h = (h ^ w) * 0x100000001b3ull;
+		}
+		return size_t(h ^ (h >> 32));
+	}
+};
+
+inline uint32_t pack_render_color(float r, float g, float b) {
+	return (uint32_t(r * 255.0f) & 0xFF) | ((uint32_t(g * 255.0f) & 0xFF) << 8) | ((uint32_t(b * 255.0f) & 0xFF) << 16);
+}
+
+// a new value for every set of svg contents that is loaded
+uint32_t next_document_revision();
+
+// sets the fill and stroke of the primarycolor class, which is how templates are tinted
+std::string color_stylesheet(float r, float g, float b);
+std::string color_stylesheet(uint32_t color); // as packed by pack_render_color
+
+// one budget for every svg / simple_svg texture; least recently used renders are released first when over budget
+// entries are owned by the svg_source (or file contents) that produced them, so renders of a replaced svg simply age out
+// renders are stored in a shared texture atlas; main thread only, since inserting and evicting touch GL textures
+class texture_cache {
+public:
+	struct cache_key {
+		void const* owner = nullptr;
+		render_key key;
+		bool operator==(cache_key const& o) const noexcept {
+			return owner == o.owner && key == o.key;
+		}
+	};
+	struct cache_key_hash {
+		size_t operator()(cache_key const& k) const noexcept {
+			return std::hash<void const*>{ }(k.owner) ^ (render_key_hash{ }(k.key) * 0x9E3779B97F4A7C15ull);
+		}
+	};
+	struct entry {
+		cache_key id;
+		std::weak_ptr<void const> owner;
+		uint32_t allocation = 0; // in atlas
+		size_t bytes = 0;
+	};
+
+	ogl::texture_atlas atlas;
+	std::list<entry> entries; // most recently used first
+	std::unordered_map<cache_key, std::list<entry>::iterator, cache_key_hash> index;
+	size_t byte_budget = size_t(256) * 1024 * 1024;
+	size_t bytes_used = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+
+	// renders that produced no pixels are present with an empty region
+	std::optional<ogl::atlas_region> find(std::shared_ptr<void const> const& owner, render_key const& key);
+	ogl::atlas_region insert(std::shared_ptr<void const> const& owner, render_key const& key, lunasvg::Bitmap const& pixels);
+	void release_owner(void const* owner);
+	void set_budget(size_t bytes);
+	void clear();
+private:
+	void erase(std::list<entry>::iterator it);
+	void trim();
+};
+
+class common_texture_cache {
+public:
+	static texture_cache cache;
+};
+
+// how the color of a render depends on the primarycolor, as far as can be told from the text of the svg
+enum class primarycolor_use : uint8_t {
+	none, // nothing is in the class, so every color renders the same
+	tinted, // every color can be blended from the renders in black and in white
+	direct // the class may appear inside a mask, where the color does not simply add to the pixels, so each color is rendered
+};
+primarycolor_use find_primarycolor_use(char const* data, size_t count);
+
+// a render with the primarycolor set to black and set to white; the class is a solid paint composited over whatever is below
+// it, so each channel of a pixel is linear in the matching channel of the color, and any other color lies between the two
+struct tint_layers {
+	lunasvg::Bitmap black;
+	lunasvg::Bitmap white;
+};
+
+// the render in the packed color; within a couple of levels of rendering it in that color, and exact for black and white
+lunasvg::Bitmap blend_tint(tint_layers const& layers, uint32_t color);
+
+// tint layers for the renders that were asked for in more than one color; a render asked for in a single color is made
+// directly, and from the second color on it is blended from its layers, so each further color costs no parsing or rasterizing
+// keyed like the texture cache, with the color left out; safe to use from any thread
+class tint_cache {
+public:
+	struct entry {
+		std::weak_ptr<void const> owner;
+		uint32_t first_color = 0; // the color the render was first made in
+		lunasvg::Bitmap first_render; // kept while the first color is black or white, since it is then one of the layers
+		std::shared_future<std::shared_ptr<tint_layers const>> layers; // valid from the second color on; ready once made
+		size_t bytes = 0;
+		uint64_t last_use = 0;
+	};
+
+	static constexpr size_t max_entries = 4096; // most only note the color of a render that was never asked for in another
+
+	std::mutex guard;
+	std::unordered_map<texture_cache::cache_key, entry, texture_cache::cache_key_hash> entries;
+	size_t byte_budget = size_t(64) << 20; // least recently used layers are dropped past this; zero renders every color directly
+	size_t bytes_used = 0;
+	uint64_t use_clock = 0;
+
+	// the render blended from the layers of key, if they are ready; never waits, so that the ui thread can ask
+	std::optional<lunasvg::Bitmap> find(std::shared_ptr<void const> const& owner, render_key const& key);
+	// render makes the render of key in the packed color given, for the first color and for the layers
+	lunasvg::Bitmap render(std::shared_ptr<void const> const& owner, render_key const& key, std::function<lunasvg::Bitmap(uint32_t)> const& render);
+	void release_owner(void const* owner);
+	void set_budget(size_t bytes);
+	void clear();
+private:
+	// the caller must hold guard
+	void trim();
+};
+
+class common_tint_cache {
+public:
+	static tint_cache cache;
+};
+
+// where a render can be cut so that its corners stay put, its edge strips stretch along one axis and its middle along both;
+// sizes of the borders are in pixels of the render
+struct stretch_slices {
+	bool stretchable = false;
+	int32_t left = 0;
+	int32_t top = 0;
+	int32_t right = 0;
+	int32_t bottom = 0;
+};
+
+// takes the runs of identical columns and of identical rows through the middle of a render as the strips that stretch
+stretch_slices find_stretch_slices(lunasvg::Bitmap const& probe);
+// whether another render of the same svg is the probe with its middle strips stretched or shrunk to fit
+bool stretches_to(lunasvg::Bitmap const& probe, stretch_slices const& slices, lunasvg::Bitmap const& other);
+
+// a render that can be drawn at other sizes by stretching the strips between its borders
+struct stretch_render {
+	ogl::atlas_region region; // empty while the render is pending
+	int32_t width = 0; // of the render, in pixels
+	int32_t height = 0;
+	stretch_slices slices;
+};
+
+// a parsed copy of an asvg, with the replacement values of whichever render last used it
+struct template_document {
+	std::vector<char> text; // what it was parsed from, for the parts of each value around the replacements
+	std::unique_ptr<lunasvg::Document> document;
+	std::vector<parametric_attribute> attributes; // the sources point into this document
+	uint32_t generation = 0; // of the template it was parsed from
+};
+
+// the parsed form of an asvg file, shared with any renders still in flight when the owning svg is replaced or moved
+class svg_source {
+public:
+	std::mutex guard;
 	std::vector<char> svg_data;
 	std::vector<affine_replacement> replacements;
+	uint32_t revision = 0;
+	primarycolor_use primarycolor = primarycolor_use::none;
+	// every replacement follows the width, the height or the pixel size alone, so growing one side moves things along that axis only
+	bool separable_replacements = false;
+	// whether the last render found nothing it could parse; read by the ui to point out the file
+	std::atomic<bool> parse_failed{ false };
+
+	// when the asvg can be parsed once, renders only re-evaluate the attributes that contain replacements; each render takes
+	// a copy of the template of its own, so that renders of the same svg at other sizes and colors do not wait on each other
+	bool templated = false;
+	std::vector<std::unique_ptr<template_document>> idle_templates; // copies not in use by any render
+	uint32_t template_generation = 0; // goes up when the template is parsed again, so that older copies are not taken back
+	// the files loaded through the file bank while parsing, and the change count of the bank when they were last checked
+	std::mutex dependencies_guard;
+	std::vector<std::string> dependencies;
+	uint32_t dependencies_checked = 0;
+
+	svg_source(char const* data, size_t count, int32_t base_width, int32_t base_height);
+	// the caller must hold guard
+	void build_template(int32_t base_width, int32_t base_height);
+	// gives the source a new revision, and parses it again, if any file it depends on has changed since it was parsed
+	// ui thread only; the cheap check is a single load while the file bank has not seen any changes
+	uint32_t current_revision(int32_t base_width, int32_t base_height);
+	// produces premultiplied ARGB pixels without touching the GL context; safe to call from any thread
+	lunasvg::Bitmap rasterize(float size_x, float size_y, int32_t grid_size, float scale, int32_t base_width, int32_t base_height, uint32_t color);
+	// an idle copy of the template, or a newly parsed one when they are all in use; nullptr when the svg has no template
+	std::unique_ptr<template_document> acquire_template();
+	void release_template(std::unique_ptr<template_document> copy);
+	// writes the values for this size into the copy of the template, or reparses the svg into reparsed when there is no copy
+	// returns nullptr if the svg could not be parsed
+	lunasvg::Document* apply_replacements(template_document* copy, float size_x, float size_y, int32_t grid_size, int32_t base_width, int32_t base_height, std::unique_ptr<lunasvg::Document>& reparsed);
+private:
+	// nullptr when the text does not parse, or its replacements are not all inside attribute values
+	std::unique_ptr<template_document> parse_template(std::vector<char> const& text);
+	std::unique_ptr<lunasvg::Document> parse(std::vector<char> const& text, lunasvg::AttributeSourceList* sources);
+};
+
+// a render of an svg, made at the first size that was asked for, that stands in for every size the svg can be stretched to
+struct stretch_probe {
+	float size_x = 0.0f;
+	float size_y = 0.0f;
+	std::future<lunasvg::Bitmap> pending; // valid until the render is collected; the job writes the slices before it finishes
+	std::shared_ptr<stretch_slices> slices;
+};
+
+class svg {
+public:
+	std::unordered_map<render_key, std::future<lunasvg::Bitmap>, render_key_hash> pending_renders;
+	std::unordered_map<render_key, stretch_probe, render_key_hash> stretch_probes; // keyed without the size, and without the color when it is tinted
+	std::shared_ptr<svg_source> source;
 	int32_t base_width = 1;
 	int32_t base_height = 1;
+	uint32_t pending_revision = 0; // of the source when renders were last queued or looked up
 public:
 	svg() { }
 	svg(char const* data, size_t count, int32_t base_width, int32_t base_height);
 	svg(svg&& other) noexcept = default;
 	svg& operator=(svg&& other) noexcept = default;
 
-	uint32_t make_new_render(float size_x, float size_y, int32_t grid_size, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	lunasvg::Bitmap rasterize(float size_x, float size_y, int32_t grid_size, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	ogl::atlas_region make_new_render(float size_x, float size_y, int32_t grid_size, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	// queues the render on the render pool; it becomes available from get_render / try_get_render once finished
+	void queue_render(float size_x, float size_y, int32_t grid_size, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
 	void release_renders();
-	uint32_t get_render(float size_x, float size_y, int32_t grid_size, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
-	uint32_t try_get_render(float size_x, float size_y, int32_t grid_size, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	// returns an empty region while the render is pending
+	ogl::atlas_region get_render(float size_x, float size_y, int32_t grid_size, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	ogl::atlas_region try_get_render(float size_x, float size_y, int32_t grid_size, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	// the render of another size that this size can be drawn from, made once per grid size, scale and color
+	// returns nullopt when the svg does not stretch, or not down to this size, and get_render should be used instead
+	std::optional<stretch_render> get_stretch_render(float size_x, float size_y, int32_t grid_size, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	// whether the last render came out empty because the file could not be parsed
+	bool parse_failed() const {
+		return source && source->parse_failed.load(std::memory_order_relaxed);
+	}
+private:
+	// leaves the color out when the source does not use it
+	render_key make_key(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b);
+	ogl::atlas_region collect_pending(render_key const& key);
+	// renders everything the key describes, blending the color from the tint layers when the source allows it
+	static lunasvg::Bitmap rasterize_key(std::shared_ptr<svg_source> const& source, render_key const& key);
+};
+
+// the files that renders of a simple_svg loaded through the file bank, shared with the renders still in flight
+struct file_dependencies {
+	std::mutex guard;
+	std::vector<std::string> file_names;
+	uint32_t checked = 0; // the change count of the file bank when the files were last checked; ui thread only
+	std::atomic<bool> parse_failed{ false }; // whether the last render could not parse the svg
+
+	void add(std::string_view file_name);
 };
 
 class simple_svg {
 public:
-	std::unordered_map<uint64_t, svg_instance> renders;
-	std::vector<char> svg_data;
+	std::unordered_map<render_key, std::future<lunasvg::Bitmap>, render_key_hash> pending_renders;
+	std::shared_ptr<std::vector<char> const> svg_data;
+	std::shared_ptr<file_dependencies> dependencies;
+	uint32_t revision = 0;
+	primarycolor_use primarycolor = primarycolor_use::none;
 public:
 	simple_svg() {
 	}
 	simple_svg(char const* data, size_t count);
 	simple_svg(simple_svg&& other) noexcept = default;
 	simple_svg& operator=(simple_svg&& other) noexcept = default;
-	uint32_t make_new_render(int32_t size_x, int32_t size_y, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	lunasvg::Bitmap rasterize(int32_t size_x, int32_t size_y, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	ogl::atlas_region make_new_render(int32_t size_x, int32_t size_y, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	void queue_render(int32_t size_x, int32_t size_y, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
 	void release_renders();
-	uint32_t get_render(int32_t size_x, int32_t size_y, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
-	uint32_t try_get_render(int32_t size_x, int32_t size_y, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	// returns an empty region while the render is pending
+	ogl::atlas_region get_render(int32_t size_x, int32_t size_y, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	ogl::atlas_region try_get_render(int32_t size_x, int32_t size_y, float scale, float r = 0.0f, float g = 0.0f, float b = 0.0f);
+	// whether the last render came out empty because the file could not be parsed
+	bool parse_failed() const {
+		return dependencies && dependencies->parse_failed.load(std::memory_order_relaxed);
+	}
+private:
+	// takes a new revision when a file that an earlier render loaded has changed since, and leaves the color out when unused
+	render_key make_key(int32_t size_x, int32_t size_y, float scale, float r, float g, float b);
+	ogl::atlas_region collect_pending(render_key const& key);
+	lunasvg::Bitmap rasterize_color(int32_t size_x, int32_t size_y, float scale, uint32_t color);
+	// renders everything the key describes, blending the color from the tint layers when the svg allows it
+	lunasvg::Bitmap rasterize_key(render_key const& key);
 };
 
-
 }
@@ -0,0 +1,381 @@
+#include "asvg.hpp"
+#include "glew.h"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace asvg {
+
+texture_cache common_texture_cache::cache{ };
+
+std::optional<ogl::atlas_region> texture_cache::find(std::shared_ptr<void const> const& owner, render_key const& key) {
+	auto it = index.find(cache_key{ owner.get(), key });
+	if(it == index.end())
+		return std::nullopt;
+	if(it->second->owner.expired()) { // a dead owner whose address has been reused
+		erase(it->second);
+		return std::nullopt;
+	}
+	entries.splice(entries.begin(), entries, it->second);
+	++hits;
+	profiler::count(profiler::counter::cache_hits);
+	return atlas.region(it->second->allocation);
+}
+
+ogl::atlas_region texture_cache::insert(std::shared_ptr<void const> const& owner, render_key const& key, lunasvg::Bitmap const& pixels) {
+	profiler::scoped_zone zone("texture_cache::insert");
+	cache_key id{ owner.get(), key };
+	if(auto it = index.find(id); it != index.end())
+		erase(it->second);
+
+	auto bytes = pixels.isNull() ? size_t(0) : size_t(pixels.width()) * size_t(pixels.height()) * 4;
+	auto allocation = pixels.isNull() ? uint32_t(0) : atlas.allocate((char const*)(pixels.data()), pixels.width(), pixels.height());
+	entries.push_front(entry{ id, owner, allocation, bytes });
+	index[id] = entries.begin();
+	bytes_used += bytes;
+	trim();
+	// looked up after trimming, since evictions can compact the page this render was placed in
+	return atlas.region(allocation);
+}
+
+void texture_cache::release_owner(void const* owner) {
+	for(auto it = entries.begin(); it != entries.end(); ) {
+		auto next = std::next(it);
+		if(it->id.owner == owner)
+			erase(it);
+		it = next;
+	}
+}
+
+void texture_cache::set_budget(size_t bytes) {
+	byte_budget = bytes;
+	trim();
+}
+
+void texture_cache::clear() {
+	index.clear();
+	entries.clear();
+	atlas.clear();
+	bytes_used = 0;
+}
+
+void texture_cache::erase(std::list<entry>::iterator it) {
+	atlas.free(it->allocation);
+	bytes_used -= it->bytes;
+	index.erase(it->id);
+	entries.erase(it);
+}
+
+void texture_cache::trim() {
+	// the most recent entry always stays, even if it alone is over budget, since its handle was just handed out
+	while(bytes_used > byte_budget && entries.size() > 1) {
+		erase(std::prev(entries.end()));
+		++evictions;
+	}
+}
+
+render_key svg::make_key(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
+	render_key key;
+	key.size_x = size_x;
+	key.size_y = size_y;
+	key.scale = scale;
+	key.grid_size = grid_size;
+	key.base_width = base_width;
+	key.base_height = base_height;
+	key.color = source && source->primarycolor == primarycolor_use::none ? 0 : pack_render_color(r, g, b);
+	key.revision = source ? source->current_revision(base_width, base_height) : 0;
+	if(key.revision != pending_revision) {
+		// renders still in flight for an older revision would never be asked for
+		std::erase_if(pending_renders, [&](auto const& p) { return p.first.revision != key.revision; });
+		std::erase_if(stretch_probes, [&](auto const& p) { return p.first.revision != key.revision; });
+		pending_revision = key.revision;
+	}
+	return key;
+}
+
+void svg::release_renders() {
+	if(source) {
+		common_texture_cache::cache.release_owner(source.get());
+		common_tint_cache::cache.release_owner(source.get());
+	}
+	// anything still being rasterized was made for the old parameters
+	pending_renders.clear();
+	stretch_probes.clear();
+}
+
+ogl::atlas_region svg::collect_pending(render_key const& key) {
+	auto it = pending_renders.find(key);
+	if(it == pending_renders.end())
+		return ogl::atlas_region{ };
+	if(it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return ogl::atlas_region{ };
+
+	auto bmp = it->second.get();
+	pending_renders.erase(it);
+	return common_texture_cache::cache.insert(source, key, bmp);
+}
+
+ogl::atlas_region svg::get_render(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
+	if(!source)
+		return ogl::atlas_region{ };
+
+	auto key = make_key(size_x, size_y, grid_size, scale, r, g, b);
+	if(auto region = common_texture_cache::cache.find(source, key); region) {
+		return *region;
+	}
+	if(pending_renders.find(key) != pending_renders.end()) {
+		return collect_pending(key);
+	}
+	if(source->primarycolor == primarycolor_use::tinted) {
+		// another color of this render has been asked for before, and blending this one is cheap enough to do right away
+		if(auto bmp = common_tint_cache::cache.find(source, key); bmp) {
+			++common_texture_cache::cache.misses;
+			profiler::count(profiler::counter::cache_misses);
+			return common_texture_cache::cache.insert(source, key, *bmp);
+		}
+	}
+	queue_render(size_x, size_y, grid_size, scale, r, g, b);
+	return ogl::atlas_region{ };
+}
+ogl::atlas_region svg::try_get_render(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
+	if(!source)
+		return ogl::atlas_region{ };
+
+	auto key = make_key(size_x, size_y, grid_size, scale, r, g, b);
+	if(auto region = common_texture_cache::cache.find(source, key); region) {
+		return *region;
+	}
+	return collect_pending(key);
+}
+void svg::queue_render(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
+	if(!source || source->svg_data.size() == 0)
+		return;
+
+	auto key = make_key(size_x, size_y, grid_size, scale, r, g, b);
+	if(pending_renders.find(key) != pending_renders.end())
+		return;
+	++common_texture_cache::cache.misses;
+	profiler::count(profiler::counter::cache_misses);
+
+	// the job holds its own reference to the source so that it is unaffected by this svg being moved or replaced
+	pending_renders[key] = common_render_pool::pool.submit([src = source, key]() {
+		return rasterize_key(src, key);
+	});
+}
+ogl::atlas_region svg::make_new_render(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
+	if(!source || source->svg_data.size() == 0)
+		return ogl::atlas_region{ };
+
+	profiler::scoped_zone zone("svg::make_new_render");
+	// made first, since it brings the source up to date with any changed files
+	auto key = make_key(size_x, size_y, grid_size, scale, r, g, b);
+	auto bmp = rasterize_key(source, key);
+
+	pending_renders.erase(key);
+	++common_texture_cache::cache.misses;
+	profiler::count(profiler::counter::cache_misses);
+
+	return common_texture_cache::cache.insert(source, key, bmp);
+}
+
+std::optional<stretch_render> svg::get_stretch_render(float size_x, float size_y, int32_t grid_size, float scale, float r, float g, float b) {
+	if(!source || source->svg_data.size() == 0 || !source->separable_replacements)
+		return std::nullopt;
+	// renders of different sizes only line up pixel for pixel when a grid unit is a whole number of pixels
+	auto unit = scale * float(grid_size);
+	if(unit < 1.0f || unit != std::floor(unit))
+		return std::nullopt;
+
+	auto key = make_key(0.0f, 0.0f, grid_size, scale, r, g, b);
+	auto color = key.color;
+	// a tinted svg is found to stretch once, and its colors are blended from the black and white renders of the probe
+	if(source->primarycolor == primarycolor_use::tinted)
+		key.color = 0;
+	auto it = stretch_probes.find(key);
+	if(it == stretch_probes.end()) {
+		auto probe_key = key;
+		probe_key.size_x = size_x;
+		probe_key.size_y = size_y;
+		auto& probe = stretch_probes[key];
+		probe.size_x = size_x;
+		probe.size_y = size_y;
+		probe.slices = std::make_shared<stretch_slices>();
+		++common_texture_cache::cache.misses;
+		profiler::count(profiler::counter::cache_misses);
+
+		// the probe is an ordinary render of this size; the svg is also rendered at the smallest size the slices allow and at a
+		// much larger one, and only counts as stretching when both of those come out as the probe stretched to fit
+		probe.pending = common_render_pool::pool.submit([src = source, probe_key, unit, slices = probe.slices]() {
+			std::vector<std::pair<uint32_t, lunasvg::Bitmap>> probes;
+			probes.emplace_back(probe_key.color, rasterize_key(src, probe_key));
+			// every color is a blend of the black and the white render, so both of them have to stretch
+			if(src->primarycolor == primarycolor_use::tinted) {
+				auto white_key = probe_key;
+				white_key.color = pack_render_color(1.0f, 1.0f, 1.0f);
+				probes.emplace_back(white_key.color, rasterize_key(src, white_key));
+			}
+			auto found = find_stretch_slices(probes[0].second);
+			for(size_t i = 1; i < probes.size(); ++i) {
+				auto other = find_stretch_slices(probes[i].second);
+				found.stretchable = found.stretchable && other.stretchable;
+				found.left = std::max(found.left, other.left);
+				found.top = std::max(found.top, other.top);
+				found.right = std::max(found.right, other.right);
+				found.bottom = std::max(found.bottom, other.bottom);
+			}
+			auto smallest_x = std::ceil(float(found.left + found.right + 1) / unit);
+			auto smallest_y = std::ceil(float(found.top + found.bottom + 1) / unit);
+			for(auto& [color, bmp] : probes) {
+				auto render_at = [&](float size_x, float size_y) {
+					return src->rasterize(size_x, size_y, probe_key.grid_size, probe_key.scale, probe_key.base_width, probe_key.base_height, color);
+				};
+				found.stretchable = found.stretchable
+					&& stretches_to(bmp, found, render_at(smallest_x, smallest_y))
+					&& stretches_to(bmp, found, render_at(probe_key.size_x * 2.0f + 3.0f, probe_key.size_y * 2.0f + 3.0f));
+			}
+			*slices = found;
+			return probes[0].second;
+		});
+		return stretch_render{ };
+	}
+
+	auto& probe = it->second;
+	auto probe_key = key;
+	probe_key.size_x = probe.size_x;
+	probe_key.size_y = probe.size_y;
+	if(probe.pending.valid()) {
+		if(probe.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return stretch_render{ };
+		common_texture_cache::cache.insert(source, probe_key, probe.pending.get());
+	}
+	if(!probe.slices->stretchable)
+		return std::nullopt;
+
+	stretch_render result;
+	result.slices = *probe.slices;
+	result.width = int32_t(probe.size_x * scale * grid_size);
+	result.height = int32_t(probe.size_y * scale * grid_size);
+	// each middle strip needs at least a pixel, or the borders would overlap
+	if(int32_t(size_x * scale * grid_size) <= result.slices.left + result.slices.right || int32_t(size_y * scale * grid_size) <= result.slices.top + result.slices.bottom)
+		return std::nullopt;
+	probe_key.color = color;
+	if(auto region = common_texture_cache::cache.find(source, probe_key); region)
+		result.region = *region;
+	else // another color, blended from the tint layers of the probe, or evicted since and made again like any other render
+		result.region = get_render(probe.size_x, probe.size_y, grid_size, scale, r, g, b);
+	return result;
+}
+
+render_key simple_svg::make_key(int32_t size_x, int32_t size_y, float scale, float r, float g, float b) {
+	if(dependencies) {
+		auto changes = common_file_bank::bank.change_count.load(std::memory_order_acquire);
+		if(changes != dependencies->checked) {
+			std::vector<std::string> file_names;
+			{
+				std::lock_guard lock(dependencies->guard);
+				file_names = dependencies->file_names;
+			}
+			if(common_file_bank::bank.changed_since(file_names, std::exchange(dependencies->checked, changes))) {
+				revision = next_document_revision();
+				// renders still in flight were made from the old files
+				pending_renders.clear();
+			}
+		}
+	}
+
+	render_key key;
+	key.size_x = float(size_x);
+	key.size_y = float(size_y);
+	key.scale = scale;
+	key.color = primarycolor == primarycolor_use::none ? 0 : pack_render_color(r, g, b);
+	key.revision = revision;
+	return key;
+}
+
+void simple_svg::release_renders() {
+	if(svg_data) {
+		common_texture_cache::cache.release_owner(svg_data.get());
+		common_tint_cache::cache.release_owner(svg_data.get());
+	}
+	pending_renders.clear();
+}
+
+ogl::atlas_region simple_svg::collect_pending(render_key const& key) {
+	auto it = pending_renders.find(key);
+	if(it == pending_renders.end())
+		return ogl::atlas_region{ };
+	if(it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return ogl::atlas_region{ };
+
+	auto bmp = it->second.get();
+	pending_renders.erase(it);
+	return common_texture_cache::cache.insert(svg_data, key, bmp);
+}
+
+ogl::atlas_region simple_svg::get_render(int32_t size_x, int32_t size_y, float scale, float r, float g, float b) {
+	if(!svg_data)
+		return ogl::atlas_region{ };
+
+	auto key = make_key(size_x, size_y, scale, r, g, b);
+	if(auto region = common_texture_cache::cache.find(svg_data, key); region) {
+		return *region;
+	}
+	if(pending_renders.find(key) != pending_renders.end()) {
+		return collect_pending(key);
+	}
+	if(primarycolor == primarycolor_use::tinted) {
+		if(auto bmp = common_tint_cache::cache.find(svg_data, key); bmp) {
+			++common_texture_cache::cache.misses;
+			profiler::count(profiler::counter::cache_misses);
+			return common_texture_cache::cache.insert(svg_data, key, *bmp);
+		}
+	}
+	queue_render(size_x, size_y, scale, r, g, b);
+	return ogl::atlas_region{ };
+}
+ogl::atlas_region simple_svg::try_get_render(int32_t size_x, int32_t size_y, float scale, float r, float g, float b) {
+	if(!svg_data)
+		return ogl::atlas_region{ };
+
+	auto key = make_key(size_x, size_y, scale, r, g, b);
+	if(auto region = common_texture_cache::cache.find(svg_data, key); region) {
+		return *region;
+	}
+	return collect_pending(key);
+}
+void simple_svg::queue_render(int32_t size_x, int32_t size_y, float scale, float r, float g, float b) {
+	if(!svg_data || svg_data->size() == 0)
+		return;
+
+	auto key = make_key(size_x, size_y, scale, r, g, b);
+	if(pending_renders.find(key) != pending_renders.end())
+		return;
+	++common_texture_cache::cache.misses;
+	profiler::count(profiler::counter::cache_misses);
+
+	// the job only shares the (immutable) file contents, so it does not depend on this object staying put
+	pending_renders[key] = common_render_pool::pool.submit([data = svg_data, deps = dependencies, use = primarycolor, key]() {
+		simple_svg detached;
+		detached.svg_data = data;
+		detached.dependencies = deps;
+		detached.primarycolor = use;
+		return detached.rasterize_key(key);
+	});
+}
+ogl::atlas_region simple_svg::make_new_render(int32_t size_x, int32_t size_y, float scale, float r, float g, float b) {
+	if(!svg_data || svg_data->size() == 0)
+		return ogl::atlas_region{ };
+
+	profiler::scoped_zone zone("simple_svg::make_new_render");
+	auto key = make_key(size_x, size_y, scale, r, g, b);
+	auto bmp = rasterize_key(key);
+
+	pending_renders.erase(key);
+	++common_texture_cache::cache.misses;
+	profiler::count(profiler::counter::cache_misses);
+
+	return common_texture_cache::cache.insert(svg_data, key, bmp);
+}
+
+}
@@ -0,0 +1,657 @@
+#include <vector>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <algorithm>
+#include <new>
+#include <atomic>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include "filesystem.hpp"
+#include "stools.hpp"
+#include "asvg.hpp"
+#include "templateproject.hpp"
+#include "plutovg.h"
+
+// Headless tool: times each stage of the asvg render pipeline (parse, replacement substitution, layout, rasterize and
+// RGBA conversion) over a matrix of sizes, grid sizes, scales and colors, and reports percentiles and bytes allocated
+// for each stage so that changes to the render path can be compared run to run. Needs no GL context.
+
+// counts everything that goes through operator new; plutovg allocates with malloc, so pixel buffers are not included
+// the render pool and the band threads allocate too, so the counters are atomic
+static std::atomic<uint64_t> allocated_bytes{ 0 };
+static std::atomic<uint64_t> allocation_count{ 0 };
+
+void* operator new(size_t size) {
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if(auto p = std::malloc(size == 0 ? 1 : size); p)
+		return p;
+	throw std::bad_alloc{ };
+}
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+// every delete goes through this one; kept out of line, or gcc pairs the free with a new it sees inlined and warns
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+	operator delete(p);
+}
+void operator delete[](void* p) noexcept {
+	operator delete(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+	operator delete(p);
+}
+
+enum class stage : uint8_t {
+	parse, substitute, layout, rasterize, convert
+};
+constexpr int32_t stage_count = 5;
+constexpr char const* stage_names[stage_count] = { "parse", "substitute", "layout", "rasterize", "convert" };
+
+struct stage_samples {
+	std::vector<double> ms;
+	uint64_t bytes = 0;
+	uint64_t allocations = 0;
+};
+
+struct bench_input {
+	std::string name;
+	std::vector<char> data;
+	std::wstring asset_directory; // where the images it references are loaded from
+	int32_t base_width = 1000;
+	int32_t base_height = 1000;
+};
+
+struct size2 {
+	float x = 0.0f;
+	float y = 0.0f;
+};
+
+// times f and charges its time and allocations to s
+template<typename F>
+static auto measure(stage_samples& s, F&& f) {
+	auto bytes_before = allocated_bytes.load(std::memory_order_relaxed);
+	auto count_before = allocation_count.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	if constexpr(std::is_void_v<decltype(f())>) {
+		f();
+		s.ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		s.bytes += allocated_bytes.load(std::memory_order_relaxed) - bytes_before;
+		s.allocations += allocation_count.load(std::memory_order_relaxed) - count_before;
+	} else {
+		auto result = f();
+		s.ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		s.bytes += allocated_bytes.load(std::memory_order_relaxed) - bytes_before;
+		s.allocations += allocation_count.load(std::memory_order_relaxed) - count_before;
+		return result;
+	}
+}
+
+static double percentile(std::vector<double> const& sorted, double p) {
+	if(sorted.empty())
+		return 0.0;
+	auto index = size_t(p * double(sorted.size() - 1) + 0.5);
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// the synthetic inputs stress the parts of the renderer that the sample files barely touch: nested patterns and
+// gradients, masks and group opacity, and patterns of scanned textures (loaded from the asset directory)
+static char const synthetic_patterns[] = R"svg(<svg xmlns="http://www.w3.org/2000/svg" viewBox="0 0 [[W;1000;0]] [[H;1000;0]] " width="[[W;1000;0]]" height="[[H;1000;0]]">
+	<defs>
+		<linearGradient id="shade" x1="0" y1="0" x2="0" y2="1">
+			<stop offset="0" stop-color="#f4e2b0" />
+			<stop offset="0.5" stop-color="#d4ab31" />
+			<stop offset="1" stop-color="#6b4c10" />
+		</linearGradient>
+		<pattern id="dots" x="0" y="0" width="[[P;8;0]]" height="[[P;8;0]]" patternUnits="userSpaceOnUse">
+			<circle cx="[[P;4;0]]" cy="[[P;4;0]]" r="[[P;2;0]]" class="primarycolor" />
+		</pattern>
+		<pattern id="checks" x="0" y="0" width="[[P;32;0]]" height="[[P;32;0]]" patternUnits="userSpaceOnUse">
+			<rect x="0" y="0" width="[[P;16;0]]" height="[[P;16;0]]" fill="url(#dots)" />
+			<rect x="[[P;16;0]]" y="[[P;16;0]]" width="[[P;16;0]]" height="[[P;16;0]]" fill="url(#shade)" />
+		</pattern>
+	</defs>
+	<rect x="0" y="0" width="[[W;1000;0]]" height="[[H;1000;0]]" rx="60" fill="url(#shade)" />
+	<rect x="40" y="40" width="[[W;1000;-80]]" height="[[H;1000;-80]]" rx="40" fill="url(#checks)" stroke="#000000" stroke-width="[[P;2;0]]" />
+	<rect x="80" y="80" width="[[W;1000;-160]]" height="[[H;1000;-160]]" rx="20" fill="none" class="primarycolor" stroke-width="[[P;1;0]]" stroke-dasharray=" [[P;4;0]] [[P;2;0]] " />
+</svg>
+)svg";
+
+static char const synthetic_masks[] = R"svg(<svg xmlns="http://www.w3.org/2000/svg" viewBox="0 0 [[W;1000;0]] [[H;1000;0]] " width="[[W;1000;0]]" height="[[H;1000;0]]">
+	<defs>
+		<radialGradient id="glow" cx="0.5" cy="0.5" r="0.5">
+			<stop offset="0" stop-color="#ffffff" />
+			<stop offset="1" stop-color="#000000" />
+		</radialGradient>
+		<linearGradient id="fade" x1="0" y1="0" x2="1" y2="0">
+			<stop offset="0" stop-color="#ffffff" stop-opacity="1" />
+			<stop offset="1" stop-color="#ffffff" stop-opacity="0.2" />
+		</linearGradient>
+		<mask id="vignette">
+			<rect x="0" y="0" width="[[W;1000;0]]" height="[[H;1000;0]]" fill="url(#glow)" />
+		</mask>
+		<mask id="sweep">
+			<rect x="0" y="0" width="[[W;1000;0]]" height="[[H;1000;0]]" fill="url(#fade)" />
+		</mask>
+		<clipPath id="inner">
+			<rect x="50" y="50" width="[[W;1000;-100]]" height="[[H;1000;-100]]" rx="50" />
+		</clipPath>
+	</defs>
+	<g mask="url(#vignette)" opacity="0.9">
+		<rect x="0" y="0" width="[[W;1000;0]]" height="[[H;1000;0]]" class="primarycolor" />
+		<g mask="url(#sweep)" clip-path="url(#inner)">
+			<rect x="0" y="0" width="[[W;1000;0]]" height="[[H;1000;0]]" fill="#148ef1" />
+			<circle cx="[[W;500;0]]" cy="[[H;500;0]]" r="[[S;400;0]]" fill="#d4ab31" opacity="0.5" />
+		</g>
+	</g>
+</svg>
+)svg";
+
+static char const synthetic_images[] = R"svg(<svg xmlns="http://www.w3.org/2000/svg" viewBox="0 0 [[W;1000;0]] [[H;1000;0]] " width="[[W;1000;0]]" height="[[H;1000;0]]">
+	<defs>
+		<pattern id="paper" x="0" y="0" width="[[P;256;0]]" height="[[P;256;0]]" patternUnits="userSpaceOnUse">
+			<image href="wcbase.png" width="[[P;256;0]]" height="[[P;256;0]]" />
+		</pattern>
+		<pattern id="wash" x="0" y="0" width="[[P;256;0]]" height="[[P;256;0]]" patternUnits="userSpaceOnUse">
+			<image href="userwatercolor.png" width="[[P;256;0]]" height="[[P;256;0]]" />
+		</pattern>
+		<mask id="stain">
+			<rect x="0" y="0" width="[[W;1000;0]]" height="[[H;1000;0]]" fill="url(#wash)" />
+		</mask>
+	</defs>
+	<rect x="0" y="0" width="[[W;1000;0]]" height="[[H;1000;0]]" fill="url(#paper)" />
+	<rect x="0" y="0" width="[[W;1000;0]]" height="[[H;1000;0]]" class="primarycolor" mask="url(#stain)" />
+	<image href="roughline.png" x="0" y="[[H;1000;-100]]" width="[[W;1000;0]]" height="100" preserveAspectRatio="none" />
+</svg>
+)svg";
+
+// --check-simd: draws single rows with the SSE2 / AVX2 kernels and again with the scalar ones, over every width from 0
+// to 67 and starts that leave the rows misaligned, and reports any byte that differs
+constexpr int32_t check_row_width = 80;
+constexpr int32_t check_max_width = 67;
+constexpr int32_t check_max_start = 7;
+
+// premultiplied pixels; opaque and transparent ones take shortcuts in the kernels, so they come up often
+static uint32_t fuzz_pixel(uint32_t& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	uint32_t a = state >> 24;
+	if((state & 3) == 0)
+		a = 0;
+	else if((state & 3) == 1)
+		a = 255;
+	auto channel = [&](uint32_t shift) { return ((state >> shift) & 0xFF) * a / 255; };
+	return a << 24 | channel(16) << 16 | channel(8) << 8 | channel(0);
+}
+
+static void fill_fuzz(plutovg_surface_t* surface, uint32_t seed) {
+	auto pixels = reinterpret_cast<uint32_t*>(plutovg_surface_get_data(surface));
+	for(int32_t x = 0; x < check_row_width; ++x)
+		pixels[x] = fuzz_pixel(seed);
+}
+
+struct simd_check {
+	char const* name;
+	// draws one row into out, the same way on every call
+	std::function<void(int32_t start, int32_t width, uint32_t variant, std::vector<uint8_t>& out)> run;
+	uint32_t variants = 1;
+};
+
+// draws with paint over a row of fuzz and returns the row
+template<typename F>
+static void draw_row(int32_t start, int32_t width, uint32_t seed, float offset, std::vector<uint8_t>& out, F&& set_paint) {
+	auto surface = plutovg_surface_create(check_row_width, 1);
+	fill_fuzz(surface, seed);
+	auto canvas = plutovg_canvas_create(surface);
+	set_paint(canvas);
+	plutovg_canvas_fill_rect(canvas, float(start) + offset, 0.0f, float(width), 1.0f);
+	plutovg_canvas_destroy(canvas);
+	auto data = plutovg_surface_get_data(surface);
+	out.assign(data, data + check_row_width * 4);
+	plutovg_surface_destroy(surface);
+}
+
+static bool check_simd() {
+	std::vector<simd_check> checks;
+	// solid colors, translucent and opaque, with and without a global opacity
+	checks.push_back(simd_check{ "solid source-over", [](int32_t start, int32_t width, uint32_t variant, std::vector<uint8_t>& out) {
+		float const alphas[] = { 1.0f, 0.6f, 0.01f };
+		draw_row(start, width, 0x9e3779b9u + uint32_t(start * 131 + width), 0.0f, out, [&](plutovg_canvas_t* canvas) {
+			plutovg_canvas_set_rgba(canvas, 0.8f, 0.3f, 0.1f, alphas[variant % 3]);
+			plutovg_canvas_set_opacity(canvas, variant >= 3 ? 0.5f : 1.0f);
+		});
+	}, 6 });
+	// a row of fuzz drawn over another, at whole and quarter pixel offsets so that the ends are partly covered
+	checks.push_back(simd_check{ "fuzz source-over", [](int32_t start, int32_t width, uint32_t variant, std::vector<uint8_t>& out) {
+		auto source = plutovg_surface_create(check_row_width, 1);
+		fill_fuzz(source, 0x85ebca6bu + uint32_t(start * 131 + width));
+		draw_row(start, width, 0xc2b2ae35u + uint32_t(start * 131 + width), (variant & 1) ? 0.25f : 0.0f, out, [&](plutovg_canvas_t* canvas) {
+			plutovg_canvas_set_texture(canvas, source, PLUTOVG_TEXTURE_TYPE_PLAIN, (variant & 2) ? 0.5f : 1.0f, nullptr);
+		});
+		plutovg_surface_destroy(source);
+	}, 4 });
+	// a gradient shorter than the row, so that every spread method wraps or clamps within it
+	checks.push_back(simd_check{ "linear gradient", [](int32_t start, int32_t width, uint32_t variant, std::vector<uint8_t>& out) {
+		plutovg_gradient_stop_t const stops[] = {
+			{ 0.0f, { 1.0f, 0.0f, 0.0f, 1.0f } },
+			{ 0.4f, { 0.1f, 0.9f, 0.3f, 0.5f } },
+			{ 1.0f, { 0.0f, 0.2f, 1.0f, 1.0f } }
+		};
+		plutovg_spread_method_t const spreads[] = { PLUTOVG_SPREAD_METHOD_PAD, PLUTOVG_SPREAD_METHOD_REFLECT, PLUTOVG_SPREAD_METHOD_REPEAT };
+		draw_row(start, width, 0x27d4eb2fu + uint32_t(start * 131 + width), 0.0f, out, [&](plutovg_canvas_t* canvas) {
+			auto x1 = float(start) + 2.5f;
+			auto x2 = x1 + ((variant >= 3) ? -13.0f : 17.0f);
+			plutovg_canvas_set_linear_gradient(canvas, x1, 0.0f, x2, 0.5f, spreads[variant % 3], stops, 3, nullptr);
+		});
+	}, 6 });
+	checks.push_back(simd_check{ "argb to rgba", [](int32_t start, int32_t width, uint32_t, std::vector<uint8_t>& out) {
+		std::vector<uint32_t> source(check_row_width);
+		uint32_t seed = 0x165667b1u + uint32_t(start * 131 + width);
+		for(auto& p : source)
+			p = fuzz_pixel(seed);
+		out.assign(check_row_width * 4, 0xCD);
+		plutovg_convert_argb_to_rgba(out.data() + start * 4, reinterpret_cast<unsigned char const*>(source.data() + start), width, 1, check_row_width * 4);
+	} });
+
+	int32_t compared = 0;
+	int32_t mismatches = 0;
+	std::vector<uint8_t> vectorized;
+	std::vector<uint8_t> scalar;
+	for(auto& c : checks) {
+		for(uint32_t variant = 0; variant < c.variants; ++variant) {
+			for(int32_t start = 0; start <= check_max_start; ++start) {
+				for(int32_t width = 0; width <= check_max_width; ++width) {
+					plutovg_set_simd_enabled(true);
+					c.run(start, width, variant, vectorized);
+					plutovg_set_simd_enabled(false);
+					c.run(start, width, variant, scalar);
+					++compared;
+					if(vectorized == scalar)
+						continue;
+					auto first = std::mismatch(vectorized.begin(), vectorized.end(), scalar.begin()).first - vectorized.begin();
+					if(++mismatches <= 20) {
+						std::printf("%s (variant %u): start %d width %d differs at byte %d: %02x simd, %02x scalar\n",
+							c.name, variant, start, width, int32_t(first), vectorized[first], scalar[first]);
+					}
+				}
+			}
+		}
+	}
+	plutovg_set_simd_enabled(true);
+	std::printf("simd check: %d rows compared, %d differ\n", compared, mismatches);
+	return mismatches == 0;
+}
+
+// decodes every entry through the lazy reader, to compare against the eager one
+static template_project::project project_from_view(template_project::project_view const& view) {
+	using template_project::template_type;
+	template_project::project result;
+	result.svg_directory = view.svg_directory();
+	for(uint32_t i = 0; i < view.count(template_type::color); ++i)
+		result.colors.push_back(view.color(i));
+	for(uint32_t i = 0; i < view.count(template_type::icon); ++i)
+		result.icons.push_back(view.icon(i));
+	for(uint32_t i = 0; i < view.count(template_type::background); ++i)
+		result.backgrounds.push_back(view.background(i));
+	for(uint32_t i = 0; i < view.count(template_type::label); ++i)
+		result.label_t.push_back(view.label(i));
+	for(uint32_t i = 0; i < view.count(template_type::button); ++i)
+		result.button_t.push_back(view.button(i));
+	for(uint32_t i = 0; i < view.count(template_type::progress_bar); ++i)
+		result.progress_bar_t.push_back(view.progress_bar(i));
+	for(uint32_t i = 0; i < view.count(template_type::window); ++i)
+		result.window_t.push_back(view.window(i));
+	for(uint32_t i = 0; i < view.count(template_type::iconic_button); ++i)
+		result.iconic_button_t.push_back(view.iconic_button(i));
+	for(uint32_t i = 0; i < view.count(template_type::layout_region); ++i)
+		result.layout_region_t.push_back(view.layout_region(i));
+	for(uint32_t i = 0; i < view.count(template_type::mixed_button); ++i)
+		result.mixed_button_t.push_back(view.mixed_button(i));
+	for(uint32_t i = 0; i < view.count(template_type::toggle_button); ++i)
+		result.toggle_button_t.push_back(view.toggle_button(i));
+	return result;
+}
+
+// two projects are the same when they are written out to the same bytes
+static bool same_project(template_project::project const& a, template_project::project const& b) {
+	serialization::out_buffer a_bytes;
+	serialization::out_buffer b_bytes;
+	template_project::project_to_bytes(a, a_bytes);
+	template_project::project_to_bytes(b, b_bytes);
+	return a_bytes.size() == b_bytes.size() && std::memcmp(a_bytes.data(), b_bytes.data(), a_bytes.size()) == 0;
+}
+
+// every name has to lead back to an entry with that name
+static bool names_resolve(template_project::project_view const& view) {
+	for(uint32_t t = uint32_t(template_project::template_type::background); t <= uint32_t(template_project::template_type::toggle_button); ++t) {
+		auto type = template_project::template_type(t);
+		for(uint32_t i = 0; i < view.count(type); ++i) {
+			auto found = view.find(type, view.name(type, i));
+			if(found < 0 || view.name(type, uint32_t(found)) != view.name(type, i))
+				return false;
+		}
+	}
+	return true;
+}
+
+// reads a project with both readers: as it is on disk, written again in the current format, and cut back to the layout
+// from before the table of contents; all of them have to decode to the same project
+static bool check_project(std::string const& file_name) {
+	fs::file loaded{ fs::utf8_to_native(file_name) };
+	if(!loaded.content().data) {
+		std::fprintf(stderr, "could not open %s\n", file_name.c_str());
+		return false;
+	}
+	std::vector<char> original(loaded.content().data, loaded.content().data + loaded.content().file_size);
+	serialization::in_buffer original_buffer{ original.data(), original.size() };
+	auto reference = template_project::bytes_to_project(original_buffer);
+
+	serialization::out_buffer written;
+	template_project::project_to_bytes(reference, written);
+	std::vector<char> current(written.data(), written.data() + written.size());
+
+	// the legacy layout is everything after the magic, version, row count and the table rows
+	serialization::in_buffer header{ current.data(), current.size() };
+	bool has_magic = header.read<uint32_t>() == template_project::tui_magic;
+	header.read<uint32_t>();
+	auto table_end = std::min(size_t(3 + 4 * header.read<uint32_t>()) * sizeof(uint32_t), current.size());
+	std::vector<char> legacy(current.begin() + table_end, current.end());
+
+	struct {
+		char const* name;
+		std::vector<char> const& bytes;
+	} const formats[] = { { "as read", original }, { "current", current }, { "legacy", legacy } };
+
+	bool passed = has_magic;
+	if(!has_magic)
+		std::printf("project check: written file does not start with the format magic\n");
+	for(auto& f : formats) {
+		serialization::in_buffer eager_buffer{ f.bytes.data(), f.bytes.size() };
+		auto eager = template_project::bytes_to_project(eager_buffer);
+		template_project::project_view view{ f.bytes.data(), f.bytes.size() };
+		bool eager_matches = same_project(eager, reference);
+		bool view_matches = same_project(project_from_view(view), reference);
+		bool names_match = names_resolve(view);
+		std::printf("project check (%s): eager reader %s, lazy reader %s, names %s\n", f.name,
+			eager_matches ? "matches" : "differs", view_matches ? "matches" : "differs", names_match ? "resolve" : "do not resolve");
+		passed = passed && eager_matches && view_matches && names_match;
+	}
+	return passed;
+}
+
+static void print_usage() {
+	std::fprintf(stderr,
+		"usage: benchmark [options] [input ...]\n"
+		"  --iterations N   times each combination is rendered (default 5)\n"
+		"  --size WxH       size in grid units (repeatable, default 2x1 8x4 30x10)\n"
+		"  --grid N         grid size (repeatable, default 8 16 32 57)\n"
+		"  --scale S        ui scale (repeatable, default 1 2)\n"
+		"  --color R,G,B    primary color, 0 to 1 (repeatable, default 0,0,0 and 0.8,0.2,0.1)\n"
+		"  --base WxH       base size of the inputs listed after it (default 1000x1000)\n"
+		"  --assets DIR     where the synthetic inputs load their images from (default scraps/)\n"
+		"  --no-synthetic   skip the built in synthetic inputs\n"
+		"  --no-simd        run plutovg without its SSE2 / AVX2 paths\n"
+		"  --check-simd     compare the SSE2 / AVX2 paths against the scalar ones byte for byte, then exit\n"
+		"  --check-project FILE  read a .tui with both project readers, in the current and the legacy format, then exit\n"
+		"  --no-pattern-cache  draw pattern tiles again on every render instead of reusing them\n"
+		"  --no-image-cache    decode referenced images again on every parse instead of sharing them\n"
+		"  --no-stroke-cache   stroke and rasterize every stroke again instead of reusing its coverage\n"
+		"  --render-threads N  threads that one large fill may be split across (default: all, 1 draws serially)\n"
+		"  --csv FILE       also write one line per input and stage for comparing runs\n"
+		"Inputs are .svg or .asvg files; images they reference are loaded from their directory. When no input is given,\n"
+		"test_base.svg and the files in asvg/ are used.\n");
+}
+
+static bool parse_float(std::string_view text, float& out) {
+	auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+	return result.ec == std::errc{ } && result.ptr == text.data() + text.size();
+}
+
+static bool parse_int(std::string_view text, int32_t& out) {
+	auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+	return result.ec == std::errc{ } && result.ptr == text.data() + text.size();
+}
+
+static bool parse_pair(std::string_view text, char separator, float& x, float& y) {
+	auto sep = text.find(separator);
+	if(sep == std::string_view::npos)
+		return false;
+	return parse_float(text.substr(0, sep), x) && parse_float(text.substr(sep + 1), y);
+}
+
+static bool parse_color(std::string_view text, color3f& out) {
+	auto first = text.find(',');
+	if(first == std::string_view::npos)
+		return false;
+	return parse_float(text.substr(0, first), out.r) && parse_pair(text.substr(first + 1), ',', out.g, out.b);
+}
+
+static bool load_input(std::string const& file_name, int32_t base_width, int32_t base_height, std::vector<bench_input>& inputs) {
+	auto native_name = fs::utf8_to_native(file_name);
+	fs::file f{ native_name };
+	if(!f.content().data) {
+		std::fprintf(stderr, "could not open %s\n", file_name.c_str());
+		return false;
+	}
+	bench_input in;
+	in.name = file_name;
+	in.data.assign(f.content().data, f.content().data + f.content().file_size);
+	auto breakpt = native_name.find_last_of(L"\\/");
+	in.asset_directory = breakpt == std::wstring::npos ? std::wstring{ } : native_name.substr(0, breakpt + 1);
+	in.base_width = base_width;
+	in.base_height = base_height;
+	inputs.push_back(std::move(in));
+	return true;
+}
+
+static void use_asset_directory(std::wstring const& directory) {
+	asvg::common_file_bank::bank.set_root_directory(directory);
+}
+
+int main(int argc, char** argv) {
+	int32_t iterations = 5;
+	std::vector<size2> sizes;
+	std::vector<int32_t> grid_sizes;
+	std::vector<float> scales;
+	std::vector<color3f> colors;
+	std::vector<bench_input> inputs;
+	std::wstring synthetic_assets = L"scraps/";
+	std::string csv_file;
+	bool synthetic = true;
+	int32_t base_width = 1000;
+	int32_t base_height = 1000;
+
+	for(int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if(arg == "--iterations" && has_value) {
+			if(!parse_int(argv[++i], iterations) || iterations <= 0) {
+				print_usage();
+				return 1;
+			}
+		} else if(arg == "--size" && has_value) {
+			size2 sz;
+			if(!parse_pair(argv[++i], 'x', sz.x, sz.y)) {
+				print_usage();
+				return 1;
+			}
+			sizes.push_back(sz);
+		} else if(arg == "--grid" && has_value) {
+			int32_t g = 0;
+			if(!parse_int(argv[++i], g) || g <= 0) {
+				print_usage();
+				return 1;
+			}
+			grid_sizes.push_back(g);
+		} else if(arg == "--scale" && has_value) {
+			float s = 0.0f;
+			if(!parse_float(argv[++i], s) || s <= 0.0f) {
+				print_usage();
+				return 1;
+			}
+			scales.push_back(s);
+		} else if(arg == "--color" && has_value) {
+			color3f c;
+			if(!parse_color(argv[++i], c)) {
+				print_usage();
+				return 1;
+			}
+			colors.push_back(c);
+		} else if(arg == "--base" && has_value) {
+			float bw = 0.0f;
+			float bh = 0.0f;
+			if(!parse_pair(argv[++i], 'x', bw, bh) || bw < 1.0f || bh < 1.0f) {
+				print_usage();
+				return 1;
+			}
+			base_width = int32_t(bw);
+			base_height = int32_t(bh);
+		} else if(arg == "--assets" && has_value) {
+			synthetic_assets = fs::utf8_to_native(argv[++i]);
+			if(!synthetic_assets.empty() && synthetic_assets.back() != L'/' && synthetic_assets.back() != L'\\')
+				synthetic_assets += L'/';
+		} else if(arg == "--csv" && has_value) {
+			csv_file = argv[++i];
+		} else if(arg == "--no-synthetic") {
+			synthetic = false;
+		} else if(arg == "--no-simd") {
+			plutovg_set_simd_enabled(false);
+		} else if(arg == "--check-simd") {
+			return check_simd() ? 0 : 1;
+		} else if(arg == "--check-project" && has_value) {
+			return check_project(argv[++i]) ? 0 : 1;
+		} else if(arg == "--no-pattern-cache") {
+			lunasvg_set_pattern_cache_budget(0);
+		} else if(arg == "--no-image-cache") {
+			asvg::common_file_bank::bank.image_budget = 0;
+		} else if(arg == "--no-stroke-cache") {
+			lunasvg_set_stroke_cache_budget(0);
+		} else if(arg == "--render-threads" && has_value) {
+			int32_t t = 0;
+			if(!parse_int(argv[++i], t) || t <= 0) {
+				print_usage();
+				return 1;
+			}
+			lunasvg_set_render_threads(t);
+		} else if(arg.size() > 2 && arg.substr(0, 2) == "--") {
+			print_usage();
+			return 1;
+		} else {
+			if(!load_input(std::string(arg), base_width, base_height, inputs))
+				return 1;
+		}
+	}
+	if(sizes.empty())
+		sizes = { size2{ 2.0f, 1.0f }, size2{ 8.0f, 4.0f }, size2{ 30.0f, 10.0f } };
+	if(grid_sizes.empty())
+		grid_sizes = { 8, 16, 32, 57 };
+	if(scales.empty())
+		scales = { 1.0f, 2.0f };
+	if(colors.empty())
+		colors = { color3f{ 0.0f, 0.0f, 0.0f }, color3f{ 0.8f, 0.2f, 0.1f } };
+	if(inputs.empty()) {
+		for(auto name : { "test_base.svg", "asvg/test1.asvg", "asvg/test2.asvg", "asvg/testX.svg" }) {
+			if(!load_input(name, base_width, base_height, inputs))
+				return 1;
+		}
+	}
+	if(synthetic) {
+		for(auto [name, text] : { std::pair{ "synthetic: patterns", synthetic_patterns }, std::pair{ "synthetic: masks", synthetic_masks }, std::pair{ "synthetic: images", synthetic_images } }) {
+			bench_input in;
+			in.name = name;
+			in.data.assign(text, text + std::strlen(text));
+			in.asset_directory = synthetic_assets;
+			inputs.push_back(std::move(in));
+		}
+	}
+
+	FILE* csv = nullptr;
+	if(!csv_file.empty()) {
+		csv = std::fopen(csv_file.c_str(), "w");
+		if(!csv) {
+			std::fprintf(stderr, "could not write %s\n", csv_file.c_str());
+			return 1;
+		}
+		std::fprintf(csv, "input,stage,samples,p50 ms,p90 ms,p99 ms,max ms,bytes per call,allocations per call\n");
+	}
+
+	auto combinations = sizes.size() * grid_sizes.size() * scales.size() * colors.size();
+	std::printf("%d inputs, %d combinations, %d iterations each\n", int32_t(inputs.size()), int32_t(combinations), iterations);
+
+	for(auto& in : inputs) {
+		use_asset_directory(in.asset_directory);
+		stage_samples samples[stage_count];
+		bool reparsed_each_time = false;
+		uint64_t pixels = 0;
+
+		for(int32_t it = 0; it < iterations; ++it) {
+			// parsed anew each iteration so that the first render after a parse is measured as well
+			auto source = measure(samples[int32_t(stage::parse)], [&]() {
+				return std::make_unique<asvg::svg_source>(in.data.data(), in.data.size(), in.base_width, in.base_height);
+			});
+			reparsed_each_time = !source->templated;
+
+			for(auto sz : sizes) {
+				for(auto g : grid_sizes) {
+					for(auto sc : scales) {
+						for(auto c : colors) {
+							auto copy = source->acquire_template();
+							std::unique_ptr<lunasvg::Document> reparsed;
+							auto doc = measure(samples[int32_t(stage::substitute)], [&]() {
+								auto d = source->apply_replacements(copy.get(), sz.x, sz.y, g, in.base_width, in.base_height, reparsed);
+								if(d)
+									d->applyStyleSheet(asvg::color_stylesheet(c.r, c.g, c.b));
+								return d;
+							});
+							if(!doc) {
+								std::fprintf(stderr, "could not parse %s\n", in.name.c_str());
+								return 1;
+							}
+							measure(samples[int32_t(stage::layout)], [&]() {
+								doc->updateLayout();
+							});
+							auto bmp = measure(samples[int32_t(stage::rasterize)], [&]() {
+								lunasvg::Bitmap b(int32_t(sz.x * sc * g), int32_t(sz.y * sc * g));
+								doc->render(b, lunasvg::Matrix{ }.scale(sc * float(g) / 500.0f, sc * float(g) / 500.0f));
+								return b;
+							});
+							measure(samples[int32_t(stage::convert)], [&]() {
+								bmp.convertToRGBA();
+							});
+							pixels += uint64_t(bmp.width()) * uint64_t(bmp.height());
+							source->release_template(std::move(copy));
+						}
+					}
+				}
+			}
+		}
+
+		std::printf("\n%s%s -- %.1f Mpixels\n", in.name.c_str(), reparsed_each_time ? " (no template, reparsed for every render)" : "", double(pixels) / 1.0e6);
+		std::printf("  %-10s %8s %10s %10s %10s %10s %14s %10s\n", "stage", "samples", "p50 ms", "p90 ms", "p99 ms", "max ms", "bytes/call", "allocs/call");
+		for(int32_t s = 0; s < stage_count; ++s) {
+			auto& ms = samples[s].ms;
+			std::sort(ms.begin(), ms.end());
+			auto calls = std::max(ms.size(), size_t(1));
+			auto bytes_per_call = double(samples[s].bytes) / double(calls);
+			auto allocs_per_call = double(samples[s].allocations) / double(calls);
+			std::printf("  %-10s %8d %10.3f %10.3f %10.3f %10.3f %14.0f %10.1f\n", stage_names[s], int32_t(ms.size()),
+				percentile(ms, 0.5), percentile(ms, 0.9), percentile(ms, 0.99), ms.empty() ? 0.0 : ms.back(), bytes_per_call, allocs_per_call);
+			if(csv) {
+				std::fprintf(csv, "\"%s\",%s,%d,%.4f,%.4f,%.4f,%.4f,%.0f,%.1f\n", in.name.c_str(), stage_names[s], int32_t(ms.size()),
+					percentile(ms, 0.5), percentile(ms, 0.9), percentile(ms, 0.99), ms.empty() ? 0.0 : ms.back(), bytes_per_call, allocs_per_call);
+			}
+		}
+	}
+
+	if(csv)
+		std::fclose(csv);
+	return 0;
+}
@@ -1,9 +1,19 @@
 #include "filesystem.hpp"
+#ifdef _WIN32
 #include <shobjidl.h> 
+#else
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include <memory>
 
 namespace fs {
 
+#ifdef _WIN32
+
 std::wstring pick_existing_file(std::wstring extension) {
         // CREATE FileOpenDialog OBJECT
         IFileOpenDialog* f_FileSystem;
@@ -365,6 +375,48 @@ void write_file(std::wstring const& full_path, char const* file_data, uint32_t f
         }
 }
 
+directory_watcher::directory_watcher() {
+}
+
+directory_watcher::~directory_watcher() {
+        clear();
+}
+
+void directory_watcher::watch(std::wstring const& directory) {
+        for(auto& w : watches) {
+                if(w.first == directory)
+                        return;
+        }
+        auto handle = FindFirstChangeNotificationW(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+        if(handle != INVALID_HANDLE_VALUE)
+                watches.emplace_back(directory, handle);
+}
+
+void directory_watcher::clear() {
+        for(auto& w : watches)
+                FindCloseChangeNotification(w.second);
+        watches.clear();
+}
+
+std::vector<std::wstring> directory_watcher::poll() {
+        // change notifications only say that something in the directory changed
+        std::vector<std::wstring> changed;
+        for(auto& w : watches) {
+                if(WaitForSingleObject(w.second, 0) == WAIT_OBJECT_0) {
+                        changed.push_back(w.first);
+                        FindNextChangeNotification(w.second);
+                }
+        }
+        return changed;
+}
+
+int64_t last_write_time(std::wstring const& full_path) {
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if(GetFileAttributesExW(full_path.c_str(), GetFileExInfoStandard, &attributes) == 0)
+                return 0;
+        return int64_t((uint64_t(attributes.ftLastWriteTime.dwHighDateTime) << 32) | uint64_t(attributes.ftLastWriteTime.dwLowDateTime));
+}
+
 std::wstring utf8_to_native(std::string_view str) {
         if(str.size() > 0) {
                 auto buffer = std::unique_ptr<WCHAR[]>(new WCHAR[str.length() * 2]);
@@ -383,4 +435,179 @@ std::string native_to_utf8(std::wstring_view str) {
         return std::string{ };
 }
 
+#else
+
+// paths stored in project files use windows separators
+static std::string posix_path(std::wstring const& full_path) {
+        auto result = native_to_utf8(full_path);
+        for(auto& c : result) {
+                if(c == '\\')
+                        c = '/';
+        }
+        return result;
+}
+
+file::~file() {
+        if(contents.data)
+                munmap((void*)(contents.data), size_t(contents.file_size));
+        if(file_descriptor != -1)
+                close(file_descriptor);
+}
+
+file::file(file&& other) noexcept {
+        file_descriptor = other.file_descriptor;
+        other.file_descriptor = -1;
+        contents = other.contents;
+        other.contents.data = nullptr;
+        other.contents.file_size = 0;
+}
+void file::operator=(file&& other) noexcept {
+        if(contents.data)
+                munmap((void*)(contents.data), size_t(contents.file_size));
+        if(file_descriptor != -1)
+                close(file_descriptor);
+        file_descriptor = other.file_descriptor;
+        other.file_descriptor = -1;
+        contents = other.contents;
+        other.contents.data = nullptr;
+        other.contents.file_size = 0;
+}
+
+file::file(std::wstring const& full_path) {
+        file_descriptor = open(posix_path(full_path).c_str(), O_RDONLY);
+        if(file_descriptor != -1) {
+                struct stat sb;
+                if(fstat(file_descriptor, &sb) == 0 && sb.st_size > 0) {
+                        auto mapped = mmap(nullptr, size_t(sb.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+                        if(mapped != MAP_FAILED) {
+                                contents.data = (char const*)mapped;
+                                contents.file_size = uint32_t(sb.st_size);
+                        }
+                }
+        }
+}
+
+void write_file(std::wstring const& full_path, char const* file_data, uint32_t file_size) {
+        int fd = open(posix_path(full_path).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd != -1) {
+                uint32_t written_bytes = 0;
+                while(written_bytes < file_size) {
+                        auto result = write(fd, file_data + written_bytes, size_t(file_size - written_bytes));
+                        if(result <= 0)
+                                break;
+                        written_bytes += uint32_t(result);
+                }
+                close(fd);
+        }
+}
+
+directory_watcher::directory_watcher() {
+        inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+directory_watcher::~directory_watcher() {
+        clear();
+        if(inotify_descriptor != -1)
+                close(inotify_descriptor);
+}
+
+void directory_watcher::watch(std::wstring const& directory) {
+        if(inotify_descriptor == -1)
+                return;
+        for(auto& w : watches) {
+                if(w.second == directory)
+                        return;
+        }
+        auto descriptor = inotify_add_watch(inotify_descriptor, posix_path(directory).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM);
+        if(descriptor != -1)
+                watches.emplace_back(descriptor, directory);
+}
+
+void directory_watcher::clear() {
+        for(auto& w : watches)
+                inotify_rm_watch(inotify_descriptor, w.first);
+        watches.clear();
+}
+
+std::vector<std::wstring> directory_watcher::poll() {
+        std::vector<std::wstring> changed;
+        if(inotify_descriptor == -1)
+                return changed;
+        alignas(inotify_event) char buffer[4096];
+        while(true) {
+                auto length = read(inotify_descriptor, buffer, sizeof(buffer));
+                if(length <= 0)
+                        break;
+                for(ssize_t offset = 0; offset < length; ) {
+                        auto event = reinterpret_cast<inotify_event const*>(buffer + offset);
+                        offset += ssize_t(sizeof(inotify_event) + event->len);
+                        for(auto& w : watches) {
+                                if(w.first != event->wd)
+                                        continue;
+                                if(event->len > 0)
+                                        changed.push_back(w.second + utf8_to_native(event->name));
+                                else
+                                        changed.push_back(w.second);
+                        }
+                }
+        }
+        return changed;
+}
+
+int64_t last_write_time(std::wstring const& full_path) {
+        struct stat sb;
+        if(stat(posix_path(full_path).c_str(), &sb) != 0)
+                return 0;
+        return int64_t(sb.st_mtim.tv_sec) * 1000000000 + int64_t(sb.st_mtim.tv_nsec);
+}
+
+std::wstring utf8_to_native(std::string_view str) {
+        std::wstring result;
+        for(size_t i = 0; i < str.size(); ) {
+                uint32_t cp = uint8_t(str[i]);
+                size_t extra = 0;
+                if(cp >= 0xF0) {
+                        cp &= 0x07;
+                        extra = 3;
+                } else if(cp >= 0xE0) {
+                        cp &= 0x0F;
+                        extra = 2;
+                } else if(cp >= 0xC0) {
+                        cp &= 0x1F;
+                        extra = 1;
+                }
+                ++i;
+                for(; extra > 0 && i < str.size(); --extra, ++i) {
+                        cp = (cp << 6) | (uint8_t(str[i]) & 0x3F);
+                }
+                result.push_back(wchar_t(cp));
+        }
+        return result;
+}
+
+std::string native_to_utf8(std::wstring_view str) {
+        std::string result;
+        for(auto c : str) {
+                auto cp = uint32_t(c);
+                if(cp < 0x80) {
+                        result.push_back(char(cp));
+                } else if(cp < 0x800) {
+                        result.push_back(char(0xC0 | (cp >> 6)));
+                        result.push_back(char(0x80 | (cp & 0x3F)));
+                } else if(cp < 0x10000) {
+                        result.push_back(char(0xE0 | (cp >> 12)));
+                        result.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+                        result.push_back(char(0x80 | (cp & 0x3F)));
+                } else {
+                        result.push_back(char(0xF0 | (cp >> 18)));
+                        result.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+                        result.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+                        result.push_back(char(0x80 | (cp & 0x3F)));
+                }
+        }
+        return result;
+}
+
+#endif
+
 }
@@ -1,20 +1,30 @@
 #pragma once
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <Windows.h>
 #include <shellscalingapi.h>
+#endif
 #include <string>
+#include <vector>
+#include <cstdint>
 
 namespace fs {
 
+#ifdef _WIN32
 std::wstring pick_existing_file(std::wstring extension);
 std::wstring pick_existing_file_from_folder(std::wstring extension, std::wstring const& directory);
 std::wstring pick_new_file(std::wstring extension);
 std::wstring pick_directory(std::wstring const& default_folder);
+#endif
 
 class file {
+#ifdef _WIN32
 	HANDLE file_handle = INVALID_HANDLE_VALUE;
 	HANDLE mapping_handle = nullptr;
+#else
+	int file_descriptor = -1;
+#endif
 	struct {
 		char const* data = nullptr;
 		uint32_t file_size = 0;
@@ -32,7 +42,30 @@ public:
 	}
 };
 
+// reports changes to the files in a set of directories (not their subdirectories) without blocking
+class directory_watcher {
+#ifdef _WIN32
+	std::vector<std::pair<std::wstring, HANDLE>> watches;
+#else
+	int inotify_descriptor = -1;
+	std::vector<std::pair<int, std::wstring>> watches;
+#endif
+public:
+	directory_watcher();
+	directory_watcher(directory_watcher const& other) = delete;
+	void operator=(directory_watcher const& other) = delete;
+	~directory_watcher();
+
+	// directory ends with a separator; watching the same directory again does nothing
+	void watch(std::wstring const& directory);
+	void clear();
+	// everything that may have changed since the last poll: single files where the platform can tell, otherwise whole directories
+	std::vector<std::wstring> poll();
+};
+
 void write_file(std::wstring const& full_path, char const* file_data, uint32_t file_size);
+// platform-specific units, so only compare results for the same file; 0 when the file is missing
+int64_t last_write_time(std::wstring const& full_path);
 std::wstring utf8_to_native(std::string_view str);
 std::string native_to_utf8(std::wstring_view str);
 
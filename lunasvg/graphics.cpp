@@ -3,6 +3,7 @@
 
 #include <cfloat>
 #include <cmath>
+#include <cstring>
 
 namespace lunasvg {
 
@@ -488,21 +489,246 @@ float Font::measureText(const std::u32string_view& text) const
     return 0;
 }
 
+RenderContext& RenderContext::current()
+{
+    static thread_local RenderContext context;
+    return context;
+}
+
+int RenderContext::sizeClass(int pixels)
+{
+    int sizeClass = kSmallestSizeClass;
+    while(sizeClass <= kLargestSizeClass && (1 << sizeClass) < pixels)
+        ++sizeClass;
+    return sizeClass;
+}
+
+plutovg_surface_t* RenderContext::acquireSurface(int width, int height)
+{
+    if(width <= 0 || height <= 0)
+        return nullptr;
+    auto sizeClass = RenderContext::sizeClass(width * height);
+    if(sizeClass > kLargestSizeClass)
+        return plutovg_surface_create(width, height);
+
+    // a surface may still be referenced by a paint that has not been replaced yet, and those are skipped
+    auto& surfaces = m_surfaces[sizeClass - kSmallestSizeClass];
+    for(auto it = surfaces.rbegin(); it != surfaces.rend(); ++it) {
+        auto surface = *it;
+        if(plutovg_surface_reshape(surface, width, height)) {
+            *it = surfaces.back();
+            surfaces.pop_back();
+            m_bytesPooled -= size_t(plutovg_surface_get_capacity(surface)) * 4;
+            return surface;
+        }
+    }
+
+    return plutovg_surface_create_with_capacity(width, height, 1 << sizeClass);
+}
+
+void RenderContext::releaseSurface(plutovg_surface_t* surface)
+{
+    if(surface == nullptr)
+        return;
+    auto capacity = plutovg_surface_get_capacity(surface);
+    auto sizeClass = RenderContext::sizeClass(capacity);
+    auto bytes = size_t(capacity) * 4;
+    if(sizeClass > kLargestSizeClass || capacity != (1 << sizeClass) || m_bytesPooled + bytes > kMaxPooledBytes) {
+        plutovg_surface_destroy(surface);
+        return;
+    }
+
+    m_surfaces[sizeClass - kSmallestSizeClass].push_back(surface);
+    m_bytesPooled += bytes;
+}
+
+plutovg_canvas_t* RenderContext::acquireCanvas(plutovg_surface_t* surface)
+{
+    if(m_canvases.empty())
+        return plutovg_canvas_create(surface);
+    auto canvas = m_canvases.back();
+    m_canvases.pop_back();
+    plutovg_canvas_reset(canvas, surface);
+    return canvas;
+}
+
+void RenderContext::releaseCanvas(plutovg_canvas_t* canvas)
+{
+    if(m_canvases.size() >= kMaxPooledCanvases) {
+        plutovg_canvas_destroy(canvas);
+        return;
+    }
+
+    // dropping the surface and the paints now lets the surfaces they hold go back to the pool
+    plutovg_canvas_reset(canvas, nullptr);
+    m_canvases.push_back(canvas);
+}
+
+void* RenderContext::allocateBlock(size_t size)
+{
+    if(size > kBlockSize || m_blocks == nullptr)
+        return ::operator new(std::max(size, kBlockSize));
+    auto block = m_blocks;
+    m_blocks = block->next;
+    --m_blockCount;
+    return block;
+}
+
+void RenderContext::releaseBlock(void* block, size_t size)
+{
+    if(size > kBlockSize || m_blockCount >= kMaxPooledBlocks) {
+        ::operator delete(block);
+        return;
+    }
+
+    auto freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = m_blocks;
+    m_blocks = freeBlock;
+    ++m_blockCount;
+}
+
+RenderContext::~RenderContext()
+{
+    while(m_blocks) {
+        auto next = m_blocks->next;
+        ::operator delete(m_blocks);
+        m_blocks = next;
+    }
+    for(auto canvas : m_canvases)
+        plutovg_canvas_destroy(canvas);
+    for(auto& surfaces : m_surfaces) {
+        for(auto surface : surfaces) {
+            plutovg_surface_destroy(surface);
+        }
+    }
+}
+
+RenderThreads& RenderThreads::instance()
+{
+    static RenderThreads threads;
+    return threads;
+}
+
+RenderThreads::RenderThreads()
+{
+    setThreadCount(int(std::thread::hardware_concurrency()));
+}
+
+// large draws are split across threads from the start; lunasvg_set_render_threads() changes how many
+[[maybe_unused]] static RenderThreads& renderThreads = RenderThreads::instance();
+
+RenderThreads::~RenderThreads()
+{
+    plutovg_set_parallel_func(nullptr, nullptr, 1);
+    stopHelpers();
+}
+
+void RenderThreads::setThreadCount(int count)
+{
+    count = std::max(count, 1);
+    plutovg_set_parallel_func(nullptr, nullptr, 1);
+    stopHelpers();
+    {
+        std::lock_guard lock(m_mutex);
+        m_threadCount = count;
+    }
+
+    if(count > 1) {
+        plutovg_set_parallel_func([](void* closure, int count, void (*task)(void*, int), void* data) {
+            static_cast<RenderThreads*>(closure)->run(count, task, data);
+        }, this, count);
+    }
+}
+
+void RenderThreads::Job::work()
+{
+    for(int index = next.fetch_add(1); index < count; index = next.fetch_add(1)) {
+        task(data, index);
+    }
+}
+
+void RenderThreads::run(int count, void (*task)(void*, int), void* data)
+{
+    Job job;
+    job.task = task;
+    job.data = data;
+    job.count = count;
+    {
+        std::lock_guard lock(m_mutex);
+        // the helpers start with the first large draw rather than with the program
+        while(int(m_helpers.size()) < m_threadCount - 1 && !m_stopping)
+            m_helpers.emplace_back(&RenderThreads::helperLoop, this);
+        m_jobs.push_back(&job);
+    }
+
+    m_wake.notify_all();
+    job.work();
+
+    std::unique_lock lock(m_mutex);
+    m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &job));
+    m_finished.wait(lock, [&job] { return job.helpers == 0; });
+}
+
+void RenderThreads::helperLoop()
+{
+    std::unique_lock lock(m_mutex);
+    while(true) {
+        Job* job = nullptr;
+        for(auto candidate : m_jobs) {
+            if(candidate->next.load(std::memory_order_relaxed) < candidate->count) {
+                job = candidate;
+                break;
+            }
+        }
+
+        if(job == nullptr) {
+            if(m_stopping)
+                return;
+            m_wake.wait(lock);
+            continue;
+        }
+
+        ++job->helpers;
+        lock.unlock();
+        job->work();
+        lock.lock();
+        if(--job->helpers == 0) {
+            m_finished.notify_all();
+        }
+    }
+}
+
+void RenderThreads::stopHelpers()
+{
+    std::vector<std::thread> helpers;
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+        helpers.swap(m_helpers);
+    }
+
+    m_wake.notify_all();
+    for(auto& helper : helpers)
+        helper.join();
+    std::lock_guard lock(m_mutex);
+    m_stopping = false;
+}
+
 std::shared_ptr<Canvas> Canvas::create(const Bitmap& bitmap)
 {
-    return std::shared_ptr<Canvas>(new Canvas(bitmap));
+    return std::allocate_shared<Canvas>(RenderContextAllocator<Canvas>(), bitmap);
 }
 
 std::shared_ptr<Canvas> Canvas::create(float x, float y, float width, float height)
 {
     constexpr int kMaxSize = 1 << 15;
     if(width <= 0 || height <= 0 || width >= kMaxSize || height >= kMaxSize)
-        return std::shared_ptr<Canvas>(new Canvas(0, 0, 1, 1));
+        return std::allocate_shared<Canvas>(RenderContextAllocator<Canvas>(), 0, 0, 1, 1);
     auto l = static_cast<int>(std::floor(x));
     auto t = static_cast<int>(std::floor(y));
     auto r = static_cast<int>(std::ceil(x + width));
     auto b = static_cast<int>(std::ceil(y + height));
-    return std::shared_ptr<Canvas>(new Canvas(l, t, r - l, b - t));
+    return std::allocate_shared<Canvas>(RenderContextAllocator<Canvas>(), l, t, r - l, b - t);
 }
 
 std::shared_ptr<Canvas> Canvas::create(const Rect& extents)
@@ -544,6 +770,21 @@ void Canvas::fillPath(const Path& path, FillRule fillRule, const Transform& tran
     plutovg_canvas_fill_path(m_canvas, path.data());
 }
 
+static uint64_t hashWords(const void* data, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto bytes = static_cast<const uint8_t*>(data);
+    for(; length >= 8; bytes += 8, length -= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+
+    for(; length > 0; ++bytes, --length)
+        hash = (hash ^ *bytes) * 0x100000001b3ull;
+    return hash;
+}
+
 void Canvas::strokePath(const Path& path, const StrokeData& strokeData, const Transform& transform)
 {
     plutovg_canvas_set_matrix(m_canvas, &m_translation);
@@ -555,7 +796,107 @@ void Canvas::strokePath(const Path& path, const StrokeData& strokeData, const Tr
     plutovg_canvas_set_dash_offset(m_canvas, strokeData.dashOffset());
     plutovg_canvas_set_dash_array(m_canvas, strokeData.dashArray().data(), int(strokeData.dashArray().size()));
     plutovg_canvas_set_operator(m_canvas, PLUTOVG_OPERATOR_SRC_OVER);
-    plutovg_canvas_stroke_path(m_canvas, path.data());
+
+    auto cache = strokeCoverageCache();
+    if(path.isNull() || !cache->enabled()) {
+        plutovg_canvas_stroke_path(m_canvas, path.data());
+        return;
+    }
+
+    const plutovg_path_element_t* elements = nullptr;
+    auto count = plutovg_path_get_elements(path.data(), &elements);
+    const auto& dashArray = strokeData.dashArray();
+
+    StrokeCoverageKey key;
+    key.path = hashWords(elements, size_t(count) * sizeof(plutovg_path_element_t));
+    key.dashArray = hashWords(dashArray.data(), dashArray.size() * sizeof(float));
+    plutovg_canvas_get_matrix(m_canvas, &key.matrix);
+    key.width = width();
+    key.height = height();
+    key.lineWidth = strokeData.lineWidth();
+    key.miterLimit = strokeData.miterLimit();
+    key.dashOffset = strokeData.dashOffset();
+    key.lineCap = int32_t(strokeData.lineCap());
+    key.lineJoin = int32_t(strokeData.lineJoin());
+    key.dashCount = int32_t(dashArray.size());
+
+    auto coverage = cache->find(key);
+    if(coverage == nullptr) {
+        coverage.reset(plutovg_canvas_stroke_coverage(m_canvas, path.data()), plutovg_coverage_destroy);
+        cache->insert(key, coverage);
+    }
+
+    plutovg_canvas_fill_coverage(m_canvas, coverage.get());
+}
+
+bool StrokeCoverageKey::operator==(const StrokeCoverageKey& other) const
+{
+    return std::memcmp(this, &other, sizeof(StrokeCoverageKey)) == 0;
+}
+
+size_t StrokeCoverageCache::KeyHash::operator()(const StrokeCoverageKey& key) const
+{
+    return static_cast<size_t>(hashWords(&key, sizeof(StrokeCoverageKey)));
+}
+
+std::shared_ptr<const plutovg_coverage_t> StrokeCoverageCache::find(const StrokeCoverageKey& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    if(it == m_entries.end())
+        return nullptr;
+    it->second.lastUse = ++m_clock;
+    return it->second.coverage;
+}
+
+void StrokeCoverageCache::insert(const StrokeCoverageKey& key, const std::shared_ptr<const plutovg_coverage_t>& coverage)
+{
+    auto bytes = size_t(plutovg_coverage_get_size(coverage.get()));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto budget = m_budget.load(std::memory_order_relaxed);
+    if(bytes > budget)
+        return;
+    auto it = m_entries.find(key);
+    if(it != m_entries.end()) {
+        m_bytes -= it->second.bytes;
+        m_entries.erase(it);
+    }
+
+    evict(budget - bytes);
+    m_entries.emplace(key, Entry{coverage, bytes, ++m_clock});
+    m_bytes += bytes;
+}
+
+void StrokeCoverageCache::setBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget.store(bytes, std::memory_order_relaxed);
+    evict(bytes);
+}
+
+void StrokeCoverageCache::evict(size_t budget)
+{
+    if(m_bytes <= budget)
+        return;
+    // strokes are small and many, so rather than scanning for the oldest one at a time, a quarter of the budget is freed at once
+    std::vector<std::pair<uint64_t, StrokeCoverageKey>> entries;
+    entries.reserve(m_entries.size());
+    for(const auto& [key, entry] : m_entries)
+        entries.emplace_back(entry.lastUse, key);
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for(const auto& [lastUse, key] : entries) {
+        if(m_bytes <= budget - budget / 4)
+            break;
+        auto it = m_entries.find(key);
+        m_bytes -= it->second.bytes;
+        m_entries.erase(it);
+    }
+}
+
+StrokeCoverageCache* strokeCoverageCache()
+{
+    static StrokeCoverageCache cache;
+    return &cache;
 }
 
 void Canvas::fillText(const std::u32string_view& text, const Font& font, const Point& origin, const Transform& transform)
@@ -670,23 +1011,30 @@ void Canvas::convertToLuminanceMask()
 
 Canvas::~Canvas()
 {
-    plutovg_canvas_destroy(m_canvas);
-    plutovg_surface_destroy(m_surface);
+    auto& context = RenderContext::current();
+    context.releaseCanvas(m_canvas);
+    if(m_pooledSurface) {
+        context.releaseSurface(m_surface);
+    } else {
+        plutovg_surface_destroy(m_surface);
+    }
 }
 
 Canvas::Canvas(const Bitmap& bitmap)
     : m_surface(plutovg_surface_reference(bitmap.surface()))
-    , m_canvas(plutovg_canvas_create(m_surface))
+    , m_canvas(RenderContext::current().acquireCanvas(m_surface))
     , m_translation({1, 0, 0, 1, 0, 0})
     , m_x(0), m_y(0)
+    , m_pooledSurface(false)
 {
 }
 
 Canvas::Canvas(int x, int y, int width, int height)
-    : m_surface(plutovg_surface_create(width, height))
-    , m_canvas(plutovg_canvas_create(m_surface))
+    : m_surface(RenderContext::current().acquireSurface(width, height))
+    , m_canvas(RenderContext::current().acquireCanvas(m_surface))
     , m_translation({1, 0, 0, 1, -static_cast<float>(x), -static_cast<float>(y)})
     , m_x(x), m_y(y)
+    , m_pooledSurface(true)
 {
 }
 
@@ -10,6 +10,11 @@
 #include <vector>
 #include <array>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
 
 namespace lunasvg {
 
@@ -506,6 +511,169 @@ using GradientStops = std::vector<GradientStop>;
 
 class Bitmap;
 
+// Surfaces and canvases that rendering draws into, kept per thread for reuse. Surfaces are pooled by size
+// class and canvases keep their span buffers and saved states, so that rendering a document again at a
+// similar size allocates next to nothing.
+class RenderContext {
+public:
+    static RenderContext& current();
+
+    plutovg_surface_t* acquireSurface(int width, int height);
+    void releaseSurface(plutovg_surface_t* surface);
+
+    plutovg_canvas_t* acquireCanvas(plutovg_surface_t* surface);
+    void releaseCanvas(plutovg_canvas_t* canvas);
+
+    // small fixed size blocks, for the canvas objects and their reference counts
+    void* allocateBlock(size_t size);
+    void releaseBlock(void* block, size_t size);
+
+    size_t bytesPooled() const { return m_bytesPooled; }
+
+    ~RenderContext();
+
+private:
+    RenderContext() = default;
+    RenderContext(const RenderContext&) = delete;
+    RenderContext& operator=(const RenderContext&) = delete;
+
+    static int sizeClass(int pixels);
+
+    static constexpr int kSmallestSizeClass = 10; // 1024 pixels
+    static constexpr int kLargestSizeClass = 22; // 4M pixels; anything larger is allocated to fit and not kept
+    static constexpr size_t kMaxPooledBytes = 64 * 1024 * 1024;
+    static constexpr size_t kMaxPooledCanvases = 64;
+    static constexpr size_t kBlockSize = 128;
+    static constexpr size_t kMaxPooledBlocks = 64;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::array<std::vector<plutovg_surface_t*>, kLargestSizeClass - kSmallestSizeClass + 1> m_surfaces;
+    std::vector<plutovg_canvas_t*> m_canvases;
+    FreeBlock* m_blocks = nullptr;
+    size_t m_blockCount = 0;
+    size_t m_bytesPooled = 0;
+};
+
+// Threads that the bands of one large fill, stroke or paint are spread over (see plutovg_set_parallel_func),
+// so that a single big render is not left to the thread that asked for it. The drawing thread takes bands
+// as well, and helpers that run out of bands in one job move on to whichever other job still has some.
+class RenderThreads {
+public:
+    static RenderThreads& instance();
+
+    // the total number of threads a draw may use, counting the one drawing; 1 or less draws serially
+    void setThreadCount(int count);
+    int threadCount() const { return m_threadCount; }
+
+    // calls task(data, index) for every index below count, and returns once they have all finished
+    void run(int count, void (*task)(void*, int), void* data);
+
+    ~RenderThreads();
+
+private:
+    RenderThreads();
+    RenderThreads(const RenderThreads&) = delete;
+    RenderThreads& operator=(const RenderThreads&) = delete;
+
+    struct Job {
+        void (*task)(void*, int);
+        void* data;
+        int count;
+        std::atomic<int> next{0};
+        int helpers = 0; // guarded by m_mutex
+        void work();
+    };
+
+    void helperLoop();
+    void stopHelpers();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_finished;
+    std::vector<Job*> m_jobs;
+    std::vector<std::thread> m_helpers;
+    int m_threadCount = 1;
+    bool m_stopping = false;
+};
+
+template<typename T>
+class RenderContextAllocator {
+public:
+    using value_type = T;
+
+    RenderContextAllocator() = default;
+    template<typename U>
+    RenderContextAllocator(const RenderContextAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(RenderContext::current().allocateBlock(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { RenderContext::current().releaseBlock(p, n * sizeof(T)); }
+
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) { ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+    template<typename U>
+    void destroy(U* p) { p->~U(); }
+
+    template<typename U>
+    bool operator==(const RenderContextAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const RenderContextAllocator<U>&) const { return false; }
+};
+
+struct StrokeCoverageKey {
+    uint64_t path; // hash of the path elements
+    uint64_t dashArray; // hash of the dash lengths
+    plutovg_matrix_t matrix;
+    int width; // of the canvas, which the coverage is limited to
+    int height;
+    float lineWidth;
+    float miterLimit;
+    float dashOffset;
+    int32_t lineCap;
+    int32_t lineJoin;
+    int32_t dashCount;
+
+    bool operator==(const StrokeCoverageKey& other) const;
+};
+
+// Keeps the rasterized coverage of stroked paths between renders, so that drawing the same stroke again (in
+// another color, or in a later render of the same document) skips stroking and scan conversion. Kept up to
+// a memory budget; the least recently used coverage is dropped first.
+class StrokeCoverageCache {
+public:
+    std::shared_ptr<const plutovg_coverage_t> find(const StrokeCoverageKey& key);
+    void insert(const StrokeCoverageKey& key, const std::shared_ptr<const plutovg_coverage_t>& coverage);
+
+    bool enabled() const { return m_budget.load(std::memory_order_relaxed) > 0; }
+    void setBudget(size_t bytes);
+
+private:
+    StrokeCoverageCache() = default;
+
+    struct KeyHash {
+        size_t operator()(const StrokeCoverageKey& key) const;
+    };
+
+    struct Entry {
+        std::shared_ptr<const plutovg_coverage_t> coverage;
+        size_t bytes;
+        uint64_t lastUse;
+    };
+
+    void evict(size_t budget);
+
+    std::mutex m_mutex;
+    std::unordered_map<StrokeCoverageKey, Entry, KeyHash> m_entries;
+    std::atomic<size_t> m_budget{16 * 1024 * 1024};
+    size_t m_bytes = 0;
+    uint64_t m_clock = 0;
+    friend StrokeCoverageCache* strokeCoverageCache();
+};
+
+StrokeCoverageCache* strokeCoverageCache();
+
 class Canvas {
 public:
     static std::shared_ptr<Canvas> create(const Bitmap& bitmap);
@@ -548,6 +716,9 @@ public:
     ~Canvas();
 
 private:
+    template<typename T>
+    friend class RenderContextAllocator;
+
     Canvas(const Bitmap& bitmap);
     Canvas(int x, int y, int width, int height);
     plutovg_surface_t* m_surface;
@@ -555,6 +726,7 @@ private:
     plutovg_matrix_t m_translation;
     const int m_x;
     const int m_y;
+    const bool m_pooledSurface;
 };
 
 } // namespace lunasvg
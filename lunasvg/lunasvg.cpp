@@ -1,5 +1,6 @@
 #include "lunasvg.h"
 #include "svgelement.h"
+#include "svgpaintelement.h"
 #include "svgrenderstate.h"
 
 #include <cstring>
@@ -26,6 +27,26 @@ bool lunasvg_add_font_face_from_data(const char* family, bool bold, bool italic,
     return lunasvg::fontFaceCache()->addFontFace(family, bold, italic, lunasvg::FontFace(data, length, destroy_func, closure));
 }
 
+void lunasvg_set_pattern_cache_budget(size_t bytes)
+{
+    lunasvg::patternTileCache()->setBudget(bytes);
+}
+
+void lunasvg_clear_pattern_cache()
+{
+    lunasvg::patternTileCache()->clear();
+}
+
+void lunasvg_set_stroke_cache_budget(size_t bytes)
+{
+    lunasvg::strokeCoverageCache()->setBudget(bytes);
+}
+
+void lunasvg_set_render_threads(int count)
+{
+    lunasvg::RenderThreads::instance().setThreadCount(count);
+}
+
 namespace lunasvg {
 
 Bitmap::Bitmap(int width, int height)
@@ -132,6 +153,11 @@ bool Bitmap::writeToPng(lunasvg_write_func_t callback, void* closure) const
     return false;
 }
 
+Bitmap Bitmap::loadFromData(const void* data, int length)
+{
+    return plutovg_surface_load_from_image_data(data, length);
+}
+
 plutovg_surface_t* Bitmap::release()
 {
     return std::exchange(m_surface, nullptr);
@@ -403,8 +429,8 @@ NodeList Element::children() const
     if(m_node == nullptr)
         return NodeList();
     NodeList children;
-    for(const auto& child : element()->children())
-        children.push_back(child.get());
+    for(auto child : element()->children())
+        children.push_back(child);
     return children;
 }
 
@@ -438,15 +464,26 @@ std::unique_ptr<Document> Document::loadFromData(const char* data, std::function
     return loadFromData(data, std::strlen(data), f);
 }
 
-std::unique_ptr<Document> Document::loadFromData(const char* data, size_t length, std::function<std::pair<const void*, int>(std::string_view)> const& f)
+std::unique_ptr<Document> Document::loadFromData(const char* data, size_t length, std::function<std::pair<const void*, int>(std::string_view)> const& f, std::function<Bitmap(std::string_view)> const& imageLoader)
 {
     std::unique_ptr<Document> document(new Document);
     document->file_loader = f;
+    document->image_loader = imageLoader;
     if(!document->parse(data, length))
         return nullptr;
     return document;
 }
 
+std::unique_ptr<Document> Document::loadFromData(const char* data, size_t length, std::function<std::pair<const void*, int>(std::string_view)> const& f, AttributeSourceList& sources, std::function<Bitmap(std::string_view)> const& imageLoader)
+{
+    std::unique_ptr<Document> document(new Document);
+    document->file_loader = f;
+    document->image_loader = imageLoader;
+    if(!document->parse(data, length, &sources))
+        return nullptr;
+    return document;
+}
+
 float Document::width() const
 {
     return rootElement(true)->intrinsicWidth();
@@ -518,20 +555,24 @@ Element Document::getElementById(const std::string& id) const
 
 Element Document::documentElement() const
 {
-    return m_rootElement.get();
+    return m_rootElement;
 }
 
 SVGRootElement* Document::rootElement(bool layoutIfNeeded) const
 {
     if(layoutIfNeeded)
         m_rootElement->layoutIfNeeded();
-    return m_rootElement.get();
+    return m_rootElement;
 }
 
 Document::Document(Document&&) = default;
 Document& Document::operator=(Document&&) = default;
 
-Document::Document() = default;
+Document::Document()
+    : m_arena(std::make_unique<SVGArena>())
+{
+}
+
 Document::~Document() = default;
 
 } // namespace lunasvg
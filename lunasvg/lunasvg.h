@@ -128,6 +128,37 @@ LUNASVG_API bool lunasvg_add_font_face_from_file(const char* family, bool bold,
 */
 LUNASVG_API bool lunasvg_add_font_face_from_data(const char* family, bool bold, bool italic, const void* data, size_t length, lunasvg_destroy_func_t destroy_func, void* closure);
 
+/**
+* @brief Sets how much memory the rasterized pattern tiles kept between renders may use.
+* @param bytes The budget in bytes. `0` releases the cached tiles and turns the cache off.
+*/
+LUNASVG_API void lunasvg_set_pattern_cache_budget(size_t bytes);
+
+/**
+* @brief Releases every cached pattern tile, for example after the images that patterns draw have changed.
+*/
+LUNASVG_API void lunasvg_clear_pattern_cache(void);
+
+/**
+* @brief Sets how much memory the rasterized strokes kept between renders may use.
+*
+* A stroke drawn again with the same path, transform, size and stroke settings reuses the coverage kept from before,
+* whatever its color, instead of being stroked and rasterized again.
+*
+* @param bytes The budget in bytes. `0` releases the cached strokes and turns the cache off.
+*/
+LUNASVG_API void lunasvg_set_stroke_cache_budget(size_t bytes);
+
+/**
+* @brief Sets how many threads the rows of a large fill, stroke or composite may be split across.
+*
+* The split only applies to draws that cover a large area, and produces the same pixels as drawing on a single thread.
+* It defaults to the number of hardware threads.
+*
+* @param count The number of threads, including the one rendering. `1` or less renders on the calling thread only.
+*/
+LUNASVG_API void lunasvg_set_render_threads(int count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -267,6 +298,14 @@ public:
      */
     bool writeToPng(lunasvg_write_func_t callback, void* closure) const;
 
+    /**
+     * @brief Decodes an image file (PNG, JPEG, ...) held in memory.
+     * @param data A pointer to the encoded image.
+     * @param length The length of the encoded image in bytes.
+     * @return The decoded bitmap, or a null bitmap on failure.
+     */
+    static Bitmap loadFromData(const void* data, int length);
+
     /**
      * @internal
      */
@@ -662,7 +701,20 @@ private:
 
 using ElementList = std::vector<Element>;
 
+/**
+ * @brief Records where the value of an attribute was found in the data a document was loaded from.
+ */
+struct AttributeSource {
+    Element element;
+    int id = 0;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+using AttributeSourceList = std::vector<AttributeSource>;
+
 class SVGRootElement;
+class SVGArena;
 
 class LUNASVG_API Document {
 public:
@@ -691,9 +743,27 @@ public:
      * @brief Load an SVG document from a string with a specified length.
      * @param data The string containing the SVG data.
      * @param length The length of the string in bytes.
+     * @param imageLoader If set, decodes the external files that `<image>` elements refer to, in place of `f`.
+     * @return A pointer to the loaded `Document`, or `nullptr` on failure.
+     */
+    static std::unique_ptr<Document> loadFromData(const char* data, size_t length, std::function<std::pair<const void*, int>(std::string_view)> const& f, std::function<Bitmap(std::string_view)> const& imageLoader = nullptr);
+
+    /**
+     * @brief Load an SVG document from a string with a specified length, recording the source range of every attribute value.
+     * @param data The string containing the SVG data.
+     * @param length The length of the string in bytes.
+     * @param sources Receives one entry per attribute, in document order, with offsets relative to `data`.
+     * @param imageLoader If set, decodes the external files that `<image>` elements refer to, in place of `f`.
      * @return A pointer to the loaded `Document`, or `nullptr` on failure.
      */
-    static std::unique_ptr<Document> loadFromData(const char* data, size_t length, std::function<std::pair<const void*, int>(std::string_view)> const& f);
+    static std::unique_ptr<Document> loadFromData(const char* data, size_t length, std::function<std::pair<const void*, int>(std::string_view)> const& f, AttributeSourceList& sources, std::function<Bitmap(std::string_view)> const& imageLoader = nullptr);
+
+    /**
+     * @brief Replaces the value of an attribute recorded by `loadFromData`, as if the new text had been in the source data.
+     * @param source The recorded attribute.
+     * @param value The raw (undecoded) text of the new attribute value.
+     */
+    void setSourceAttribute(const AttributeSource& source, std::string_view value);
 
     /**
      * @brief Applies a CSS stylesheet to the document.
@@ -778,16 +848,21 @@ public:
     ~Document();
 
     std::function<std::pair<const void*, int>(std::string_view)> file_loader;
+    std::function<Bitmap(std::string_view)> image_loader;
 
 private:
     Document();
     Document(const Document&) = delete;
     Document& operator=(const Document&) = delete;
     SVGRootElement* rootElement(bool layoutIfNeeded = false) const;
-    bool parse(const char* data, size_t length);
-    std::unique_ptr<SVGRootElement> m_rootElement;
+    SVGArena* arena() const { return m_arena.get(); }
+    bool parse(const char* data, size_t length, AttributeSourceList* sources = nullptr);
+    // owns every node of the document, including the root element
+    std::unique_ptr<SVGArena> m_arena;
+    SVGRootElement* m_rootElement = nullptr;
     friend class SVGURIReference;
     friend class SVGNode;
+    friend class SVGElement;
 };
 
 } // namespace lunasvg
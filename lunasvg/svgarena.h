@@ -0,0 +1,137 @@
+#ifndef LUNASVG_SVGARENA_H
+#define LUNASVG_SVGARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lunasvg {
+
+// Bump allocator that owns the nodes of a document. Nothing is freed on its own: when the arena is
+// destroyed, the destructors of the objects made with create() run in reverse order of creation,
+// and then all of the blocks are released together.
+class SVGArena {
+public:
+    SVGArena() = default;
+    ~SVGArena();
+
+    void* allocate(size_t size, size_t alignment);
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args);
+
+    size_t bytesReserved() const { return m_bytesReserved; }
+
+private:
+    SVGArena(const SVGArena&) = delete;
+    SVGArena& operator=(const SVGArena&) = delete;
+
+    struct Block {
+        Block* previous;
+    };
+
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    void* allocateFromNewBlock(size_t size, size_t alignment);
+
+    static constexpr size_t kFirstBlockSize = 16 * 1024;
+    static constexpr size_t kLargestBlockSize = 256 * 1024;
+
+    Block* m_block = nullptr;
+    char* m_cursor = nullptr;
+    char* m_end = nullptr;
+    size_t m_nextBlockSize = kFirstBlockSize;
+    size_t m_bytesReserved = 0;
+    Finalizer* m_finalizers = nullptr;
+};
+
+inline SVGArena::~SVGArena()
+{
+    for(auto finalizer = m_finalizers; finalizer; finalizer = finalizer->next)
+        finalizer->destroy(finalizer->object);
+    while(m_block) {
+        auto previous = m_block->previous;
+        std::free(m_block);
+        m_block = previous;
+    }
+}
+
+inline void* SVGArena::allocate(size_t size, size_t alignment)
+{
+    auto address = (reinterpret_cast<uintptr_t>(m_cursor) + alignment - 1) & ~uintptr_t(alignment - 1);
+    if(m_cursor && address + size <= reinterpret_cast<uintptr_t>(m_end)) {
+        m_cursor = reinterpret_cast<char*>(address + size);
+        return reinterpret_cast<void*>(address);
+    }
+
+    return allocateFromNewBlock(size, alignment);
+}
+
+inline void* SVGArena::allocateFromNewBlock(size_t size, size_t alignment)
+{
+    // blocks grow as the document does, and anything too large for one gets a block of its own
+    auto blockSize = m_nextBlockSize;
+    if(size + alignment + sizeof(Block) > blockSize)
+        blockSize = size + alignment + sizeof(Block);
+    auto block = static_cast<Block*>(std::malloc(blockSize));
+    if(block == nullptr)
+        throw std::bad_alloc();
+    block->previous = m_block;
+    m_block = block;
+    m_bytesReserved += blockSize;
+    m_cursor = reinterpret_cast<char*>(block) + sizeof(Block);
+    m_end = reinterpret_cast<char*>(block) + blockSize;
+    if(m_nextBlockSize < kLargestBlockSize)
+        m_nextBlockSize *= 2;
+    return allocate(size, alignment);
+}
+
+template<typename T, typename... Args>
+T* SVGArena::create(Args&&... args)
+{
+    auto object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if constexpr(!std::is_trivially_destructible_v<T>) {
+        auto finalizer = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+        finalizer->destroy = [](void* object) { static_cast<T*>(object)->~T(); };
+        finalizer->object = object;
+        finalizer->next = m_finalizers;
+        m_finalizers = finalizer;
+    }
+
+    return object;
+}
+
+// Lets standard containers that belong to a node take their storage from the document's arena.
+template<typename T>
+class SVGArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit SVGArenaAllocator(SVGArena* arena) : m_arena(arena) {}
+    template<typename U>
+    SVGArenaAllocator(const SVGArenaAllocator<U>& other) : m_arena(other.arena()) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    SVGArena* arena() const { return m_arena; }
+
+    template<typename U>
+    bool operator==(const SVGArenaAllocator<U>& other) const { return m_arena == other.arena(); }
+    template<typename U>
+    bool operator!=(const SVGArenaAllocator<U>& other) const { return m_arena != other.arena(); }
+
+private:
+    SVGArena* m_arena;
+};
+
+} // namespace lunasvg
+
+#endif // LUNASVG_SVGARENA_H
@@ -59,63 +59,64 @@ void SVGTextNode::setData(const std::string& data)
     m_data.assign(data);
 }
 
-std::unique_ptr<SVGNode> SVGTextNode::clone(bool deep) const
+SVGNode* SVGTextNode::clone(bool deep) const
 {
-    auto node = std::make_unique<SVGTextNode>(document());
+    auto node = arena()->create<SVGTextNode>(document());
     node->setData(m_data);
     return node;
 }
 
 const std::string emptyString;
 
-std::unique_ptr<SVGElement> SVGElement::create(Document* document, ElementID id)
+SVGElement* SVGElement::create(Document* document, ElementID id)
 {
+    auto arena = document->arena();
     switch(id) {
     case ElementID::Svg:
-        return std::make_unique<SVGSVGElement>(document);
+        return arena->create<SVGSVGElement>(document);
     case ElementID::Path:
-        return std::make_unique<SVGPathElement>(document);
+        return arena->create<SVGPathElement>(document);
     case ElementID::G:
-        return std::make_unique<SVGGElement>(document);
+        return arena->create<SVGGElement>(document);
     case ElementID::Rect:
-        return std::make_unique<SVGRectElement>(document);
+        return arena->create<SVGRectElement>(document);
     case ElementID::Circle:
-        return std::make_unique<SVGCircleElement>(document);
+        return arena->create<SVGCircleElement>(document);
     case ElementID::Ellipse:
-        return std::make_unique<SVGEllipseElement>(document);
+        return arena->create<SVGEllipseElement>(document);
     case ElementID::Line:
-        return std::make_unique<SVGLineElement>(document);
+        return arena->create<SVGLineElement>(document);
     case ElementID::Defs:
-        return std::make_unique<SVGDefsElement>(document);
+        return arena->create<SVGDefsElement>(document);
     case ElementID::Polygon:
     case ElementID::Polyline:
-        return std::make_unique<SVGPolyElement>(document, id);
+        return arena->create<SVGPolyElement>(document, id);
     case ElementID::Stop:
-        return std::make_unique<SVGStopElement>(document);
+        return arena->create<SVGStopElement>(document);
     case ElementID::LinearGradient:
-        return std::make_unique<SVGLinearGradientElement>(document);
+        return arena->create<SVGLinearGradientElement>(document);
     case ElementID::RadialGradient:
-        return std::make_unique<SVGRadialGradientElement>(document);
+        return arena->create<SVGRadialGradientElement>(document);
     case ElementID::Symbol:
-        return std::make_unique<SVGSymbolElement>(document);
+        return arena->create<SVGSymbolElement>(document);
     case ElementID::Use:
-        return std::make_unique<SVGUseElement>(document);
+        return arena->create<SVGUseElement>(document);
     case ElementID::Pattern:
-        return std::make_unique<SVGPatternElement>(document);
+        return arena->create<SVGPatternElement>(document);
     case ElementID::Mask:
-        return std::make_unique<SVGMaskElement>(document);
+        return arena->create<SVGMaskElement>(document);
     case ElementID::ClipPath:
-        return std::make_unique<SVGClipPathElement>(document);
+        return arena->create<SVGClipPathElement>(document);
     case ElementID::Marker:
-        return std::make_unique<SVGMarkerElement>(document);
+        return arena->create<SVGMarkerElement>(document);
     case ElementID::Image:
-        return std::make_unique<SVGImageElement>(document);
+        return arena->create<SVGImageElement>(document);
     case ElementID::Style:
-        return std::make_unique<SVGStyleElement>(document);
+        return arena->create<SVGStyleElement>(document);
     case ElementID::Text:
-        return std::make_unique<SVGTextElement>(document);
+        return arena->create<SVGTextElement>(document);
     case ElementID::Tspan:
-        return std::make_unique<SVGTSpanElement>(document);
+        return arena->create<SVGTSpanElement>(document);
     default:
         assert(false);
     }
@@ -126,6 +127,7 @@ std::unique_ptr<SVGElement> SVGElement::create(Document* document, ElementID id)
 SVGElement::SVGElement(Document* document, ElementID id)
     : SVGNode(document)
     , m_id(id)
+    , m_attributes(SVGArenaAllocator<Attribute>(document->arena()))
 {
 }
 
@@ -225,20 +227,10 @@ void SVGElement::parseAttribute(PropertyID id, const std::string& value)
 
 SVGElement* SVGElement::previousElement() const
 {
-    auto parent = parentElement();
-    if(parent == nullptr)
-        return nullptr;
-    const auto& children = parent->children();
-    auto it = children.begin();
-    auto end = children.end();
-    SVGElement* element = nullptr;
-    for(; it != end; ++it) {
-        SVGNode* node = &**it;
-        if(node->isTextNode())
-            continue;
-        if(node == this)
-            return element;
-        element = static_cast<SVGElement*>(node);
+    for(auto node = previousSibling(); node; node = node->previousSibling()) {
+        if(node->isElement()) {
+            return static_cast<SVGElement*>(node);
+        }
     }
 
     return nullptr;
@@ -246,50 +238,42 @@ SVGElement* SVGElement::previousElement() const
 
 SVGElement* SVGElement::nextElement() const
 {
-    auto parent = parentElement();
-    if(parent == nullptr)
-        return nullptr;
-    const auto& children = parent->children();
-    auto it = children.rbegin();
-    auto end = children.rend();
-    SVGElement* element = nullptr;
-    for(; it != end; ++it) {
-        SVGNode* node = &**it;
-        if(node->isTextNode())
-            continue;
-        if(node == this)
-            return element;
-        element = static_cast<SVGElement*>(node);
+    for(auto node = nextSibling(); node; node = node->nextSibling()) {
+        if(node->isElement()) {
+            return static_cast<SVGElement*>(node);
+        }
     }
 
     return nullptr;
 }
 
-SVGNode* SVGElement::addChild(std::unique_ptr<SVGNode> child)
+SVGNode* SVGElement::addChild(SVGNode* child)
 {
     child->setParentElement(this);
-    m_children.push_back(std::move(child));
-    return &*m_children.back();
+    child->m_previousSibling = m_lastChild;
+    child->m_nextSibling = nullptr;
+    if(m_lastChild)
+        m_lastChild->m_nextSibling = child;
+    else
+        m_firstChild = child;
+    m_lastChild = child;
+    return child;
 }
 
 SVGNode* SVGElement::firstChild() const
 {
-    if(m_children.empty())
-        return nullptr;
-    return &*m_children.front();
+    return m_firstChild;
 }
 
 SVGNode* SVGElement::lastChild() const
 {
-    if(m_children.empty())
-        return nullptr;
-    return &*m_children.back();
+    return m_lastChild;
 }
 
 Rect SVGElement::fillBoundingBox() const
 {
     auto fillBoundingBox = Rect::Invalid;
-    for(const auto& child : m_children) {
+    for(auto child = m_firstChild; child; child = child->nextSibling()) {
         if(auto element = toSVGElement(child); element && !element->isHiddenElement()) {
             fillBoundingBox.unite(element->localTransform().mapRect(element->fillBoundingBox()));
         }
@@ -303,7 +287,7 @@ Rect SVGElement::fillBoundingBox() const
 Rect SVGElement::strokeBoundingBox() const
 {
     auto strokeBoundingBox = Rect::Invalid;
-    for(const auto& child : m_children) {
+    for(auto child = m_firstChild; child; child = child->nextSibling()) {
         if(auto element = toSVGElement(child); element && !element->isHiddenElement()) {
             strokeBoundingBox.unite(element->localTransform().mapRect(element->strokeBoundingBox()));
         }
@@ -360,10 +344,8 @@ SVGPaintElement* SVGElement::getPainter(const std::string_view& id) const
 
 SVGElement* SVGElement::elementFromPoint(float x, float y)
 {
-    auto it = m_children.rbegin();
-    auto end = m_children.rend();
-    for(; it != end; ++it) {
-        auto child = toSVGElement(*it);
+    for(auto node = m_lastChild; node; node = node->previousSibling()) {
+        auto child = toSVGElement(node);
         if(child && !child->isHiddenElement()) {
             if(auto element = child->elementFromPoint(x, y)) {
                 return element;
@@ -386,12 +368,13 @@ SVGElement* SVGElement::elementFromPoint(float x, float y)
 
 void SVGElement::addProperty(SVGProperty& value)
 {
-    m_properties.push_front(&value);
+    value.setNextProperty(m_properties);
+    m_properties = &value;
 }
 
 SVGProperty* SVGElement::getProperty(PropertyID id) const
 {
-    for(auto property : m_properties) {
+    for(auto property = m_properties; property; property = property->nextProperty()) {
         if(id == property->id()) {
             return property;
         }
@@ -427,22 +410,22 @@ Size SVGElement::currentViewportSize() const
 
 void SVGElement::cloneChildren(SVGElement* parentElement) const
 {
-    for(const auto& child : m_children) {
+    for(auto child = m_firstChild; child; child = child->nextSibling()) {
         parentElement->addChild(child->clone(true));
     }
 }
 
-std::unique_ptr<SVGNode> SVGElement::clone(bool deep) const
+SVGNode* SVGElement::clone(bool deep) const
 {
     auto element = SVGElement::create(document(), m_id);
     element->setAttributes(m_attributes);
-    if(deep) { cloneChildren(element.get()); }
+    if(deep) { cloneChildren(element); }
     return element;
 }
 
 void SVGElement::build()
 {
-    for(const auto& child : m_children) {
+    for(auto child = m_firstChild; child; child = child->nextSibling()) {
         if(auto element = toSVGElement(child)) {
             element->build();
         }
@@ -465,7 +448,7 @@ void SVGElement::layoutElement(const SVGLayoutState& state)
 
 void SVGElement::layoutChildren(SVGLayoutState& state)
 {
-    for(const auto& child : m_children) {
+    for(auto child = m_firstChild; child; child = child->nextSibling()) {
         if(auto element = toSVGElement(child)) {
             element->layout(state);
         }
@@ -481,7 +464,7 @@ void SVGElement::layout(SVGLayoutState& state)
 
 void SVGElement::renderChildren(SVGRenderState& state) const
 {
-    for(const auto& child : m_children) {
+    for(auto child = m_firstChild; child; child = child->nextSibling()) {
         if(auto element = toSVGElement(child)) {
             element->render(state);
         }
@@ -784,7 +767,7 @@ void SVGUseElement::build()
 {
     if(auto targetElement = getTargetElement(document())) {
         if(auto newElement = cloneTargetElement(targetElement)) {
-            addChild(std::move(newElement));
+            addChild(newElement);
         }
     }
 
@@ -814,7 +797,7 @@ inline bool isDisallowedElement(const SVGElement* element)
     }
 }
 
-std::unique_ptr<SVGElement> SVGUseElement::cloneTargetElement(SVGElement* targetElement)
+SVGElement* SVGUseElement::cloneTargetElement(SVGElement* targetElement)
 {
     if(targetElement == this || isDisallowedElement(targetElement))
         return nullptr;
@@ -843,7 +826,7 @@ std::unique_ptr<SVGElement> SVGUseElement::cloneTargetElement(SVGElement* target
     }
 
     if(newElement->id() != ElementID::Use)
-        targetElement->cloneChildren(newElement.get());
+        targetElement->cloneChildren(newElement);
     return newElement;
 }
 
@@ -897,7 +880,7 @@ void SVGImageElement::render(SVGRenderState& state) const
     newState.endGroup(blendInfo);
 }
 
-static Bitmap loadImageResource(const std::string& href, std::function<std::pair<void const*, int>(std::string_view)> const& f)
+static Bitmap loadImageResource(const std::string& href, std::function<std::pair<void const*, int>(std::string_view)> const& f, std::function<Bitmap(std::string_view)> const& imageLoader)
 {
     if(href.compare(0, 5, "data:") == 0) {
         std::string_view input(href);
@@ -913,6 +896,8 @@ static Bitmap loadImageResource(const std::string& href, std::function<std::pair
         }
     }
 
+    if(imageLoader)
+        return imageLoader(href);
     if(!f) {
             return plutovg_surface_load_from_image_file(href.data());
     } else {
@@ -924,7 +909,7 @@ static Bitmap loadImageResource(const std::string& href, std::function<std::pair
 void SVGImageElement::parseAttribute(PropertyID id, const std::string& value)
 {
     if(id == PropertyID::Href) {
-        m_image = loadImageResource(value, document()->file_loader);
+        m_image = loadImageResource(value, document()->file_loader, document()->image_loader);
     } else {
         SVGGraphicsElement::parseAttribute(id, value);
     }
@@ -3,10 +3,10 @@
 
 #include "lunasvg.h"
 #include "svgproperty.h"
+#include "svgarena.h"
 
 #include <string>
 #include <forward_list>
-#include <list>
 #include <map>
 
 namespace lunasvg {
@@ -31,19 +31,26 @@ public:
 
     Document* document() const { return m_document; }
     SVGRootElement* rootElement() const { return m_document->rootElement(); }
+    SVGArena* arena() const { return m_document->arena(); }
 
     SVGElement* parentElement() const { return m_parentElement; }
     void setParentElement(SVGElement* parent) { m_parentElement = parent; }
 
+    SVGNode* previousSibling() const { return m_previousSibling; }
+    SVGNode* nextSibling() const { return m_nextSibling; }
+
     bool isRootElement() const { return m_parentElement == nullptr; }
 
-    virtual std::unique_ptr<SVGNode> clone(bool deep) const = 0;
+    virtual SVGNode* clone(bool deep) const = 0;
 
 private:
     SVGNode(const SVGNode&) = delete;
     SVGNode& operator=(const SVGNode&) = delete;
     Document* m_document;
     SVGElement* m_parentElement = nullptr;
+    SVGNode* m_previousSibling = nullptr;
+    SVGNode* m_nextSibling = nullptr;
+    friend class SVGElement;
 };
 
 class SVGTextNode final : public SVGNode {
@@ -55,7 +62,7 @@ public:
     const std::string& data() const { return m_data; }
     void setData(const std::string& data);
 
-    std::unique_ptr<SVGNode> clone(bool deep) const final;
+    SVGNode* clone(bool deep) const final;
 
 private:
     std::string m_data;
@@ -78,7 +85,7 @@ private:
     std::string m_value;
 };
 
-using AttributeList = std::forward_list<Attribute>;
+using AttributeList = std::forward_list<Attribute, SVGArenaAllocator<Attribute>>;
 
 enum class ElementID : uint8_t {
     Unknown = 0,
@@ -110,8 +117,32 @@ enum class ElementID : uint8_t {
 
 ElementID elementid(const std::string_view& name);
 
-using SVGNodeList = std::list<std::unique_ptr<SVGNode>>;
-using SVGPropertyList = std::forward_list<SVGProperty*>;
+// The children of an element, linked through their siblings. Nodes are laid out in the document's
+// arena in the order they were parsed, so walking the tree mostly moves forward through memory.
+class SVGNodeList {
+public:
+    class Iterator {
+    public:
+        explicit Iterator(SVGNode* node) : m_node(node) {}
+        SVGNode* operator*() const { return m_node; }
+        Iterator& operator++() { m_node = m_node->nextSibling(); return *this; }
+        bool operator==(const Iterator& other) const { return m_node == other.m_node; }
+        bool operator!=(const Iterator& other) const { return m_node != other.m_node; }
+
+    private:
+        SVGNode* m_node;
+    };
+
+    explicit SVGNodeList(SVGNode* first) : m_first(first) {}
+
+    Iterator begin() const { return Iterator(m_first); }
+    Iterator end() const { return Iterator(nullptr); }
+    bool empty() const { return m_first == nullptr; }
+    size_t size() const;
+
+private:
+    SVGNode* m_first;
+};
 
 class SVGMarkerElement;
 class SVGClipPathElement;
@@ -124,7 +155,7 @@ extern const std::string emptyString;
 
 class SVGElement : public SVGNode {
 public:
-    static std::unique_ptr<SVGElement> create(Document* document, ElementID id);
+    static SVGElement* create(Document* document, ElementID id);
 
     SVGElement(Document* document, ElementID id);
     virtual ~SVGElement() = default;
@@ -145,14 +176,13 @@ public:
     SVGElement* previousElement() const;
     SVGElement* nextElement() const;
 
-    SVGNode* addChild(std::unique_ptr<SVGNode> child);
+    SVGNode* addChild(SVGNode* child);
     SVGNode* firstChild() const;
     SVGNode* lastChild() const;
 
     ElementID id() const { return m_id; }
     const AttributeList& attributes() const { return m_attributes; }
-    const SVGPropertyList& properties() const { return m_properties; }
-    const SVGNodeList& children() const { return m_children; }
+    SVGNodeList children() const { return SVGNodeList(m_firstChild); }
 
     virtual Transform localTransform() const { return Transform::Identity; }
     virtual Rect fillBoundingBox() const;
@@ -175,7 +205,7 @@ public:
     float font_size() const { return m_font_size; }
 
     void cloneChildren(SVGElement* parentElement) const;
-    std::unique_ptr<SVGNode> clone(bool deep) const final;
+    SVGNode* clone(bool deep) const final;
 
     virtual void build();
 
@@ -213,8 +243,9 @@ private:
 
     ElementID m_id;
     AttributeList m_attributes;
-    SVGPropertyList m_properties;
-    SVGNodeList m_children;
+    SVGProperty* m_properties = nullptr;
+    SVGNode* m_firstChild = nullptr;
+    SVGNode* m_lastChild = nullptr;
 };
 
 inline const SVGElement* toSVGElement(const SVGNode* node)
@@ -231,16 +262,19 @@ inline SVGElement* toSVGElement(SVGNode* node)
     return nullptr;
 }
 
-inline SVGElement* toSVGElement(const std::unique_ptr<SVGNode>& node)
+inline size_t SVGNodeList::size() const
 {
-    return toSVGElement(node.get());
+    size_t count = 0;
+    for(auto node = m_first; node; node = node->nextSibling())
+        ++count;
+    return count;
 }
 
 template<typename T>
 inline void SVGElement::transverse(T callback)
 {
     callback(this);
-    for(const auto& child : m_children) {
+    for(auto child = m_firstChild; child; child = child->nextSibling()) {
         if(auto element = toSVGElement(child)) {
             element->transverse(callback);
         }
@@ -372,7 +406,7 @@ public:
     void build() final;
 
 private:
-    std::unique_ptr<SVGElement> cloneTargetElement(SVGElement* targetElement);
+    SVGElement* cloneTargetElement(SVGElement* targetElement);
     SVGLength m_x;
     SVGLength m_y;
     SVGLength m_width;
@@ -4,6 +4,7 @@
 
 #include <set>
 #include <cmath>
+#include <cstring>
 
 namespace lunasvg {
 
@@ -264,6 +265,133 @@ SVGPatternElement::SVGPatternElement(Document* document)
     addProperty(m_patternContentUnits);
 }
 
+// Hashes everything that the layout and rendering of some elements depend on: their subtrees, the attributes that
+// they inherit from, and whatever they refer to by url(#id) or href.
+class PatternContentHash {
+public:
+    void addElement(const SVGElement* element);
+    bool contains(const SVGElement* element) const;
+    uint64_t value() const { return m_value; }
+
+private:
+    void addBytes(const void* data, size_t length);
+    void addMarker(char marker) { addBytes(&marker, 1); }
+    void addAttributes(const SVGElement* element);
+    void addSubtree(const SVGElement* element);
+    void addReferences(const SVGElement* element);
+
+    std::vector<const SVGElement*> m_elements;
+    uint64_t m_value = 0xcbf29ce484222325ull;
+};
+
+void PatternContentHash::addBytes(const void* data, size_t length)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    for(size_t i = 0; i < length; ++i) {
+        m_value = (m_value ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+bool PatternContentHash::contains(const SVGElement* element) const
+{
+    return std::find(m_elements.begin(), m_elements.end(), element) != m_elements.end();
+}
+
+void PatternContentHash::addAttributes(const SVGElement* element)
+{
+    auto id = element->id();
+    addBytes(&id, sizeof(id));
+    for(const auto& attribute : element->attributes()) {
+        auto propertyId = attribute.id();
+        addBytes(&propertyId, sizeof(propertyId));
+        addBytes(attribute.value().data(), attribute.value().size());
+        addMarker(0);
+    }
+
+    // the href stays the same when the image behind it is edited, so the decoded image itself is part of the content
+    if(id == ElementID::Image) {
+        auto surface = static_cast<const SVGImageElement*>(element)->image().surface();
+        addBytes(&surface, sizeof(surface));
+    }
+}
+
+void PatternContentHash::addElement(const SVGElement* element)
+{
+    if(contains(element))
+        return;
+    for(auto parent = element->parentElement(); parent; parent = parent->parentElement()) {
+        addMarker('^');
+        addAttributes(parent);
+    }
+
+    addSubtree(element);
+}
+
+void PatternContentHash::addSubtree(const SVGElement* element)
+{
+    m_elements.push_back(element);
+    addMarker('<');
+    addAttributes(element);
+    for(const auto& child : element->children()) {
+        if(auto childElement = toSVGElement(child)) {
+            if(!contains(childElement)) {
+                addSubtree(childElement);
+            }
+        } else if(child->isTextNode()) {
+            const auto& data = static_cast<const SVGTextNode*>(child)->data();
+            addMarker('"');
+            addBytes(data.data(), data.size());
+        }
+    }
+
+    addMarker('>');
+    addReferences(element);
+}
+
+void PatternContentHash::addReferences(const SVGElement* element)
+{
+    for(const auto& attribute : element->attributes()) {
+        std::string_view value(attribute.value());
+        if(attribute.id() == PropertyID::Href) {
+            if(!value.empty() && value.front() == '#') {
+                if(auto target = element->rootElement()->getElementById(value.substr(1))) {
+                    addElement(target);
+                }
+            }
+
+            continue;
+        }
+
+        for(auto position = value.find("url("); position != std::string_view::npos; position = value.find("url(", position)) {
+            position += 4;
+            while(position < value.size() && (value[position] == ' ' || value[position] == '\'' || value[position] == '\"'))
+                ++position;
+            if(position >= value.size() || value[position] != '#')
+                continue;
+            auto end = value.find_first_of(")'\" ", ++position);
+            if(auto target = element->rootElement()->getElementById(value.substr(position, end - position))) {
+                addElement(target);
+            }
+        }
+    }
+}
+
+static Bitmap renderPatternTile(const SVGPatternElement* element, const SVGRenderState& state, const SVGPatternElement* contentElement, const Transform& transform, float width, float height)
+{
+    // sized by the same rules as Canvas::create, but the tile owns its pixels so that the cache can keep it
+    constexpr int kMaxSize = 1 << 15;
+    Bitmap tile;
+    if(width <= 0 || height <= 0 || width >= kMaxSize || height >= kMaxSize) {
+        tile = Bitmap(1, 1);
+    } else {
+        tile = Bitmap(static_cast<int>(width), static_cast<int>(height));
+    }
+
+    SVGRenderState newState(element, &state, transform, SVGRenderMode::Painting, Canvas::create(tile));
+    contentElement->renderChildren(newState);
+    return tile;
+}
+
 bool SVGPatternElement::applyPaint(SVGRenderState& state, float opacity) const
 {
     if(state.hasCycleReference(this))
@@ -303,60 +431,62 @@ bool SVGPatternElement::applyPaint(SVGRenderState& state, float opacity) const
     float final_pattern_width = patternRect.w * patternImageTransform.xScale();
     float final_pattern_height = patternRect.h * patternImageTransform.yScale();
 
-    std::shared_ptr<Canvas> patternImage_lx_ly = Canvas::create(0, 0, std::ceil(final_pattern_width), std::ceil(final_pattern_height));
-    std::shared_ptr<Canvas> patternImage_sx_sy;
-    std::shared_ptr<Canvas> patternImage_lx_sy;
-    std::shared_ptr<Canvas> patternImage_sx_ly;
-
-    plutovg_surface_t* lxlysurface = patternImage_lx_ly->surface();
-    plutovg_surface_t* sxsysurface = lxlysurface;
-    plutovg_surface_t* lxsysurface = lxlysurface;
-    plutovg_surface_t* sxlysurface = lxlysurface;
+    // the tiles only depend on the pattern content and the scale they are drawn at, so other renders of the same
+    // content can share them; content that is already being drawn further up is left alone, as cycles change what is drawn
+    PatternContentHash contentHash;
+    contentHash.addElement(this);
+    contentHash.addElement(patternContentElement);
+    auto cacheable = true;
+    for(const SVGRenderState* current = &state; current; current = current->parent()) {
+        if(current->element() && contentHash.contains(current->element())) {
+            cacheable = false;
+            break;
+        }
+    }
 
-    {
+    PatternTileKey key = {contentHash.value(), patternImageTransform.matrix(), final_pattern_width, final_pattern_height};
+    PatternTiles tiles;
+    if(!cacheable || !patternTileCache()->find(key, tiles)) {
+        {
             Transform temp_scale = patternImageTransform; // note: this construction of temp scale is obviously sub optimal
             temp_scale.scale(std::ceil(final_pattern_width) / final_pattern_width, std::ceil(final_pattern_height) / final_pattern_height);
-            SVGRenderState newState(this, &state, temp_scale, SVGRenderMode::Painting, patternImage_lx_ly);
-            patternContentElement->renderChildren(newState);
-    }
-    if(std::floor(final_pattern_width) != final_pattern_width) {
-            patternImage_sx_ly = Canvas::create(0, 0, std::floor(final_pattern_width), std::ceil(final_pattern_height));
+            tiles.lx_ly = renderPatternTile(this, state, patternContentElement, temp_scale, std::ceil(final_pattern_width), std::ceil(final_pattern_height));
+            tiles.sx_sy = tiles.lx_sy = tiles.sx_ly = tiles.lx_ly;
+        }
+        if(std::floor(final_pattern_width) != final_pattern_width) {
             Transform temp_scale = patternImageTransform;
             temp_scale.scale(std::floor(final_pattern_width) / final_pattern_width, std::ceil(final_pattern_height) / final_pattern_height);
-            SVGRenderState newState(this, &state, temp_scale, SVGRenderMode::Painting, patternImage_sx_ly);
-            patternContentElement->renderChildren(newState);
-            sxlysurface = patternImage_sx_ly->surface();
-            sxsysurface = sxlysurface;
-    }
-    if(std::floor(final_pattern_height) != final_pattern_height) {
-            patternImage_lx_sy = Canvas::create(0, 0, std::ceil(final_pattern_width), std::floor(final_pattern_height));
+            tiles.sx_ly = renderPatternTile(this, state, patternContentElement, temp_scale, std::floor(final_pattern_width), std::ceil(final_pattern_height));
+            tiles.sx_sy = tiles.sx_ly;
+        }
+        if(std::floor(final_pattern_height) != final_pattern_height) {
             Transform temp_scale = patternImageTransform;
             temp_scale.scale(std::ceil(final_pattern_width) / final_pattern_width, std::floor(final_pattern_height) / final_pattern_height);
-            SVGRenderState newState(this, &state, temp_scale, SVGRenderMode::Painting, patternImage_lx_sy);
-            patternContentElement->renderChildren(newState);
-            lxsysurface = patternImage_lx_sy->surface();
-            sxsysurface = lxsysurface;
-    }
-    if(std::floor(final_pattern_width) != final_pattern_width && std::floor(final_pattern_width) != final_pattern_width) {
-            patternImage_sx_sy = Canvas::create(0, 0, std::floor(final_pattern_width), std::floor(final_pattern_height));
+            tiles.lx_sy = renderPatternTile(this, state, patternContentElement, temp_scale, std::ceil(final_pattern_width), std::floor(final_pattern_height));
+            tiles.sx_sy = tiles.lx_sy;
+        }
+        // when only the width is fractional, the small-small tile would be drawn exactly like sx_ly
+        if(std::floor(final_pattern_width) != final_pattern_width && std::floor(final_pattern_height) != final_pattern_height) {
             Transform temp_scale = patternImageTransform;
             temp_scale.scale(std::floor(final_pattern_width) / final_pattern_width, std::floor(final_pattern_height) / final_pattern_height);
-            SVGRenderState newState(this, &state, temp_scale, SVGRenderMode::Painting, patternImage_sx_sy);
-            patternContentElement->renderChildren(newState);
-            sxsysurface = patternImage_sx_sy->surface();
+            tiles.sx_sy = renderPatternTile(this, state, patternContentElement, temp_scale, std::floor(final_pattern_width), std::floor(final_pattern_height));
+        }
+
+        if(cacheable) {
+            patternTileCache()->insert(key, tiles);
+        }
     }
-    
-   
+
     auto patternTransform = attributes.patternTransform();
 
     patternTransform.translate(patternRect.x, patternRect.y);
     patternTransform.scale(1.0f, 1.0f); // ???? is this correct
 
     plutovg_paint_t* paint = plutovg_paint_create_subpx_texture(
-            lxlysurface,
-            sxsysurface,
-            lxsysurface,
-            sxlysurface,
+            tiles.lx_ly.surface(),
+            tiles.sx_sy.surface(),
+            tiles.lx_sy.surface(),
+            tiles.sx_ly.surface(),
             opacity, 
             &patternTransform.matrix(),
             final_pattern_width, final_pattern_height);
@@ -366,6 +496,97 @@ bool SVGPatternElement::applyPaint(SVGRenderState& state, float opacity) const
     return true;
 }
 
+bool PatternTileKey::operator==(const PatternTileKey& other) const
+{
+    return std::memcmp(this, &other, sizeof(PatternTileKey)) == 0;
+}
+
+size_t PatternTileCache::KeyHash::operator()(const PatternTileKey& key) const
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto bytes = reinterpret_cast<const uint8_t*>(&key);
+    for(size_t i = 0; i < sizeof(PatternTileKey); ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+
+    return static_cast<size_t>(hash);
+}
+
+bool PatternTileCache::find(const PatternTileKey& key, PatternTiles& tiles)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    if(it == m_entries.end())
+        return false;
+    it->second.lastUse = ++m_clock;
+    tiles = it->second.tiles;
+    return true;
+}
+
+void PatternTileCache::insert(const PatternTileKey& key, const PatternTiles& tiles)
+{
+    size_t bytes = 0;
+    const Bitmap* counted[4] = {};
+    for(auto tile : {&tiles.lx_ly, &tiles.sx_sy, &tiles.lx_sy, &tiles.sx_ly}) {
+        auto shared = std::find_if(std::begin(counted), std::end(counted), [tile](const Bitmap* other) {
+            return other && other->surface() == tile->surface();
+        });
+
+        if(shared == std::end(counted)) {
+            bytes += size_t(tile->stride()) * size_t(tile->height());
+            *std::find(std::begin(counted), std::end(counted), nullptr) = tile;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(bytes > m_budget)
+        return;
+    auto it = m_entries.find(key);
+    if(it != m_entries.end()) {
+        m_bytes -= it->second.bytes;
+        m_entries.erase(it);
+    }
+
+    evict(m_budget - bytes);
+    m_entries.emplace(key, Entry{tiles, bytes, ++m_clock});
+    m_bytes += bytes;
+}
+
+void PatternTileCache::setBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    evict(bytes);
+}
+
+void PatternTileCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_bytes = 0;
+}
+
+void PatternTileCache::evict(size_t budget)
+{
+    while(m_bytes > budget && !m_entries.empty()) {
+        auto oldest = m_entries.begin();
+        for(auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if(it->second.lastUse < oldest->second.lastUse) {
+                oldest = it;
+            }
+        }
+
+        m_bytes -= oldest->second.bytes;
+        m_entries.erase(oldest);
+    }
+}
+
+PatternTileCache* patternTileCache()
+{
+    static PatternTileCache cache;
+    return &cache;
+}
+
 SVGPatternAttributes SVGPatternElement::collectPatternAttributes() const
 {
     SVGPatternAttributes attributes;
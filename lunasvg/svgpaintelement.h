@@ -3,6 +3,9 @@
 
 #include "svgelement.h"
 
+#include <mutex>
+#include <unordered_map>
+
 namespace lunasvg {
 
 class SVGPaintElement : public SVGElement {
@@ -283,6 +286,58 @@ private:
     const SVGPatternElement* m_patternContentElement{nullptr};
 };
 
+struct PatternTileKey {
+    uint64_t content; // hash of everything the pattern content is laid out from
+    plutovg_matrix_t transform;
+    float width;
+    float height;
+
+    bool operator==(const PatternTileKey& other) const;
+};
+
+// The four renderings that a subpixel pattern paint blends between; the ones that are not needed share lx_ly.
+struct PatternTiles {
+    Bitmap lx_ly;
+    Bitmap sx_sy;
+    Bitmap lx_sy;
+    Bitmap sx_ly;
+};
+
+// Keeps rasterized pattern tiles between renders, and between documents that share the same pattern
+// content, up to a memory budget. The least recently used tiles are dropped first.
+class PatternTileCache {
+public:
+    bool find(const PatternTileKey& key, PatternTiles& tiles);
+    void insert(const PatternTileKey& key, const PatternTiles& tiles);
+
+    void setBudget(size_t bytes);
+    void clear();
+
+private:
+    PatternTileCache() = default;
+
+    struct KeyHash {
+        size_t operator()(const PatternTileKey& key) const;
+    };
+
+    struct Entry {
+        PatternTiles tiles;
+        size_t bytes;
+        uint64_t lastUse;
+    };
+
+    void evict(size_t budget);
+
+    std::mutex m_mutex;
+    std::unordered_map<PatternTileKey, Entry, KeyHash> m_entries;
+    size_t m_budget = 32 * 1024 * 1024;
+    size_t m_bytes = 0;
+    uint64_t m_clock = 0;
+    friend PatternTileCache* patternTileCache();
+};
+
+PatternTileCache* patternTileCache();
+
 } // namespace lunasvg
 
 #endif // LUNASVG_SVGPAINTELEMENT_H
@@ -708,7 +708,7 @@ inline bool readIdentifier(std::string_view& input, std::string& output)
     return true;
 }
 
-bool Document::parse(const char* data, size_t length)
+bool Document::parse(const char* data, size_t length, AttributeSourceList* sources)
 {
     std::string buffer;
     std::string styleSheet;
@@ -731,9 +731,9 @@ bool Document::parse(const char* data, size_t length)
             removeStyleComments(buffer);
             styleSheet.append(buffer);
         } else {
-            auto node = std::make_unique<SVGTextNode>(this);
+            auto node = m_arena->create<SVGTextNode>(this);
             node->setData(buffer);
-            currentElement->addChild(std::move(node));
+            currentElement->addChild(node);
         }
     };
 
@@ -838,12 +838,11 @@ bool Document::parse(const char* data, size_t length)
                 if(m_rootElement == nullptr) {
                     if(id != ElementID::Svg)
                         return false;
-                    m_rootElement = std::make_unique<SVGRootElement>(this);
-                    element = m_rootElement.get();
+                    m_rootElement = m_arena->create<SVGRootElement>(this);
+                    element = m_rootElement;
                 } else {
-                    auto child = SVGElement::create(this, id);
-                    element = child.get();
-                    currentElement->addChild(std::move(child));
+                    element = SVGElement::create(this, id);
+                    currentElement->addChild(element);
                 }
             }
         }
@@ -865,6 +864,11 @@ bool Document::parse(const char* data, size_t length)
             if(element != nullptr)
                 id = propertyid(buffer);
             if(id != PropertyID::Unknown) {
+                if(sources != nullptr) {
+                    auto begin = static_cast<size_t>(input.data() - data);
+                    sources->push_back(AttributeSource{Element(element), static_cast<int>(id), begin, begin + n});
+                }
+
                 decodeText(input.substr(0, n), buffer);
                 if(id == PropertyID::Style) {
                     removeStyleComments(buffer);
@@ -904,6 +908,22 @@ bool Document::parse(const char* data, size_t length)
     return true;
 }
 
+void Document::setSourceAttribute(const AttributeSource& source, std::string_view value)
+{
+    auto element = source.element.element();
+    if(element == nullptr)
+        return;
+    std::string buffer;
+    decodeText(value, buffer);
+    auto id = static_cast<PropertyID>(source.id);
+    if(id == PropertyID::Style) {
+        removeStyleComments(buffer);
+        parseInlineStyle(buffer, element);
+    } else {
+        element->setAttribute(0x1, id, buffer);
+    }
+}
+
 void Document::applyStyleSheet(const std::string& content)
 {
     auto rules = parseStyleSheet(content);
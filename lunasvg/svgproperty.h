@@ -109,10 +109,15 @@ public:
 
     virtual bool parse(std::string_view input) = 0;
 
+    // the element's properties are linked through the properties themselves
+    SVGProperty* nextProperty() const { return m_nextProperty; }
+    void setNextProperty(SVGProperty* next) { m_nextProperty = next; }
+
 private:
     SVGProperty(const SVGProperty&) = delete;
     SVGProperty& operator=(const SVGProperty&) = delete;
     PropertyID m_id;
+    SVGProperty* m_nextProperty = nullptr;
 };
 
 class SVGString final : public SVGProperty {
@@ -382,11 +382,11 @@ void SVGTextFragmentsBuilder::handleElement(const SVGTextPositioningElement* ele
         return;
     const auto itemIndex = m_textPositions.size();
     m_textPositions.emplace_back(element, m_text.length(), m_text.length());
-    for(const auto& child : element->children()) {
+    for(auto child : element->children()) {
         if(child->isTextNode()) {
-            handleText(toSVGTextNode(child.get()));
+            handleText(toSVGTextNode(child));
         } else if(child->isTextPositioningElement()) {
-            handleElement(toSVGTextPositioningElement(child.get()));
+            handleElement(toSVGTextPositioningElement(child));
         }
     }
 
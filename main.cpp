@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <stdio.h>
 #include <variant>
+#include <algorithm>
 #include <vector>
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -22,20 +23,19 @@
 #include <string_view>
 #include <memory>
 #include <cmath>
+#include <atomic>
+#include <chrono>
 #include "filesystem.hpp"
 #include "imgui_stdlib.h"
 #include "stools.hpp"
 #include "texture.hpp"
+#include "quad_batch.hpp"
+#include "profiler.hpp"
 #include "lunasvg.h"
 #include "asvg.hpp"
 #include "templateproject.hpp"
 
 
-namespace template_project {
-void project_to_bytes(project const& p, serialization::out_buffer& buffer);
-project bytes_to_project(serialization::in_buffer& buffer);
-}
-
 GLint compile_shader(std::string_view source, GLenum type) {
 	GLuint return_value = glCreateShader(type);
 
@@ -112,18 +112,28 @@ static GLfloat global_square_left_flipped_data[] = { 0.0f, 0.0f, 1.0f, 1.0f, 0.0
 
 static GLuint ui_shader_program = 0;
 
+// looked up once after linking; everything that varies per quad is an instance attribute (see quad_batch)
+struct ui_shader_uniforms {
+	GLint texture_sampler = -1;
+	GLint screen_width = -1;
+	GLint screen_height = -1;
+	GLint grid_off = -1;
+};
+static ui_shader_uniforms ui_uniforms;
+
 void load_shaders() {
 
 	std::string_view fx_str =
 		"in vec2 tex_coord;\n"
 		"out vec4 frag_color;\n"
 		"uniform sampler2D texture_sampler;\n"
-		"uniform vec4 d_rect;\n"
-		"uniform float border_size;\n"
-		"uniform float grid_size;\n"
 		"uniform vec2 grid_off;\n"
-		"uniform vec3 inner_color;\n"
-		"uniform uvec2 subroutines_index;\n"
+		"flat in vec4 d_rect;\n"
+		"flat in vec4 uv_rect;\n"
+		"flat in vec3 inner_color;\n"
+		"flat in float border_size;\n"
+		"flat in float grid_size;\n"
+		"flat in uint subroutine;\n"
 
 		"vec4 empty_rect(vec2 tc) {\n"
 			"float realx = tc.x * d_rect.z;\n"
@@ -151,7 +161,7 @@ void load_shaders() {
 			"float realy = tc.y * d_rect.w;\n"
 //			"if(realx <= 2.5 || realy <= 2.5 || realx >= (d_rect.z -2.5) || realy >= (d_rect.w -2.5))\n"
 //				"return vec4(inner_color.r, inner_color.g, inner_color.b, 1.0f);\n"
-			"\treturn texture(texture_sampler, tc);\n"
+			"\treturn texture(texture_sampler, mix(uv_rect.xy, uv_rect.zw, tc));\n"
 		"}\n"
 		"vec4 frame_stretch(vec2 tc) {\n"
 			"float realx = tc.x * d_rect.z;\n"
@@ -176,7 +186,7 @@ void load_shaders() {
 			"return texture(texture_sampler, vec2(xout, yout));\n"
 		"}\n"
 		"vec4 coloring_function(vec2 tc) {\n"
-			"\tswitch(int(subroutines_index.x)) {\n"
+			"\tswitch(int(subroutine)) {\n"
 				"\tcase 1: return empty_rect(tc);\n"
 				"\tcase 2: return direct_texture(tc);\n"
 				"\tcase 3: return frame_stretch(tc);\n"
@@ -187,24 +197,47 @@ void load_shaders() {
 			"\treturn vec4(1.0f,1.0f,1.0f,1.0f);\n"
 		"}\n"
 		"void main() {\n"
-			"\tfrag_color = coloring_function(tex_coord);\n"
+			"\tvec4 c = coloring_function(tex_coord);\n"
+			// renders are uploaded premultiplied, so the colors computed here are premultiplied to match
+			"\tfrag_color = (subroutine == 2u || subroutine == 3u) ? c : vec4(c.rgb * c.a, c.a);\n"
 		"}";
 	std::string_view vx_str =
 		"layout (location = 0) in vec2 vertex_position;\n"
 		"layout (location = 1) in vec2 v_tex_coord;\n"
+		"layout (location = 2) in vec4 i_rect;\n"
+		"layout (location = 3) in vec4 i_uv_rect;\n"
+		"layout (location = 4) in vec3 i_color;\n"
+		"layout (location = 5) in vec2 i_border_grid;\n"
+		"layout (location = 6) in uint i_subroutine;\n"
 		"out vec2 tex_coord;\n"
+		"flat out vec4 d_rect;\n"
+		"flat out vec4 uv_rect;\n"
+		"flat out vec3 inner_color;\n"
+		"flat out float border_size;\n"
+		"flat out float grid_size;\n"
+		"flat out uint subroutine;\n"
 		"uniform float screen_width;\n"
 		"uniform float screen_height;\n"
-		"uniform vec4 d_rect;\n"
 		"void main() {\n"
 			"\tgl_Position = vec4(\n"
-				"\t\t-1.0 + (2.0 * ((vertex_position.x * d_rect.z)  + d_rect.x) / screen_width),\n"
-				"\t\t 1.0 - (2.0 * ((vertex_position.y * d_rect.w)  + d_rect.y) / screen_height),\n"
+				"\t\t-1.0 + (2.0 * ((vertex_position.x * i_rect.z)  + i_rect.x) / screen_width),\n"
+				"\t\t 1.0 - (2.0 * ((vertex_position.y * i_rect.w)  + i_rect.y) / screen_height),\n"
 				"\t\t0.0, 1.0);\n"
 			"\ttex_coord = v_tex_coord;\n"
+			"\td_rect = i_rect;\n"
+			"\tuv_rect = i_uv_rect;\n"
+			"\tinner_color = i_color;\n"
+			"\tborder_size = i_border_grid.x;\n"
+			"\tgrid_size = i_border_grid.y;\n"
+			"\tsubroutine = i_subroutine;\n"
 		"}";
 
 	ui_shader_program = create_program(vx_str, fx_str);
+
+	ui_uniforms.texture_sampler = glGetUniformLocation(ui_shader_program, "texture_sampler");
+	ui_uniforms.screen_width = glGetUniformLocation(ui_shader_program, "screen_width");
+	ui_uniforms.screen_height = glGetUniformLocation(ui_shader_program, "screen_height");
+	ui_uniforms.grid_off = glGetUniformLocation(ui_shader_program, "grid_off");
 }
 
 static GLuint global_square_vao = 0;
@@ -272,92 +305,103 @@ void load_global_squares() {
 
 
 
-void render_textured_rect(color3f color, float ix, float iy, int32_t iwidth, int32_t iheight, GLuint texture_handle) {
-	if(texture_handle == 0)
-		return;
-
-	float x = float(ix);
-	float y = float(iy);
-	float width = float(iwidth);
-	float height = float(iheight);
+static ogl::quad_batch ui_batch;
 
-	glBindVertexArray(global_square_vao);
-
-	glBindVertexBuffer(0, global_square_buffer, 0, sizeof(GLfloat) * 4);
-
-	glUniform4f(glGetUniformLocation(ui_shader_program, "d_rect"), x, y, width, height);
-	glUniform3f(glGetUniformLocation(ui_shader_program, "inner_color"), color.r, color.g, color.b);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture_handle);
-
-	GLuint subroutines[2] = { 2, 0 };
-	glUniform2ui(glGetUniformLocation(ui_shader_program, "subroutines_index"), subroutines[0], subroutines[1]);
-	//glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 2, subroutines); // must set all subroutines in one call
+void render_textured_rect(color3f color, float ix, float iy, int32_t iwidth, int32_t iheight, ogl::atlas_region const& region) {
+	if(region.texture_handle == 0)
+		return;
 
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	ogl::quad_instance q;
+	q.rect[0] = float(ix);
+	q.rect[1] = float(iy);
+	q.rect[2] = float(iwidth);
+	q.rect[3] = float(iheight);
+	q.uv_rect[0] = region.u0;
+	q.uv_rect[1] = region.v0;
+	q.uv_rect[2] = region.u1;
+	q.uv_rect[3] = region.v1;
+	q.color[0] = color.r;
+	q.color[1] = color.g;
+	q.color[2] = color.b;
+	q.subroutine = 2;
+	ui_batch.push(q, region.texture_handle);
 }
 void render_stretch_textured_rect(color3f color, float ix, float iy, float ui_scale, int32_t iwidth, int32_t iheight, float border_size, GLuint texture_handle) {
-	float x = float(ix);
-	float y = float(iy);
-	float width = float(iwidth);
-	float height = float(iheight);
-
-	glBindVertexArray(global_square_vao);
-
-	glBindVertexBuffer(0, global_square_buffer, 0, sizeof(GLfloat) * 4);
-
-	glUniform1f(glGetUniformLocation(ui_shader_program, "border_size"), border_size);
-	glUniform1f(glGetUniformLocation(ui_shader_program, "grid_size"), ui_scale);
-	glUniform4f(glGetUniformLocation(ui_shader_program, "d_rect"), x, y, width, height);
-	glUniform3f(glGetUniformLocation(ui_shader_program, "inner_color"), color.r, color.g, color.b);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture_handle);
-
-	GLuint subroutines[2] = { 3, 0 };
-	glUniform2ui(glGetUniformLocation(ui_shader_program, "subroutines_index"), subroutines[0], subroutines[1]);
-	//glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 2, subroutines); // must set all subroutines in one call
+	ogl::quad_instance q;
+	q.rect[0] = float(ix);
+	q.rect[1] = float(iy);
+	q.rect[2] = float(iwidth);
+	q.rect[3] = float(iheight);
+	q.color[0] = color.r;
+	q.color[1] = color.g;
+	q.color[2] = color.b;
+	q.border_size = border_size;
+	q.grid_size = ui_scale;
+	q.subroutine = 3;
+	ui_batch.push(q, texture_handle);
+}
+// draws a render of another size stretched over the rect: the borders keep their size, scaled by pixel_scale (rect pixels per
+// render pixel), and only the strips between them are stretched
+void render_nine_slice_rect(color3f color, float ix, float iy, int32_t iwidth, int32_t iheight, float pixel_scale, asvg::stretch_render const& s) {
+	if(s.region.texture_handle == 0 || s.width <= 0 || s.height <= 0)
+		return;
 
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	auto texel_u = (s.region.u1 - s.region.u0) / float(s.width);
+	auto texel_v = (s.region.v1 - s.region.v0) / float(s.height);
+	float const xs[4] = { ix, ix + float(s.slices.left) * pixel_scale, ix + float(iwidth) - float(s.slices.right) * pixel_scale, ix + float(iwidth) };
+	float const ys[4] = { iy, iy + float(s.slices.top) * pixel_scale, iy + float(iheight) - float(s.slices.bottom) * pixel_scale, iy + float(iheight) };
+	// every texel of a middle strip is the same, so it is sampled half a texel in from its ends, where filtering would reach into the borders
+	float const us[6] = { s.region.u0, s.region.u0 + float(s.slices.left) * texel_u,
+		s.region.u0 + (float(s.slices.left) + 0.5f) * texel_u, s.region.u1 - (float(s.slices.right) + 0.5f) * texel_u,
+		s.region.u1 - float(s.slices.right) * texel_u, s.region.u1 };
+	float const vs[6] = { s.region.v0, s.region.v0 + float(s.slices.top) * texel_v,
+		s.region.v0 + (float(s.slices.top) + 0.5f) * texel_v, s.region.v1 - (float(s.slices.bottom) + 0.5f) * texel_v,
+		s.region.v1 - float(s.slices.bottom) * texel_v, s.region.v1 };
+
+	for(int32_t row = 0; row < 3; ++row) {
+		for(int32_t column = 0; column < 3; ++column) {
+			if(xs[column + 1] <= xs[column] || ys[row + 1] <= ys[row])
+				continue;
+			ogl::quad_instance q;
+			q.rect[0] = xs[column];
+			q.rect[1] = ys[row];
+			q.rect[2] = xs[column + 1] - xs[column];
+			q.rect[3] = ys[row + 1] - ys[row];
+			q.uv_rect[0] = us[column * 2];
+			q.uv_rect[1] = vs[row * 2];
+			q.uv_rect[2] = us[column * 2 + 1];
+			q.uv_rect[3] = vs[row * 2 + 1];
+			q.color[0] = color.r;
+			q.color[1] = color.g;
+			q.color[2] = color.b;
+			q.subroutine = 2;
+			ui_batch.push(q, s.region.texture_handle);
+		}
+	}
 }
 void render_empty_rect(color3f color, float ix, float iy, int32_t iwidth, int32_t iheight) {
-	float x = float(ix);
-	float y = float(iy);
-	float width = float(iwidth);
-	float height = float(iheight);
-
-	glBindVertexArray(global_square_vao);
-
-	glBindVertexBuffer(0, global_square_buffer, 0, sizeof(GLfloat) * 4);
-
-	glUniform4f(glGetUniformLocation(ui_shader_program, "d_rect"), x, y, width, height);
-	glUniform3f(glGetUniformLocation(ui_shader_program, "inner_color"), color.r, color.g, color.b);
-
-	GLuint subroutines[2] = { 1, 0 };
-	glUniform2ui(glGetUniformLocation(ui_shader_program, "subroutines_index"), subroutines[0], subroutines[1]);
-	//glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 2, subroutines); // must set all subroutines in one call
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	ogl::quad_instance q;
+	q.rect[0] = float(ix);
+	q.rect[1] = float(iy);
+	q.rect[2] = float(iwidth);
+	q.rect[3] = float(iheight);
+	q.color[0] = color.r;
+	q.color[1] = color.g;
+	q.color[2] = color.b;
+	q.subroutine = 1;
+	ui_batch.push(q, 0);
 }
 void render_hollow_rect(color3f color, float ix, float iy, int32_t iwidth, int32_t iheight) {
-	float x = float(ix);
-	float y = float(iy);
-	float width = float(iwidth);
-	float height = float(iheight);
-
-	glBindVertexArray(global_square_vao);
-
-	glBindVertexBuffer(0, global_square_buffer, 0, sizeof(GLfloat) * 4);
-
-	glUniform4f(glGetUniformLocation(ui_shader_program, "d_rect"), x, y, width, height);
-	glUniform3f(glGetUniformLocation(ui_shader_program, "inner_color"), color.r, color.g, color.b);
-
-	GLuint subroutines[2] = { 5, 0 };
-	glUniform2ui(glGetUniformLocation(ui_shader_program, "subroutines_index"), subroutines[0], subroutines[1]);
-	//glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 2, subroutines); // must set all subroutines in one call
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	ogl::quad_instance q;
+	q.rect[0] = float(ix);
+	q.rect[1] = float(iy);
+	q.rect[2] = float(iwidth);
+	q.rect[3] = float(iheight);
+	q.color[0] = color.r;
+	q.color[1] = color.g;
+	q.color[2] = color.b;
+	q.subroutine = 5;
+	ui_batch.push(q, 0);
 }
 
 void render_layout_rect(color3f outline_color, float ix, float iy, int32_t iwidth, int32_t iheight) {
@@ -473,9 +517,141 @@ void mouse_to_drag_type(drag_target t) {
 
 }
 
+// imgui needs a few frames after an input to settle (hover state, popups, layout) before it is safe to go idle
+constexpr int32_t frames_after_input = 3;
+static int32_t frames_to_draw = frames_after_input;
+// set from the render pool workers; the main thread turns it into frames_to_draw
+static std::atomic<bool> renders_arrived = false;
+
+void request_redraw() {
+	frames_to_draw = frames_after_input;
+}
+
 float last_scroll_value = 0.0f;
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 	last_scroll_value += float(yoffset);
+	request_redraw();
+}
+
+// installed before the imgui backend, which chains to them, so every input it sees also wakes the canvas
+void install_redraw_callbacks(GLFWwindow* window) {
+	glfwSetCursorPosCallback(window, [](GLFWwindow*, double, double) { request_redraw(); });
+	glfwSetCursorEnterCallback(window, [](GLFWwindow*, int) { request_redraw(); });
+	glfwSetMouseButtonCallback(window, [](GLFWwindow*, int, int, int) { request_redraw(); });
+	glfwSetKeyCallback(window, [](GLFWwindow*, int, int, int, int) { request_redraw(); });
+	glfwSetCharCallback(window, [](GLFWwindow*, unsigned int) { request_redraw(); });
+	glfwSetWindowFocusCallback(window, [](GLFWwindow*, int) { request_redraw(); });
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int, int) { request_redraw(); });
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { request_redraw(); });
+	glfwSetScrollCallback(window, scroll_callback);
+}
+
+// per frame counters and timings from the profiler, and the zones of the last frame grouped by name
+void show_profiler_window(bool& open) {
+	auto& rec = profiler::common_recorder::instance;
+	ImGui::SetNextWindowSize(ImVec2(520, 560), ImGuiCond_FirstUseEver);
+	if(!ImGui::Begin("Profiler", &open)) {
+		ImGui::End();
+		return;
+	}
+
+	bool recording = rec.enabled.load();
+	if(ImGui::Checkbox("Record", &recording))
+		rec.enabled = recording;
+	ImGui::SameLine();
+	if(!rec.capturing) {
+		if(ImGui::Button("Start trace")) {
+			rec.enabled = true;
+			rec.start_capture();
+		}
+	} else if(ImGui::Button("Save trace")) {
+		auto file = fs::pick_new_file(L"json");
+		if(file.length() > 0)
+			rec.write_capture(file);
+	}
+	if(rec.capturing) {
+		ImGui::SameLine();
+		ImGui::Text("tracing...");
+	}
+
+	struct zone_total {
+		std::string_view name;
+		int32_t calls = 0;
+		double total_ms = 0.0;
+		double max_ms = 0.0;
+	};
+	std::vector<zone_total> zones;
+	std::array<float, profiler::recorder::frame_history> frame_ms = { };
+	std::array<float, profiler::recorder::frame_history> raster_ms = { };
+	std::array<int64_t, profiler::counter_count> last_counters = { };
+	std::array<int64_t, profiler::counter_count> counter_totals = { };
+	uint32_t frame_count = 0;
+	{
+		std::lock_guard lock(rec.guard);
+		frame_count = rec.frames_recorded;
+		for(uint32_t i = 0; i < frame_count; ++i) {
+			auto& f = rec.frame(frame_count - 1 - i); // oldest first
+			frame_ms[i] = float(double(f.duration_ns) / 1.0e6);
+			raster_ms[i] = float(double(f.counters[size_t(profiler::counter::raster_us)]) / 1000.0);
+			for(int32_t c = 0; c < profiler::counter_count; ++c)
+				counter_totals[c] += f.counters[c];
+		}
+		if(frame_count > 0)
+			last_counters = rec.frame(0).counters;
+		for(auto& z : rec.last_frame_zones) {
+			auto ms = double(z.duration_ns) / 1.0e6;
+			auto it = std::find_if(zones.begin(), zones.end(), [&](zone_total const& t) { return t.name == z.name; });
+			if(it == zones.end())
+				it = zones.insert(zones.end(), zone_total{ z.name });
+			++it->calls;
+			it->total_ms += ms;
+			it->max_ms = std::max(it->max_ms, ms);
+		}
+	}
+	std::sort(zones.begin(), zones.end(), [](zone_total const& a, zone_total const& b) { return a.total_ms > b.total_ms; });
+
+	ImGui::PlotLines("frame ms", frame_ms.data(), int32_t(frame_count), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+	ImGui::PlotLines("raster ms", raster_ms.data(), int32_t(frame_count), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+
+	if(ImGui::BeginTable("counters", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("counter");
+		ImGui::TableSetupColumn("last frame");
+		ImGui::TableSetupColumn("frame average");
+		ImGui::TableHeadersRow();
+		for(int32_t c = 0; c < profiler::counter_count; ++c) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(profiler::counter_name(profiler::counter(c)));
+			ImGui::TableNextColumn();
+			ImGui::Text("%lld", (long long)(last_counters[c]));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", frame_count > 0 ? double(counter_totals[c]) / double(frame_count) : 0.0);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::Text("Zones in the last frame");
+	if(ImGui::BeginTable("zones", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("zone");
+		ImGui::TableSetupColumn("calls");
+		ImGui::TableSetupColumn("total ms");
+		ImGui::TableSetupColumn("max ms");
+		ImGui::TableHeadersRow();
+		for(auto& z : zones) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(z.name.data(), z.name.data() + z.name.size());
+			ImGui::TableNextColumn();
+			ImGui::Text("%d", z.calls);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", z.total_ms);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", z.max_ms);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
 }
 
 float drag_offset_x = 0.0f;
@@ -523,6 +699,54 @@ template_project::project open_project;
 template_project::template_type selected_type = template_project::template_type::background;
 int32_t selected_template = -1;
 
+// templates are read through the file bank, which then watches them along with the files they refer to
+asvg::svg load_background(template_project::background_definition const& b) {
+	auto data = asvg::common_file_bank::bank.get_file_data(b.file_name);
+	return asvg::svg((char const*)(data.first), size_t(data.second), b.base_x, b.base_y);
+}
+asvg::simple_svg load_icon(template_project::icon_definition const& i) {
+	auto data = asvg::common_file_bank::bank.get_file_data(i.file_name);
+	return asvg::simple_svg((char const*)(data.first), size_t(data.second));
+}
+
+// parses again only the templates whose own file changed; a template that merely refers to a changed file
+// takes a new revision by itself, and in both cases only the renders that are drawn again get rasterized
+void reload_changed_templates(std::vector<std::string> const& changed_files) {
+	auto changed = [&](std::string const& file_name) {
+		return !file_name.empty() && std::find(changed_files.begin(), changed_files.end(), file_name) != changed_files.end();
+	};
+	bool dependency_changed = false;
+	for(auto& file_name : changed_files) {
+		auto is_template = std::find_if(open_project.backgrounds.begin(), open_project.backgrounds.end(), [&](auto const& b) { return b.file_name == file_name; }) != open_project.backgrounds.end()
+			|| std::find_if(open_project.icons.begin(), open_project.icons.end(), [&](auto const& i) { return i.file_name == file_name; }) != open_project.icons.end();
+		dependency_changed = dependency_changed || !is_template;
+	}
+	// pattern tiles are keyed by the text of the pattern, which stays the same when an image it draws is edited
+	if(dependency_changed)
+		lunasvg_clear_pattern_cache();
+
+	for(auto& b : open_project.backgrounds) {
+		if(changed(b.file_name)) {
+			b.renders.release_renders();
+			b.renders = load_background(b);
+		}
+	}
+	for(auto& i : open_project.icons) {
+		if(changed(i.file_name)) {
+			i.renders.release_renders();
+			i.renders = load_icon(i);
+		}
+	}
+}
+
+// for when the watcher missed an edit: checks every file the bank has handed out, and always parses this template again
+void reload_templates_manually(std::string const& file_name) {
+	auto changed_files = asvg::common_file_bank::bank.check_all_files();
+	if(std::find(changed_files.begin(), changed_files.end(), file_name) == changed_files.end())
+		changed_files.push_back(file_name);
+	reload_changed_templates(changed_files);
+}
+
 template<typename F>
 void make_name_change(std::string& temp_name, std::string& real_name, std::vector<F> const& options) {
 	ImGui::InputText("Name", &temp_name);
@@ -785,17 +1009,23 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 
 	// Create window with graphics context
 	GLFWwindow* window = glfwCreateWindow(1280, 720, "Alice UI Editor", nullptr, nullptr);
-	glfwSetScrollCallback(window, scroll_callback);
-	glfwMaximizeWindow(window);
-
 	if(window == nullptr)
 		return 1;
+
+	install_redraw_callbacks(window);
+	glfwMaximizeWindow(window);
 	glfwMakeContextCurrent(window);
 	assert(glewInit() == 0);
 	glfwSwapInterval(1); // Enable vsync
 
 	load_global_squares();
 	load_shaders();
+	ui_batch.attach(global_square_vao);
+
+	asvg::common_render_pool::pool.on_job_finished = []() {
+		renders_arrived = true;
+		glfwPostEmptyEvent();
+	};
 
 	// Setup Dear ImGui context
 	IMGUI_CHECKVERSION();
@@ -878,13 +1108,69 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 	int32_t display_w = 0;
 	int32_t display_h = 0;
 
+	// when set, the loop blocks in glfwWaitEvents until an input, a finished background render or a resize arrives
+	bool redraw_only_on_change = true;
+	bool show_profiler = false;
+	// backgrounds that only stretch between fixed borders are drawn from one render per grid size instead of one per size
+	bool stretch_backgrounds = true;
+
+	using frame_clock = std::chrono::steady_clock;
+	auto stats_start = frame_clock::now();
+	auto stats_start_cpu = uint64_t(0);
+	int32_t stats_frames = 0;
+	double stats_frame_seconds = 0.0;
+	float frames_per_second = 0.0f;
+	float average_frame_ms = 0.0f;
+	float cpu_percent = 0.0f; // of one core, across all threads of the process
+
+	auto process_cpu_time = []() {
+		FILETIME creation, exit, kernel, user;
+		if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+			return uint64_t(0);
+		auto k = (uint64_t(kernel.dwHighDateTime) << 32) | uint64_t(kernel.dwLowDateTime);
+		auto u = (uint64_t(user.dwHighDateTime) << 32) | uint64_t(user.dwLowDateTime);
+		return k + u; // in 100ns units
+	};
+	stats_start_cpu = process_cpu_time();
+
 	// Main loop
 	while(!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
+		if(redraw_only_on_change) {
+			if(frames_to_draw <= 0 && !renders_arrived) {
+				// a timeout keeps the text cursor blinking while a text field is focused, and picks up edited files while a project is open
+				if(ImGui::GetIO().WantTextInput)
+					glfwWaitEventsTimeout(0.5);
+				else if(!open_project.project_directory.empty())
+					glfwWaitEventsTimeout(0.25);
+				else
+					glfwWaitEvents();
+			} else {
+				glfwPollEvents();
+			}
+			if(renders_arrived.exchange(false))
+				request_redraw();
+			if(auto changed_files = asvg::common_file_bank::bank.poll_changes(); !changed_files.empty()) {
+				reload_changed_templates(changed_files);
+				request_redraw();
+			}
+			if(frames_to_draw <= 0 && !ImGui::GetIO().WantTextInput)
+				continue; // woken by something that does not change what is on screen
+		} else {
+			glfwPollEvents();
+			if(auto changed_files = asvg::common_file_bank::bank.poll_changes(); !changed_files.empty())
+				reload_changed_templates(changed_files);
+		}
 		if(glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0) {
-			ImGui_ImplGlfw_Sleep(10);
+			if(!redraw_only_on_change)
+				ImGui_ImplGlfw_Sleep(10);
+			frames_to_draw = 0; // restoring the window sends a refresh, which requests a redraw again
 			continue;
 		}
+		if(frames_to_draw > 0)
+			--frames_to_draw;
+
+		auto frame_start = frame_clock::now();
+		profiler::common_recorder::instance.begin_frame();
 
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
@@ -923,16 +1209,14 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 				open_project.project_name = rem.substr(0, ext_pos);
 				open_project.project_directory = new_file.substr(0, breakpt + 1);
 				
-				asvg::common_file_bank::bank.root_directory = open_project.project_directory + open_project.svg_directory;
+				asvg::common_file_bank::bank.set_root_directory(open_project.project_directory + open_project.svg_directory);
 
 				
 					for(auto& i : open_project.icons) {
-						fs::file loaded_file{ open_project.project_directory + open_project.svg_directory + fs::utf8_to_native(i.file_name) };
-						i.renders = asvg::simple_svg(loaded_file.content().data, size_t(loaded_file.content().file_size));
+						i.renders = load_icon(i);
 					}
 					for(auto& b : open_project.backgrounds) {
-						fs::file loaded_file{ open_project.project_directory + open_project.svg_directory + fs::utf8_to_native(b.file_name) };
-						b.renders = asvg::svg(loaded_file.content().data, size_t(loaded_file.content().file_size), b.base_x, b.base_y);
+						b.renders = load_background(b);
 					}
 				
 			}
@@ -983,9 +1267,24 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 					}
 				}
 
-				asvg::common_file_bank::bank.root_directory = open_project.project_directory + open_project.svg_directory;
+				asvg::common_file_bank::bank.set_root_directory(open_project.project_directory + open_project.svg_directory);
 			}
 		}
+		{
+			auto& tcache = asvg::common_texture_cache::cache;
+			ImGui::Text("Render cache: %.1f MB in %.1f MB of atlas pages, %d hits, %d misses, %d evictions", double(tcache.bytes_used) / (1024.0 * 1024.0), double(tcache.atlas.page_bytes()) / (1024.0 * 1024.0), int32_t(tcache.hits), int32_t(tcache.misses), int32_t(tcache.evictions));
+			int32_t budget_mb = int32_t(tcache.byte_budget / (1024 * 1024));
+			if(ImGui::InputInt("Render cache budget (MB)", &budget_mb)) {
+				tcache.set_budget(size_t(std::max(1, budget_mb)) * 1024 * 1024);
+			}
+			ImGui::Text("Canvas: %d quads in %d draw calls", int32_t(ui_batch.last_frame_quads), int32_t(ui_batch.last_frame_draw_calls));
+			ImGui::Checkbox("Redraw only on change", &redraw_only_on_change);
+			ImGui::SameLine();
+			ImGui::Checkbox("Stretch backgrounds", &stretch_backgrounds);
+			ImGui::SameLine();
+			ImGui::Checkbox("Profiler", &show_profiler);
+			ImGui::Text("%.1f frames/s, %.2f ms per frame, %.1f%% cpu", frames_per_second, average_frame_ms, cpu_percent);
+		}
 		ImGui::Text("-----------------");
 		auto& thm = open_project;
 
@@ -1037,16 +1336,16 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 							}
 
 							b.file_name = fs::native_to_utf8(rem);
-							fs::file loaded_file{ new_file };
-							b.renders = asvg::svg(loaded_file.content().data, size_t(loaded_file.content().file_size), b.base_x, b.base_y);
+							b.renders = load_background(b);
 						}
 					}
 					if(!b.file_name.empty()) {
 						if(ImGui::Button("Reload")) {
-							fs::file loaded_file{ open_project.project_directory + open_project.svg_directory + fs::utf8_to_native(b.file_name) };
-							b.renders = asvg::svg(loaded_file.content().data, size_t(loaded_file.content().file_size), b.base_x, b.base_y);
+							reload_templates_manually(b.file_name);
 						}
 					}
+					if(b.renders.parse_failed())
+						ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Could not parse this file");
 
 
 					if(ImGui::InputInt("Base width", &b.base_x)) {
@@ -1095,16 +1394,16 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 							}
 
 							b.file_name = fs::native_to_utf8(rem);
-							fs::file loaded_file{ new_file };
-							b.renders = asvg::simple_svg(loaded_file.content().data, size_t(loaded_file.content().file_size));
+							b.renders = load_icon(b);
 						}
 					}
 					if(!b.file_name.empty()) {
 						if(ImGui::Button("Reload")) {
-							fs::file loaded_file{ open_project.project_directory + open_project.svg_directory + fs::utf8_to_native(b.file_name) };
-							b.renders = asvg::simple_svg(loaded_file.content().data, size_t(loaded_file.content().file_size));
+							reload_templates_manually(b.file_name);
 						}
 					}
+					if(b.renders.parse_failed())
+						ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Could not parse this file");
 
 					ImGui::TreePop();
 				}
@@ -1383,6 +1682,8 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 
 		ImGui::End();
 
+		if(show_profiler)
+			show_profiler_window(show_profiler);
 
 		if(last_scroll_value > 0.0f) {
 			if(!io.WantCaptureMouse)
@@ -1422,13 +1723,14 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
 		glUseProgram(ui_shader_program);
-		glUniform1i(glGetUniformLocation(ui_shader_program, "texture_sampler"), 0);
-		glUniform1f(glGetUniformLocation(ui_shader_program, "screen_width"), float(display_w));
-		glUniform1f(glGetUniformLocation(ui_shader_program, "screen_height"), float(display_h));
+		glUniform1i(ui_uniforms.texture_sampler, 0);
+		glUniform1f(ui_uniforms.screen_width, float(display_w));
+		glUniform1f(ui_uniforms.screen_height, float(display_h));
+		glUniform2f(ui_uniforms.grid_off, std::floor(-drag_offset_x), std::floor(-drag_offset_y));
 		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-		
+		ui_batch.begin_frame();
 
 		//if(0 <= selected_window && selected_window < int32_t(open_project.windows.size())) {
 		//	auto& win = open_project.windows[selected_window];
@@ -1440,16 +1742,14 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 		// Draw Grid
 		//
 		{
-			glBindVertexArray(global_square_vao);
-			glBindVertexBuffer(0, global_square_buffer, 0, sizeof(GLfloat) * 4);
-			glUniform4f(glGetUniformLocation(ui_shader_program, "d_rect"), 0.0f, 0.0f, float(display_w), float(display_h));
-			//glUniform1f(glGetUniformLocation(ui_shader_program, "grid_size"), ui_scale * float(open_project.grid_size));
-			glUniform1f(glGetUniformLocation(ui_shader_program, "grid_size"), ui_scale * 8.0f);
-			glUniform2f(glGetUniformLocation(ui_shader_program, "grid_off"), std::floor(-drag_offset_x), std::floor(-drag_offset_y));
-			GLuint subroutines[2] = { 4, 0 };
-			glUniform2ui(glGetUniformLocation(ui_shader_program, "subroutines_index"), subroutines[0], subroutines[1]);
+			ogl::quad_instance grid;
+			grid.rect[2] = float(display_w);
+			grid.rect[3] = float(display_h);
+			//grid.grid_size = ui_scale * float(open_project.grid_size);
+			grid.grid_size = ui_scale * 8.0f;
+			grid.subroutine = 4;
+			ui_batch.push(grid, 0);
 		}
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
 			auto render_asvg_rect = [&](asvg::svg& s, int32_t& hcursor, int32_t vcursor, int32_t& line_vcursor, int32_t x_sz, int32_t y_sz, int32_t gsz) {
 				render_hollow_rect(color3f{ 1.f, 0.f, 0.f },
@@ -1458,12 +1758,23 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 					std::max(1, int32_t(gsz * x_sz * ui_scale)),
 					std::max(1, int32_t(gsz* y_sz * ui_scale)));
 				
-				render_textured_rect(color3f{ 0.f, 0.f, 0.f },
-					drag_offset_x + hcursor,
-					drag_offset_y + vcursor,
-					std::max(1, int32_t(gsz* x_sz * ui_scale)),
-					std::max(1, int32_t(gsz* y_sz * ui_scale)),
-					s.get_render( x_sz, y_sz, gsz, 2.0f));
+				auto stretched = stretch_backgrounds ? s.get_stretch_render(float(x_sz), float(y_sz), gsz, 2.0f) : std::nullopt;
+				if(stretched) {
+					render_nine_slice_rect(color3f{ 0.f, 0.f, 0.f },
+						drag_offset_x + hcursor,
+						drag_offset_y + vcursor,
+						std::max(1, int32_t(gsz * x_sz * ui_scale)),
+						std::max(1, int32_t(gsz * y_sz * ui_scale)),
+						ui_scale / 2.0f,
+						*stretched);
+				} else {
+					render_textured_rect(color3f{ 0.f, 0.f, 0.f },
+						drag_offset_x + hcursor,
+						drag_offset_y + vcursor,
+						std::max(1, int32_t(gsz* x_sz * ui_scale)),
+						std::max(1, int32_t(gsz* y_sz * ui_scale)),
+						s.get_render( x_sz, y_sz, gsz, 2.0f));
+				}
 
 				hcursor += int32_t(gsz * x_sz * ui_scale) + int32_t(8 * ui_scale);
 				line_vcursor = std::max(line_vcursor, vcursor + int32_t(gsz * y_sz * ui_scale) + int32_t(8 * ui_scale));
@@ -1922,14 +2233,49 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int n
 		//	std::max(1, int32_t(16 * render_grid_scale * ui_scale)), std::max(1, int32_t(3 * render_grid_scale * ui_scale)),
 		//	test_rendered_svg.get_render(8000, 1500, render_grid_scale, 2.0f));
 
+		{
+			profiler::scoped_zone zone("quad_batch::end_frame");
+			ui_batch.end_frame();
+		}
+		// pages dropped by the cache this frame could still be referenced by the quads just drawn
+		asvg::common_texture_cache::cache.atlas.release_retired();
+
 		glDepthRange(-1.0f, 1.0f);
 
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+		// held buttons, sliders being dragged and canvas drags change things without producing further events
+		if(dragging || ImGui::IsAnyItemActive())
+			request_redraw();
+
+		{
+			auto& tcache = asvg::common_texture_cache::cache;
+			profiler::set_level(profiler::counter::renders_alive, int64_t(tcache.entries.size()));
+			profiler::set_level(profiler::counter::textures_alive, int64_t(tcache.atlas.page_count()));
+			if(profiler::common_recorder::instance.enabled)
+				profiler::common_recorder::instance.end_frame();
+		}
+
+		auto frame_end = frame_clock::now();
+		++stats_frames;
+		stats_frame_seconds += std::chrono::duration<double>(frame_end - frame_start).count();
+		auto stats_elapsed = std::chrono::duration<double>(frame_end - stats_start).count();
+		if(stats_elapsed >= 1.0) {
+			auto cpu_now = process_cpu_time();
+			frames_per_second = float(double(stats_frames) / stats_elapsed);
+			average_frame_ms = float(1000.0 * stats_frame_seconds / double(stats_frames));
+			cpu_percent = float(100.0 * (double(cpu_now - stats_start_cpu) * 1.0e-7) / stats_elapsed);
+			stats_start = frame_end;
+			stats_start_cpu = cpu_now;
+			stats_frames = 0;
+			stats_frame_seconds = 0.0;
+		}
+
 		glfwSwapBuffers(window);
 	}
 
 	// Cleanup
+	ui_batch.release();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -147,6 +147,197 @@ void plutovg_memfill32(unsigned int* dest, int length, unsigned int value)
 
 #endif // __SSE2__
 
+#ifdef PLUTOVG_HAS_SSE2
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#include <cpuid.h>
+#else
+#include <intrin.h>
+#endif
+
+static int plutovg_detect_cpu_features(void)
+{
+    int features = PLUTOVG_CPU_SSE2;
+    unsigned int regs[4] = { 0, 0, 0, 0 };
+#if defined(__GNUC__) || defined(__clang__)
+    if(!__get_cpuid(1, &regs[0], &regs[1], &regs[2], &regs[3]))
+        return features;
+#else
+    __cpuidex((int*)regs, 1, 0);
+#endif
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+    if(!osxsave || !avx)
+        return features;
+
+    // the os has to save the ymm registers on context switches as well
+#if defined(__GNUC__) || defined(__clang__)
+    unsigned int xcr0_lo, xcr0_hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    unsigned long long xcr0 = ((unsigned long long)xcr0_hi << 32) | xcr0_lo;
+    if(!__get_cpuid_count(7, 0, &regs[0], &regs[1], &regs[2], &regs[3]))
+        return features;
+#else
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex((int*)regs, 7, 0);
+#endif
+    if((xcr0 & 0x6) == 0x6 && (regs[1] & (1u << 5)) != 0)
+        features |= PLUTOVG_CPU_AVX2;
+    return features;
+}
+
+// written by whichever thread gets here first; every thread computes the same value
+static volatile int detected_cpu_features = -1;
+static volatile bool simd_enabled = true;
+
+int plutovg_cpu_features(void)
+{
+    if(!simd_enabled)
+        return 0;
+    int features = detected_cpu_features;
+    if(features < 0) {
+        features = plutovg_detect_cpu_features();
+        detected_cpu_features = features;
+    }
+
+    return features;
+}
+
+void plutovg_set_simd_enabled(bool enabled)
+{
+    simd_enabled = enabled;
+}
+
+// BYTE_MUL on pixels widened to 16 bits per channel; the sums cannot overflow 16 bits, so this matches it exactly
+static inline __m128i byte_mul_epi16(__m128i x, __m128i a)
+{
+    __m128i t = _mm_mullo_epi16(x, a);
+    t = _mm_add_epi16(t, _mm_srli_epi16(t, 8));
+    t = _mm_add_epi16(t, _mm_set1_epi16(0x80));
+    return _mm_srli_epi16(t, 8);
+}
+
+static inline __m128i byte_mul_pixels(__m128i x, __m128i a)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = byte_mul_epi16(_mm_unpacklo_epi8(x, zero), a);
+    __m128i hi = byte_mul_epi16(_mm_unpackhi_epi8(x, zero), a);
+    return _mm_packus_epi16(lo, hi);
+}
+
+// 255 - alpha of each pixel, repeated across that pixel's four 16 bit channels
+static inline __m128i inverse_alpha_epi16(__m128i x)
+{
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_sub_epi16(_mm_set1_epi16(255), a);
+}
+
+// the kernels below return how many pixels they handled; the caller finishes the rest with the scalar loop
+static int composition_solid_source_over_sse2(uint32_t* dest, int length, uint32_t color, uint32_t ialpha)
+{
+    __m128i c = _mm_set1_epi32((int)color);
+    __m128i ia = _mm_set1_epi16((short)ialpha);
+    int i = 0;
+    for(; i + 4 <= length; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_add_epi32(c, byte_mul_pixels(d, ia)));
+    }
+
+    return i;
+}
+
+static int composition_source_over_sse2(uint32_t* dest, int length, const uint32_t* src, uint32_t const_alpha)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i ca = _mm_set1_epi16((short)const_alpha);
+    int i = 0;
+    for(; i + 4 <= length; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        if(const_alpha != 255)
+            s = byte_mul_pixels(s, ca);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+        // an opaque source multiplies the destination by 0 and a transparent one by 255, so no special cases are needed
+        __m128i lo = byte_mul_epi16(_mm_unpacklo_epi8(d, zero), inverse_alpha_epi16(_mm_unpacklo_epi8(s, zero)));
+        __m128i hi = byte_mul_epi16(_mm_unpackhi_epi8(d, zero), inverse_alpha_epi16(_mm_unpackhi_epi8(s, zero)));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_add_epi32(s, _mm_packus_epi16(lo, hi)));
+    }
+
+    return i;
+}
+
+static inline __m256i byte_mul_epi16_avx2(__m256i x, __m256i a) PLUTOVG_TARGET_AVX2;
+static inline __m256i byte_mul_epi16_avx2(__m256i x, __m256i a)
+{
+    __m256i t = _mm256_mullo_epi16(x, a);
+    t = _mm256_add_epi16(t, _mm256_srli_epi16(t, 8));
+    t = _mm256_add_epi16(t, _mm256_set1_epi16(0x80));
+    return _mm256_srli_epi16(t, 8);
+}
+
+static inline __m256i byte_mul_pixels_avx2(__m256i x, __m256i a) PLUTOVG_TARGET_AVX2;
+static inline __m256i byte_mul_pixels_avx2(__m256i x, __m256i a)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i lo = byte_mul_epi16_avx2(_mm256_unpacklo_epi8(x, zero), a);
+    __m256i hi = byte_mul_epi16_avx2(_mm256_unpackhi_epi8(x, zero), a);
+    return _mm256_packus_epi16(lo, hi);
+}
+
+static inline __m256i inverse_alpha_epi16_avx2(__m256i x) PLUTOVG_TARGET_AVX2;
+static inline __m256i inverse_alpha_epi16_avx2(__m256i x)
+{
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+}
+
+static int composition_solid_source_over_avx2(uint32_t* dest, int length, uint32_t color, uint32_t ialpha) PLUTOVG_TARGET_AVX2;
+static int composition_solid_source_over_avx2(uint32_t* dest, int length, uint32_t color, uint32_t ialpha)
+{
+    __m256i c = _mm256_set1_epi32((int)color);
+    __m256i ia = _mm256_set1_epi16((short)ialpha);
+    int i = 0;
+    for(; i + 8 <= length; i += 8) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dest + i));
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_add_epi32(c, byte_mul_pixels_avx2(d, ia)));
+    }
+
+    return i;
+}
+
+static int composition_source_over_avx2(uint32_t* dest, int length, const uint32_t* src, uint32_t const_alpha) PLUTOVG_TARGET_AVX2;
+static int composition_source_over_avx2(uint32_t* dest, int length, const uint32_t* src, uint32_t const_alpha)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i ca = _mm256_set1_epi16((short)const_alpha);
+    int i = 0;
+    for(; i + 8 <= length; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        if(const_alpha != 255)
+            s = byte_mul_pixels_avx2(s, ca);
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dest + i));
+        __m256i lo = byte_mul_epi16_avx2(_mm256_unpacklo_epi8(d, zero), inverse_alpha_epi16_avx2(_mm256_unpacklo_epi8(s, zero)));
+        __m256i hi = byte_mul_epi16_avx2(_mm256_unpackhi_epi8(d, zero), inverse_alpha_epi16_avx2(_mm256_unpackhi_epi8(s, zero)));
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_add_epi32(s, _mm256_packus_epi16(lo, hi)));
+    }
+
+    return i;
+}
+
+#else
+
+int plutovg_cpu_features(void)
+{
+    return 0;
+}
+
+void plutovg_set_simd_enabled(bool enabled)
+{
+}
+
+#endif // PLUTOVG_HAS_SSE2
+
 static inline int gradient_clamp(const gradient_data_t* gradient, int ipos)
 {
     if(gradient->spread == PLUTOVG_SPREAD_METHOD_REPEAT) {
@@ -182,6 +373,39 @@ static inline uint32_t gradient_pixel(const gradient_data_t* gradient, float pos
     return gradient->colortable[gradient_clamp(gradient, ipos)];
 }
 
+#ifdef PLUTOVG_HAS_SSE2
+// the fixed point loop of fetch_linear_gradient, eight pixels at a time with the color table lookups gathered
+static int fetch_linear_gradient_fixed_avx2(uint32_t* buffer, const gradient_data_t* gradient, int t_fixed, int inc_fixed, int length) PLUTOVG_TARGET_AVX2;
+static int fetch_linear_gradient_fixed_avx2(uint32_t* buffer, const gradient_data_t* gradient, int t_fixed, int inc_fixed, int length)
+{
+    __m256i t = _mm256_add_epi32(_mm256_set1_epi32(t_fixed), _mm256_mullo_epi32(_mm256_set1_epi32(inc_fixed), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    __m256i step = _mm256_set1_epi32(inc_fixed * 8);
+    __m256i half = _mm256_set1_epi32(FIXPT_SIZE / 2);
+    __m256i last = _mm256_set1_epi32(COLOR_TABLE_SIZE - 1);
+    __m256i reflect_limit = _mm256_set1_epi32(COLOR_TABLE_SIZE * 2 - 1);
+    const int* table = (const int*)gradient->colortable;
+    int i = 0;
+    for(; i + 8 <= length; i += 8) {
+        // same as gradient_clamp: the table size is a power of two, so the modulo of the repeat and reflect modes is a mask
+        __m256i ipos = _mm256_srai_epi32(_mm256_add_epi32(t, half), FIXPT_BITS);
+        if(gradient->spread == PLUTOVG_SPREAD_METHOD_REPEAT) {
+            ipos = _mm256_and_si256(ipos, last);
+        } else if(gradient->spread == PLUTOVG_SPREAD_METHOD_REFLECT) {
+            ipos = _mm256_and_si256(ipos, reflect_limit);
+            __m256i mirrored = _mm256_sub_epi32(reflect_limit, ipos);
+            ipos = _mm256_blendv_epi8(ipos, mirrored, _mm256_cmpgt_epi32(ipos, last));
+        } else {
+            ipos = _mm256_min_epi32(_mm256_max_epi32(ipos, _mm256_setzero_si256()), last);
+        }
+
+        _mm256_storeu_si256((__m256i*)(buffer + i), _mm256_i32gather_epi32(table, ipos, 4));
+        t = _mm256_add_epi32(t, step);
+    }
+
+    return i;
+}
+#endif
+
 static void fetch_linear_gradient(uint32_t* buffer, const linear_gradient_values_t* v, const gradient_data_t* gradient, int y, int x, int length)
 {
     float t, inc;
@@ -205,6 +429,13 @@ static void fetch_linear_gradient(uint32_t* buffer, const linear_gradient_values
         if(t + inc * length < (float)(INT_MAX >> (FIXPT_BITS + 1)) && t + inc * length > (float)(INT_MIN >> (FIXPT_BITS + 1))) {
             int t_fixed = (int)(t * FIXPT_SIZE);
             int inc_fixed = (int)(inc * FIXPT_SIZE);
+#ifdef PLUTOVG_HAS_SSE2
+            if(plutovg_cpu_features() & PLUTOVG_CPU_AVX2) {
+                int done = fetch_linear_gradient_fixed_avx2(buffer, gradient, t_fixed, inc_fixed, length);
+                buffer += done;
+                t_fixed += done * inc_fixed;
+            }
+#endif
             while(buffer < end) {
                 *buffer = gradient_pixel_fixed(gradient, t_fixed);
                 t_fixed += inc_fixed;
@@ -320,7 +551,16 @@ static void composition_solid_source_over(uint32_t* dest, int length, uint32_t c
     if(const_alpha != 255)
         color = BYTE_MUL(color, const_alpha);
     uint32_t ialpha = 255 - plutovg_alpha(color);
-    for(int i = 0; i < length; i++) {
+    int i = 0;
+#ifdef PLUTOVG_HAS_SSE2
+    int features = plutovg_cpu_features();
+    if(features & PLUTOVG_CPU_AVX2) {
+        i = composition_solid_source_over_avx2(dest, length, color, ialpha);
+    } else if(features & PLUTOVG_CPU_SSE2) {
+        i = composition_solid_source_over_sse2(dest, length, color, ialpha);
+    }
+#endif
+    for(; i < length; i++) {
         dest[i] = color + BYTE_MUL(dest[i], ialpha);
     }
 }
@@ -470,8 +710,17 @@ static void composition_destination(uint32_t* dest, int length, const uint32_t*
 
 static void composition_source_over(uint32_t* dest, int length, const uint32_t* src, uint32_t const_alpha)
 {
+    int i = 0;
+#ifdef PLUTOVG_HAS_SSE2
+    int features = plutovg_cpu_features();
+    if(features & PLUTOVG_CPU_AVX2) {
+        i = composition_source_over_avx2(dest, length, src, const_alpha);
+    } else if(features & PLUTOVG_CPU_SSE2) {
+        i = composition_source_over_sse2(dest, length, src, const_alpha);
+    }
+#endif
     if(const_alpha == 255) {
-        for(int i = 0; i < length; i++) {
+        for(; i < length; i++) {
             uint32_t s = src[i];
             if(s >= 0xff000000) {
                 dest[i] = s;
@@ -480,7 +729,7 @@ static void composition_source_over(uint32_t* dest, int length, const uint32_t*
             }
         }
     } else {
-        for(int i = 0; i < length; i++) {
+        for(; i < length; i++) {
             uint32_t s = BYTE_MUL(src[i], const_alpha);
             dest[i] = s + BYTE_MUL(dest[i], plutovg_alpha(~s));
         }
@@ -1,6 +1,8 @@
 #include "plutovg-private.h"
 #include "plutovg-utils.h"
 
+#include <limits.h>
+
 int plutovg_version(void)
 {
     return PLUTOVG_VERSION;
@@ -91,6 +93,9 @@ plutovg_canvas_t* plutovg_canvas_create(plutovg_surface_t* surface)
     canvas->clip_rect = PLUTOVG_MAKE_RECT(0.f, 0.f, (float)(surface->width), (float)(surface->height));
     plutovg_span_buffer_init(&canvas->clip_spans);
     plutovg_span_buffer_init(&canvas->fill_spans);
+    plutovg_rasterizer_init(&canvas->rasterizer);
+    canvas->bands = NULL;
+    canvas->num_bands = 0;
     return canvas;
 }
 
@@ -118,6 +123,14 @@ void plutovg_canvas_destroy(plutovg_canvas_t* canvas)
         plutovg_font_face_cache_destroy(canvas->face_cache);
         plutovg_span_buffer_destroy(&canvas->fill_spans);
         plutovg_span_buffer_destroy(&canvas->clip_spans);
+        for(int i = 0; i < canvas->num_bands; i++) {
+            plutovg_span_buffer_destroy(&canvas->bands[i].fill_spans);
+            plutovg_span_buffer_destroy(&canvas->bands[i].clip_spans);
+            plutovg_cell_pool_destroy(&canvas->bands[i].cells);
+        }
+
+        free(canvas->bands);
+        plutovg_rasterizer_destroy(&canvas->rasterizer);
         plutovg_surface_destroy(canvas->surface);
         plutovg_path_destroy(canvas->path);
         free(canvas);
@@ -134,6 +147,25 @@ plutovg_surface_t* plutovg_canvas_get_surface(const plutovg_canvas_t* canvas)
     return canvas->surface;
 }
 
+void plutovg_canvas_reset(plutovg_canvas_t* canvas, plutovg_surface_t* surface)
+{
+    while(canvas->state->next)
+        plutovg_canvas_restore(canvas);
+    plutovg_state_reset(canvas->state);
+    plutovg_path_reset(canvas->path);
+    plutovg_span_buffer_reset(&canvas->clip_spans);
+    plutovg_span_buffer_reset(&canvas->fill_spans);
+
+    surface = plutovg_surface_reference(surface);
+    plutovg_surface_destroy(canvas->surface);
+    canvas->surface = surface;
+    if(surface) {
+        canvas->clip_rect = PLUTOVG_MAKE_RECT(0.f, 0.f, (float)(surface->width), (float)(surface->height));
+    } else {
+        canvas->clip_rect = PLUTOVG_MAKE_RECT(0.f, 0.f, 0.f, 0.f);
+    }
+}
+
 void plutovg_canvas_save(plutovg_canvas_t* canvas)
 {
     plutovg_state_t* new_state = canvas->freed_state;
@@ -504,13 +536,13 @@ plutovg_path_t* plutovg_canvas_get_path(const plutovg_canvas_t* canvas)
 
 bool plutovg_canvas_fill_contains(plutovg_canvas_t* canvas, float x, float y)
 {
-    plutovg_rasterize(&canvas->fill_spans, canvas->path, &canvas->state->matrix, NULL, NULL, canvas->state->winding);
+    plutovg_rasterize(&canvas->rasterizer, &canvas->fill_spans, canvas->path, &canvas->state->matrix, NULL, NULL, canvas->state->winding);
     return plutovg_span_buffer_contains(&canvas->fill_spans, x, y);
 }
 
 bool plutovg_canvas_stroke_contains(plutovg_canvas_t* canvas, float x, float y)
 {
-    plutovg_rasterize(&canvas->fill_spans, canvas->path, &canvas->state->matrix, NULL, NULL, canvas->state->winding);
+    plutovg_rasterize(&canvas->rasterizer, &canvas->fill_spans, canvas->path, &canvas->state->matrix, NULL, NULL, canvas->state->winding);
     return plutovg_span_buffer_contains(&canvas->fill_spans, x, y);
 }
 
@@ -530,13 +562,13 @@ bool plutovg_canvas_clip_contains(plutovg_canvas_t* canvas, float x, float y)
 
 void plutovg_canvas_fill_extents(plutovg_canvas_t *canvas, plutovg_rect_t* extents)
 {
-    plutovg_rasterize(&canvas->fill_spans, canvas->path, &canvas->state->matrix, NULL, NULL, canvas->state->winding);
+    plutovg_rasterize(&canvas->rasterizer, &canvas->fill_spans, canvas->path, &canvas->state->matrix, NULL, NULL, canvas->state->winding);
     plutovg_span_buffer_extents(&canvas->fill_spans, extents);
 }
 
 void plutovg_canvas_stroke_extents(plutovg_canvas_t *canvas, plutovg_rect_t* extents)
 {
-    plutovg_rasterize(&canvas->fill_spans, canvas->path, &canvas->state->matrix, NULL, &canvas->state->stroke, PLUTOVG_FILL_RULE_NON_ZERO);
+    plutovg_rasterize(&canvas->rasterizer, &canvas->fill_spans, canvas->path, &canvas->state->matrix, NULL, &canvas->state->stroke, PLUTOVG_FILL_RULE_NON_ZERO);
     plutovg_span_buffer_extents(&canvas->fill_spans, extents);
 }
 
@@ -570,19 +602,181 @@ void plutovg_canvas_clip(plutovg_canvas_t* canvas)
     plutovg_canvas_new_path(canvas);
 }
 
-void plutovg_canvas_paint(plutovg_canvas_t* canvas)
-{
+typedef struct {
+    plutovg_parallel_func_t func;
+    void* closure;
+    int concurrency;
+} plutovg_parallel_t;
+
+static plutovg_parallel_t parallel = {NULL, NULL, 1};
+
+void plutovg_set_parallel_func(plutovg_parallel_func_t func, void* closure, int concurrency)
+{
+    parallel.func = func;
+    parallel.closure = closure;
+    parallel.concurrency = func ? plutovg_max(concurrency, 1) : 1;
+}
+
+// bands are at least this many rows, and a draw is only split when it covers at least this many pixels
+#define PLUTOVG_MIN_BAND_ROWS 32
+#define PLUTOVG_MIN_PARALLEL_AREA (256 * 256)
+
+typedef enum {
+    PLUTOVG_BAND_PAINT, // the clip, or the whole surface
+    PLUTOVG_BAND_FILL, // the rows of an outline
+    PLUTOVG_BAND_FILL_DIRECT, // the same, blended as they are rasterized
+    PLUTOVG_BAND_COVERAGE, // the rows of coverage rasterized earlier
+    PLUTOVG_BAND_COLLECT // the rows of an outline, left in the band to make coverage from
+} plutovg_band_mode_t;
+
+typedef struct {
+    plutovg_canvas_t* canvas;
+    plutovg_band_mode_t mode;
+    const struct PVG_FT_Outline_* outline;
+    const plutovg_span_buffer_t* coverage;
+    int min_row;
+    int max_row;
+    int band_rows;
+} plutovg_band_job_t;
+
+// a view of the spans of source that lie in the rows from min_row up to max_row; source is sorted by row
+static void plutovg_span_buffer_rows(plutovg_span_buffer_t* rows, const plutovg_span_buffer_t* source, int min_row, int max_row)
+{
+    const plutovg_span_t* spans = source->spans.data;
+    int first = 0;
+    int last = source->spans.size;
+    while(first < last) {
+        int middle = first + (last - first) / 2;
+        if(spans[middle].y < min_row) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+
+    last = first;
+    while(last < source->spans.size && spans[last].y < max_row)
+        ++last;
+    rows->spans.data = source->spans.data + first;
+    rows->spans.size = last - first;
+    rows->spans.capacity = last - first;
+    rows->x = 0;
+    rows->y = 0;
+    rows->w = -1;
+    rows->h = -1;
+}
+
+static void plutovg_band_run(void* data, int index)
+{
+    plutovg_band_job_t* job = (plutovg_band_job_t*)(data);
+    plutovg_canvas_t* canvas = job->canvas;
+    plutovg_band_t* band = &canvas->bands[index];
+    int min_row = job->min_row + index * job->band_rows;
+    int max_row = plutovg_min(min_row + job->band_rows, job->max_row);
+
+    plutovg_span_buffer_t clip_rows;
+    if(canvas->state->clipping)
+        plutovg_span_buffer_rows(&clip_rows, &canvas->state->clip_spans, min_row, max_row);
+    plutovg_span_buffer_t coverage_rows;
+    const plutovg_span_buffer_t* spans = &band->fill_spans;
+    switch(job->mode) {
+    case PLUTOVG_BAND_PAINT:
+        if(canvas->state->clipping) {
+            plutovg_blend(canvas, &clip_rows);
+        } else {
+            plutovg_span_buffer_init_rect(&band->fill_spans, 0, min_row, canvas->surface->width, max_row - min_row);
+            plutovg_blend(canvas, &band->fill_spans);
+        }
+
+        return;
+    case PLUTOVG_BAND_FILL_DIRECT:
+        plutovg_outline_blend(canvas, job->outline, &canvas->clip_rect, min_row, max_row, &band->cells);
+        return;
+    case PLUTOVG_BAND_COLLECT:
+        plutovg_outline_rasterize(&band->fill_spans, job->outline, &canvas->clip_rect, min_row, max_row, &band->cells);
+        return;
+    case PLUTOVG_BAND_FILL:
+        plutovg_outline_rasterize(&band->fill_spans, job->outline, &canvas->clip_rect, min_row, max_row, &band->cells);
+        break;
+    case PLUTOVG_BAND_COVERAGE:
+        plutovg_span_buffer_rows(&coverage_rows, job->coverage, min_row, max_row);
+        spans = &coverage_rows;
+        break;
+    }
+
     if(canvas->state->clipping) {
-        plutovg_blend(canvas, &canvas->state->clip_spans);
+        plutovg_span_buffer_intersect(&band->clip_spans, spans, &clip_rows);
+        plutovg_blend(canvas, &band->clip_spans);
     } else {
-        plutovg_span_buffer_init_rect(&canvas->clip_spans, 0, 0, canvas->surface->width, canvas->surface->height);
-        plutovg_blend(canvas, &canvas->clip_spans);
+        plutovg_blend(canvas, spans);
     }
 }
 
-void plutovg_canvas_fill_preserve(plutovg_canvas_t* canvas)
+// splits the rows of extents into bands and runs them through the parallel function; returns how many bands there were,
+// or 0 when the rows are too few to be worth splitting
+static int plutovg_canvas_draw_bands(plutovg_canvas_t* canvas, plutovg_band_mode_t mode, const struct PVG_FT_Outline_* outline, const plutovg_span_buffer_t* coverage, const plutovg_rect_t* extents, const plutovg_parallel_t* executor)
+{
+    int min_row = (int)extents->y;
+    int max_row = (int)(extents->y + extents->h);
+    if(canvas->state->clipping && mode != PLUTOVG_BAND_COLLECT) {
+        plutovg_rect_t clip_extents;
+        plutovg_span_buffer_extents(&canvas->state->clip_spans, &clip_extents);
+        min_row = plutovg_max(min_row, (int)clip_extents.y);
+        max_row = plutovg_min(max_row, (int)(clip_extents.y + clip_extents.h));
+    }
+
+    int rows = max_row - min_row;
+    if(rows <= 0 || (float)rows * extents->w < PLUTOVG_MIN_PARALLEL_AREA)
+        return 0;
+    int count = plutovg_min(rows / PLUTOVG_MIN_BAND_ROWS, executor->concurrency * 4);
+    if(count < 2)
+        return 0;
+    int band_rows = (rows + count - 1) / count;
+    count = (rows + band_rows - 1) / band_rows;
+    if(count > canvas->num_bands) {
+        canvas->bands = (plutovg_band_t*)realloc(canvas->bands, count * sizeof(plutovg_band_t));
+        for(int i = canvas->num_bands; i < count; i++) {
+            plutovg_span_buffer_init(&canvas->bands[i].fill_spans);
+            plutovg_span_buffer_init(&canvas->bands[i].clip_spans);
+            plutovg_cell_pool_init(&canvas->bands[i].cells);
+        }
+
+        canvas->num_bands = count;
+    }
+
+    plutovg_band_job_t job = {canvas, mode, outline, coverage, min_row, max_row, band_rows};
+    executor->func(executor->closure, count, plutovg_band_run, &job);
+    return count;
+}
+
+// a solid color blends the same span by span, so unclipped fills of one skip collecting their spans
+static bool plutovg_canvas_blends_spans_directly(const plutovg_canvas_t* canvas)
 {
-    plutovg_rasterize(&canvas->fill_spans, canvas->path, &canvas->state->matrix, &canvas->clip_rect, NULL, canvas->state->winding);
+    if(canvas->state->clipping)
+        return false;
+    return canvas->state->paint == NULL || canvas->state->paint->type == PLUTOVG_PAINT_TYPE_COLOR;
+}
+
+static void plutovg_canvas_fill_outline(plutovg_canvas_t* canvas, const plutovg_stroke_data_t* stroke_data, plutovg_fill_rule_t winding)
+{
+    plutovg_parallel_t executor = parallel;
+    const struct PVG_FT_Outline_* outline = plutovg_rasterizer_convert(&canvas->rasterizer, canvas->path, &canvas->state->matrix, stroke_data, winding);
+    bool direct = plutovg_canvas_blends_spans_directly(canvas);
+    if(executor.func) {
+        plutovg_rect_t extents;
+        plutovg_outline_extents(outline, &canvas->clip_rect, &extents);
+        plutovg_band_mode_t mode = direct ? PLUTOVG_BAND_FILL_DIRECT : PLUTOVG_BAND_FILL;
+        if(plutovg_canvas_draw_bands(canvas, mode, outline, NULL, &extents, &executor)) {
+            return;
+        }
+    }
+
+    if(direct) {
+        plutovg_outline_blend(canvas, outline, &canvas->clip_rect, INT_MIN, INT_MAX, &canvas->rasterizer.cells);
+        return;
+    }
+
+    plutovg_outline_rasterize(&canvas->fill_spans, outline, &canvas->clip_rect, INT_MIN, INT_MAX, &canvas->rasterizer.cells);
     if(canvas->state->clipping) {
         plutovg_span_buffer_intersect(&canvas->clip_spans, &canvas->fill_spans, &canvas->state->clip_spans);
         plutovg_blend(canvas, &canvas->clip_spans);
@@ -591,25 +785,42 @@ void plutovg_canvas_fill_preserve(plutovg_canvas_t* canvas)
     }
 }
 
-void plutovg_canvas_stroke_preserve(plutovg_canvas_t* canvas)
+void plutovg_canvas_paint(plutovg_canvas_t* canvas)
 {
-    plutovg_rasterize(&canvas->fill_spans, canvas->path, &canvas->state->matrix, &canvas->clip_rect, &canvas->state->stroke, PLUTOVG_FILL_RULE_NON_ZERO);
+    plutovg_parallel_t executor = parallel;
+    if(executor.func) {
+        plutovg_rect_t extents = PLUTOVG_MAKE_RECT(0.f, 0.f, (float)(canvas->surface->width), (float)(canvas->surface->height));
+        if(plutovg_canvas_draw_bands(canvas, PLUTOVG_BAND_PAINT, NULL, NULL, &extents, &executor)) {
+            return;
+        }
+    }
+
     if(canvas->state->clipping) {
-        plutovg_span_buffer_intersect(&canvas->clip_spans, &canvas->fill_spans, &canvas->state->clip_spans);
-        plutovg_blend(canvas, &canvas->clip_spans);
+        plutovg_blend(canvas, &canvas->state->clip_spans);
     } else {
-        plutovg_blend(canvas, &canvas->fill_spans);
+        plutovg_span_buffer_init_rect(&canvas->clip_spans, 0, 0, canvas->surface->width, canvas->surface->height);
+        plutovg_blend(canvas, &canvas->clip_spans);
     }
 }
 
+void plutovg_canvas_fill_preserve(plutovg_canvas_t* canvas)
+{
+    plutovg_canvas_fill_outline(canvas, NULL, canvas->state->winding);
+}
+
+void plutovg_canvas_stroke_preserve(plutovg_canvas_t* canvas)
+{
+    plutovg_canvas_fill_outline(canvas, &canvas->state->stroke, PLUTOVG_FILL_RULE_NON_ZERO);
+}
+
 void plutovg_canvas_clip_preserve(plutovg_canvas_t* canvas)
 {
     if(canvas->state->clipping) {
-        plutovg_rasterize(&canvas->fill_spans, canvas->path, &canvas->state->matrix, &canvas->clip_rect, NULL, canvas->state->winding);
+        plutovg_rasterize(&canvas->rasterizer, &canvas->fill_spans, canvas->path, &canvas->state->matrix, &canvas->clip_rect, NULL, canvas->state->winding);
         plutovg_span_buffer_intersect(&canvas->clip_spans, &canvas->fill_spans, &canvas->state->clip_spans);
         plutovg_span_buffer_copy(&canvas->state->clip_spans, &canvas->clip_spans);
     } else {
-        plutovg_rasterize(&canvas->state->clip_spans, canvas->path, &canvas->state->matrix, &canvas->clip_rect, NULL, canvas->state->winding);
+        plutovg_rasterize(&canvas->rasterizer, &canvas->state->clip_spans, canvas->path, &canvas->state->matrix, &canvas->clip_rect, NULL, canvas->state->winding);
         canvas->state->clipping = true;
     }
 }
@@ -642,6 +853,66 @@ void plutovg_canvas_stroke_path(plutovg_canvas_t* canvas, const plutovg_path_t*
     plutovg_canvas_stroke(canvas);
 }
 
+plutovg_coverage_t* plutovg_canvas_stroke_coverage(plutovg_canvas_t* canvas, const plutovg_path_t* path)
+{
+    plutovg_coverage_t* coverage = (plutovg_coverage_t*)malloc(sizeof(plutovg_coverage_t));
+    plutovg_span_buffer_init(&coverage->spans);
+
+    plutovg_parallel_t executor = parallel;
+    const struct PVG_FT_Outline_* outline = plutovg_rasterizer_convert(&canvas->rasterizer, path, &canvas->state->matrix, &canvas->state->stroke, PLUTOVG_FILL_RULE_NON_ZERO);
+    int bands = 0;
+    if(executor.func) {
+        plutovg_rect_t extents;
+        plutovg_outline_extents(outline, &canvas->clip_rect, &extents);
+        bands = plutovg_canvas_draw_bands(canvas, PLUTOVG_BAND_COLLECT, outline, NULL, &extents, &executor);
+    }
+
+    if(bands == 0) {
+        plutovg_outline_rasterize(&coverage->spans, outline, &canvas->clip_rect, INT_MIN, INT_MAX, &canvas->rasterizer.cells);
+    } else {
+        for(int i = 0; i < bands; i++) {
+            plutovg_array_append_span(coverage->spans.spans, canvas->bands[i].fill_spans.spans);
+        }
+    }
+
+    // kept for as long as the caller wants it, so without the room left over from growing
+    if(coverage->spans.spans.size > 0 && coverage->spans.spans.size < coverage->spans.spans.capacity) {
+        coverage->spans.spans.data = (plutovg_span_t*)realloc(coverage->spans.spans.data, coverage->spans.spans.size * sizeof(plutovg_span_t));
+        coverage->spans.spans.capacity = coverage->spans.spans.size;
+    }
+
+    plutovg_span_buffer_extents(&coverage->spans, &coverage->extents);
+    return coverage;
+}
+
+void plutovg_canvas_fill_coverage(plutovg_canvas_t* canvas, const plutovg_coverage_t* coverage)
+{
+    plutovg_parallel_t executor = parallel;
+    if(executor.func && plutovg_canvas_draw_bands(canvas, PLUTOVG_BAND_COVERAGE, NULL, &coverage->spans, &coverage->extents, &executor)) {
+        return;
+    }
+
+    if(canvas->state->clipping) {
+        plutovg_span_buffer_intersect(&canvas->clip_spans, &coverage->spans, &canvas->state->clip_spans);
+        plutovg_blend(canvas, &canvas->clip_spans);
+    } else {
+        plutovg_blend(canvas, &coverage->spans);
+    }
+}
+
+int plutovg_coverage_get_size(const plutovg_coverage_t* coverage)
+{
+    return (int)(sizeof(plutovg_coverage_t) + coverage->spans.spans.capacity * sizeof(plutovg_span_t));
+}
+
+void plutovg_coverage_destroy(plutovg_coverage_t* coverage)
+{
+    if(coverage == NULL)
+        return;
+    plutovg_span_buffer_destroy(&coverage->spans);
+    free(coverage);
+}
+
 void plutovg_canvas_clip_rect(plutovg_canvas_t* canvas, float x, float y, float w, float h)
 {
     plutovg_canvas_new_path(canvas);
@@ -81,6 +81,7 @@ typedef ptrdiff_t  PVG_FT_PtrDist;
 #include <limits.h>
 
 #define PVG_FT_MINIMUM_POOL_SIZE 8192
+#define PVG_FT_MAXIMUM_POOL_SIZE ( 256 * 1024 )
 
 #define RAS_ARG   PWorker  worker
 #define RAS_ARG_  PWorker  worker,
@@ -176,6 +177,7 @@ PVG_FT_END_STMNT
 
     PVG_FT_Outline  outline;
     PVG_FT_BBox     clip_box;
+    TPos        min_row, max_row;
 
     int clip_flags;
     int clipping;
@@ -189,6 +191,7 @@ PVG_FT_END_STMNT
 
     int  band_size;
     int  band_shoot;
+    int  num_passes;
 
     pvg_ft_jmp_buf  jump_buffer;
 
@@ -1698,6 +1701,15 @@ void PVG_FT_Outline_Get_CBox(const PVG_FT_Outline* outline, PVG_FT_BBox* acbox)
     clip->xMax = (ras.max_ex + 1) * ONE_PIXEL;
     clip->yMax = (ras.max_ey + 1) * ONE_PIXEL;
 
+    /* the geometric clipping above is that of a render of every row, */
+    /* which keeps the cells of the rows that remain the same         */
+    if ( ras.min_ey < ras.min_row )
+      ras.min_ey = ras.min_row;
+    if ( ras.max_ey > ras.max_row )
+      ras.max_ey = ras.max_row;
+    if ( ras.min_ey >= ras.max_ey )
+      return 0;
+
     ras.count_ex = ras.max_ex - ras.min_ex;
     ras.count_ey = ras.max_ey - ras.min_ey;
 
@@ -1764,6 +1776,7 @@ void PVG_FT_Outline_Get_CBox(const PVG_FT_Outline* outline, PVG_FT_BBox* acbox)
         ras.max_ey    = band->max;
         ras.count_ey  = band->max - band->min;
 
+        ras.num_passes++;
         error = gray_convert_glyph_inner( RAS_VAR );
 
         if ( !error )
@@ -1855,12 +1868,24 @@ void PVG_FT_Outline_Get_CBox(const PVG_FT_Outline* outline, PVG_FT_BBox* acbox)
       ras.clip_box.yMax =  (1 << 23) - 1;
     }
 
+    if ( params->flags & PVG_FT_RASTER_FLAG_ROWS )
+    {
+      ras.min_row = params->min_row;
+      ras.max_row = params->max_row;
+    }
+    else
+    {
+      ras.min_row = -(1 << 23);
+      ras.max_row =  (1 << 23) - 1;
+    }
+
     gray_init_cells( RAS_VAR_ buffer, buffer_size );
 
     ras.outline   = *outline;
     ras.num_cells = 0;
     ras.invalid   = 1;
     ras.band_size = (int)(buffer_size / (long)(sizeof(TCell) * 8));
+    ras.num_passes = 0;
 
     ras.render_span      = (PVG_FT_Raster_Span_Func)params->gray_spans;
     ras.render_span_data = params->user;
@@ -1868,25 +1893,36 @@ void PVG_FT_Outline_Get_CBox(const PVG_FT_Outline* outline, PVG_FT_BBox* acbox)
     return gray_convert_glyph( RAS_VAR );
   }
 
+  static void
+  gray_resize_pool( void** pool, long* pool_size, long size )
+  {
+      free( *pool );
+      *pool = malloc( size );
+      *pool_size = size;
+  }
+
   void
-  PVG_FT_Raster_Render(const PVG_FT_Raster_Params *params)
+  PVG_FT_Raster_Render(const PVG_FT_Raster_Params *params, void** pool, long* pool_size)
   {
-      char stack[PVG_FT_MINIMUM_POOL_SIZE];
-      size_t length = PVG_FT_MINIMUM_POOL_SIZE;
+      if(*pool == NULL)
+          gray_resize_pool(pool, pool_size, PVG_FT_MINIMUM_POOL_SIZE);
 
       TWorker worker;
       worker.skip_spans = 0;
       int rendered_spans = 0;
-      int error = gray_raster_render(&worker, stack, length, params);
+      int error = gray_raster_render(&worker, *pool, *pool_size, params);
       while(error == ErrRaster_OutOfMemory) {
           if(worker.skip_spans < 0)
               rendered_spans += -worker.skip_spans;
           worker.skip_spans = rendered_spans;
-          length *= 2;
-          void* heap = malloc(length);
-          error = gray_raster_render(&worker, heap, length, params);
-          free(heap);
+          gray_resize_pool(pool, pool_size, *pool_size * 2);
+          error = gray_raster_render(&worker, *pool, *pool_size, params);
       }
+
+      /* every pass decomposes the whole outline again, so a pool that */
+      /* takes the next outline like this one in fewer of them pays    */
+      if(worker.num_passes > 1 && *pool_size < PVG_FT_MAXIMUM_POOL_SIZE)
+          gray_resize_pool(pool, pool_size, *pool_size * 2);
   }
 
 /* END */
@@ -347,10 +347,19 @@ typedef void
 /*                              in direct rendering mode where all spans */
 /*                              are generated if no clipping box is set. */
 /*                                                                       */
+/*    PVG_FT_RASTER_FLAG_ROWS    :: If set, only the spans of the rows from  */
+/*                              `min_row' up to (but not including)      */
+/*                              `max_row' are generated.  They are the   */
+/*                              same spans that a render of every row    */
+/*                              produces for those rows, so that the     */
+/*                              rows of one outline can be rendered in   */
+/*                              separate calls.                          */
+/*                                                                       */
 #define PVG_FT_RASTER_FLAG_DEFAULT  0x0
 #define PVG_FT_RASTER_FLAG_AA       0x1
 #define PVG_FT_RASTER_FLAG_DIRECT   0x2
 #define PVG_FT_RASTER_FLAG_CLIP     0x4
+#define PVG_FT_RASTER_FLAG_ROWS     0x8
 
 
 /*************************************************************************/
@@ -386,6 +395,12 @@ typedef void
 /*                   should be expressed in _integer_ pixels (and not in */
 /*                   26.6 fixed-point units).                            */
 /*                                                                       */
+/*    min_row     :: The first row rendered when the                     */
+/*                   @PVG_FT_RASTER_FLAG_ROWS bit flag is set.               */
+/*                                                                       */
+/*    max_row     :: The row after the last one rendered when the        */
+/*                   @PVG_FT_RASTER_FLAG_ROWS bit flag is set.               */
+/*                                                                       */
 /* <Note>                                                                */
 /*    An anti-aliased glyph bitmap is drawn if the @PVG_FT_RASTER_FLAG_AA    */
 /*    bit flag is set in the `flags' field, otherwise a monochrome       */
@@ -410,11 +425,25 @@ typedef struct  PVG_FT_Raster_Params_
     PVG_FT_SpanFunc          gray_spans;
     void*                   user;
     PVG_FT_BBox              clip_box;
+    PVG_FT_Pos               min_row;
+    PVG_FT_Pos               max_row;
 
 } PVG_FT_Raster_Params;
 
 
+/*************************************************************************/
+/*                                                                       */
+/* <Function>                                                            */
+/*    PVG_FT_Raster_Render                                               */
+/*                                                                       */
+/* <Description>                                                         */
+/*    Renders an outline with the memory pool that the caller keeps      */
+/*    from one render to the next.  `*pool' may start out NULL, and is   */
+/*    (re)allocated with `malloc' when it is missing or too small for    */
+/*    the outline; it grows until outlines like the last one fit in a    */
+/*    single pass.  The caller frees it.                                 */
+/*                                                                       */
 void
-PVG_FT_Raster_Render(const PVG_FT_Raster_Params *params);
+PVG_FT_Raster_Render(const PVG_FT_Raster_Params *params, void** pool, long* pool_size);
 
 #endif // PLUTOVG_FT_RASTER_H
@@ -41,6 +41,7 @@ struct plutovg_surface {
     int width;
     int height;
     int stride;
+    int capacity; // pixels that data has room for; 0 when the data belongs to someone else
     unsigned char* data;
 };
 
@@ -165,6 +166,39 @@ typedef struct plutovg_state {
     struct plutovg_state* next;
 } plutovg_state_t;
 
+struct plutovg_coverage {
+    plutovg_span_buffer_t spans;
+    plutovg_rect_t extents;
+};
+
+// the memory that the scan converter keeps its cells in, which grows with the paths given to it
+typedef struct {
+    void* data;
+    long size;
+} plutovg_cell_pool_t;
+
+// a path converted for the rasterizer, in memory that is reused by the next one that fits
+typedef struct {
+    struct PVG_FT_Outline_* outline;
+    int max_points;
+    int max_contours;
+} plutovg_outline_buffer_t;
+
+// what rasterizing keeps from one path to the next, so that it only allocates when a path is larger than any before it
+typedef struct {
+    plutovg_outline_buffer_t outline;
+    plutovg_outline_buffer_t stroke_source; // the path that a stroke outlines
+    struct PVG_FT_StrokerRec_* stroker;
+    plutovg_cell_pool_t cells;
+} plutovg_rasterizer_t;
+
+// the span buffers and cells of one band of rows, when a fill is split across threads
+typedef struct {
+    plutovg_span_buffer_t fill_spans;
+    plutovg_span_buffer_t clip_spans;
+    plutovg_cell_pool_t cells;
+} plutovg_band_t;
+
 struct plutovg_canvas {
     plutovg_ref_count_t ref_count;
     plutovg_surface_t* surface;
@@ -175,6 +209,9 @@ struct plutovg_canvas {
     plutovg_rect_t clip_rect;
     plutovg_span_buffer_t clip_spans;
     plutovg_span_buffer_t fill_spans;
+    plutovg_rasterizer_t rasterizer;
+    plutovg_band_t* bands;
+    int num_bands;
 };
 
 void plutovg_span_buffer_init(plutovg_span_buffer_t* span_buffer);
@@ -186,8 +223,39 @@ bool plutovg_span_buffer_contains(const plutovg_span_buffer_t* span_buffer, floa
 void plutovg_span_buffer_extents(plutovg_span_buffer_t* span_buffer, plutovg_rect_t* extents);
 void plutovg_span_buffer_intersect(plutovg_span_buffer_t* span_buffer, const plutovg_span_buffer_t* a, const plutovg_span_buffer_t* b);
 
-void plutovg_rasterize(plutovg_span_buffer_t* span_buffer, const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_rect_t* clip_rect, const plutovg_stroke_data_t* stroke_data, plutovg_fill_rule_t winding);
+struct PVG_FT_Outline_;
+
+void plutovg_rasterizer_init(plutovg_rasterizer_t* rasterizer);
+void plutovg_rasterizer_destroy(plutovg_rasterizer_t* rasterizer);
+void plutovg_cell_pool_init(plutovg_cell_pool_t* cells);
+void plutovg_cell_pool_destroy(plutovg_cell_pool_t* cells);
+
+// converts the path into the rasterizer's outline, which stays valid until the next conversion
+const struct PVG_FT_Outline_* plutovg_rasterizer_convert(plutovg_rasterizer_t* rasterizer, const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_stroke_data_t* stroke_data, plutovg_fill_rule_t winding);
+void plutovg_outline_extents(const struct PVG_FT_Outline_* outline, const plutovg_rect_t* clip_rect, plutovg_rect_t* extents);
+// the spans of the rows from min_row up to max_row, which are the same as those that rasterizing every row gives for them
+void plutovg_outline_rasterize(plutovg_span_buffer_t* span_buffer, const struct PVG_FT_Outline_* outline, const plutovg_rect_t* clip_rect, int min_row, int max_row, plutovg_cell_pool_t* cells);
+// blends the spans of those rows with the canvas paint as they are produced, for draws that are not clipped
+void plutovg_outline_blend(plutovg_canvas_t* canvas, const struct PVG_FT_Outline_* outline, const plutovg_rect_t* clip_rect, int min_row, int max_row, plutovg_cell_pool_t* cells);
+
+void plutovg_rasterize(plutovg_rasterizer_t* rasterizer, plutovg_span_buffer_t* span_buffer, const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_rect_t* clip_rect, const plutovg_stroke_data_t* stroke_data, plutovg_fill_rule_t winding);
 void plutovg_blend(plutovg_canvas_t* canvas, const plutovg_span_buffer_t* span_buffer);
 void plutovg_memfill32(unsigned int* dest, int length, unsigned int value);
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLUTOVG_HAS_SSE2
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PLUTOVG_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PLUTOVG_TARGET_AVX2
+#endif
+
+#define PLUTOVG_CPU_SSE2 0x1
+#define PLUTOVG_CPU_AVX2 0x2
+
+// the vectorized kernels that may be used: detected once, and empty when plutovg_set_simd_enabled(false) was called
+int plutovg_cpu_features(void);
+
 #endif // PLUTOVG_PRIVATE_H
@@ -165,30 +165,36 @@ void plutovg_span_buffer_intersect(plutovg_span_buffer_t* span_buffer, const plu
 }
 
 #define ALIGN_SIZE(size) (((size) + 7ul) & ~7ul)
-static PVG_FT_Outline* ft_outline_create(int points, int contours)
+// makes room in the buffer for an outline of this size, keeping the memory it already has when that is enough
+static PVG_FT_Outline* ft_outline_reserve(plutovg_outline_buffer_t* buffer, int points, int contours)
 {
-    size_t points_size = ALIGN_SIZE((points + contours) * sizeof(PVG_FT_Vector));
-    size_t tags_size = ALIGN_SIZE((points + contours) * sizeof(char));
-    size_t contours_size = ALIGN_SIZE(contours * sizeof(int));
-    size_t contours_flag_size = ALIGN_SIZE(contours * sizeof(char));
-    PVG_FT_Outline* outline = (PVG_FT_Outline*)malloc(points_size + tags_size + contours_size + contours_flag_size + sizeof(PVG_FT_Outline));
-
-    PVG_FT_Byte* outline_data = (PVG_FT_Byte*)(outline + 1);
-    outline->points = (PVG_FT_Vector*)(outline_data);
-    outline->tags = (char*)(outline_data + points_size);
-    outline->contours = (int*)(outline_data + points_size + tags_size);
-    outline->contours_flag = (char*)(outline_data + points_size + tags_size + contours_size);
+    if(buffer->outline == NULL || points > buffer->max_points || contours > buffer->max_contours) {
+        points = plutovg_max(points, buffer->max_points * 2);
+        contours = plutovg_max(contours, buffer->max_contours * 2);
+        size_t points_size = ALIGN_SIZE((points + contours) * sizeof(PVG_FT_Vector));
+        size_t tags_size = ALIGN_SIZE((points + contours) * sizeof(char));
+        size_t contours_size = ALIGN_SIZE(contours * sizeof(int));
+        size_t contours_flag_size = ALIGN_SIZE(contours * sizeof(char));
+        free(buffer->outline);
+        PVG_FT_Outline* outline = (PVG_FT_Outline*)malloc(points_size + tags_size + contours_size + contours_flag_size + sizeof(PVG_FT_Outline));
+
+        PVG_FT_Byte* outline_data = (PVG_FT_Byte*)(outline + 1);
+        outline->points = (PVG_FT_Vector*)(outline_data);
+        outline->tags = (char*)(outline_data + points_size);
+        outline->contours = (int*)(outline_data + points_size + tags_size);
+        outline->contours_flag = (char*)(outline_data + points_size + tags_size + contours_size);
+        buffer->outline = outline;
+        buffer->max_points = points;
+        buffer->max_contours = contours;
+    }
+
+    PVG_FT_Outline* outline = buffer->outline;
     outline->n_points = 0;
     outline->n_contours = 0;
     outline->flags = 0x0;
     return outline;
 }
 
-static void ft_outline_destroy(PVG_FT_Outline* outline)
-{
-    free(outline);
-}
-
 #define FT_COORD(x) (PVG_FT_Pos)(roundf(x * 64))
 static void ft_outline_move_to(PVG_FT_Outline* ft, float x, float y)
 {
@@ -250,19 +256,13 @@ static void ft_outline_end(PVG_FT_Outline* ft)
     }
 }
 
-static PVG_FT_Outline* ft_outline_convert_stroke(const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_stroke_data_t* stroke_data);
-
-static PVG_FT_Outline* ft_outline_convert(const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_stroke_data_t* stroke_data)
+static PVG_FT_Outline* ft_outline_convert(plutovg_outline_buffer_t* buffer, const plutovg_path_t* path, const plutovg_matrix_t* matrix)
 {
-    if(stroke_data) {
-        return ft_outline_convert_stroke(path, matrix, stroke_data);
-    }
-
     plutovg_path_iterator_t it;
     plutovg_path_iterator_init(&it, path);
 
     plutovg_point_t points[3];
-    PVG_FT_Outline* outline = ft_outline_create(path->num_points, path->num_contours);
+    PVG_FT_Outline* outline = ft_outline_reserve(buffer, path->num_points, path->num_contours);
     while(plutovg_path_iterator_has_next(&it)) {
         switch(plutovg_path_iterator_next(&it, points)) {
         case PLUTOVG_PATH_COMMAND_MOVE_TO:
@@ -287,17 +287,17 @@ static PVG_FT_Outline* ft_outline_convert(const plutovg_path_t* path, const plut
     return outline;
 }
 
-static PVG_FT_Outline* ft_outline_convert_dash(const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_stroke_dash_t* stroke_dash)
+static PVG_FT_Outline* ft_outline_convert_dash(plutovg_outline_buffer_t* buffer, const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_stroke_dash_t* stroke_dash)
 {
     if(stroke_dash->array.size == 0)
-        return ft_outline_convert(path, matrix, NULL);
+        return ft_outline_convert(buffer, path, matrix);
     plutovg_path_t* dashed = plutovg_path_clone_dashed(path, stroke_dash->offset, stroke_dash->array.data, stroke_dash->array.size);
-    PVG_FT_Outline* outline = ft_outline_convert(dashed, matrix, NULL);
+    PVG_FT_Outline* outline = ft_outline_convert(buffer, dashed, matrix);
     plutovg_path_destroy(dashed);
     return outline;
 }
 
-static PVG_FT_Outline* ft_outline_convert_stroke(const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_stroke_data_t* stroke_data)
+static PVG_FT_Outline* ft_outline_convert_stroke(plutovg_rasterizer_t* rasterizer, const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_stroke_data_t* stroke_data)
 {
     double scale_x = sqrt(matrix->a * matrix->a + matrix->b * matrix->b);
     double scale_y = sqrt(matrix->c * matrix->c + matrix->d * matrix->d);
@@ -334,22 +334,20 @@ static PVG_FT_Outline* ft_outline_convert_stroke(const plutovg_path_t* path, con
         break;
     }
 
-    PVG_FT_Stroker stroker;
-    PVG_FT_Stroker_New(&stroker);
+    if(rasterizer->stroker == NULL)
+        PVG_FT_Stroker_New(&rasterizer->stroker);
+    PVG_FT_Stroker stroker = rasterizer->stroker;
     PVG_FT_Stroker_Set(stroker, ftWidth, ftCap, ftJoin, ftMiterLimit);
 
-    PVG_FT_Outline* outline = ft_outline_convert_dash(path, matrix, &stroke_data->dash);
+    PVG_FT_Outline* outline = ft_outline_convert_dash(&rasterizer->stroke_source, path, matrix, &stroke_data->dash);
     PVG_FT_Stroker_ParseOutline(stroker, outline);
 
     PVG_FT_UInt points;
     PVG_FT_UInt contours;
     PVG_FT_Stroker_GetCounts(stroker, &points, &contours);
 
-    PVG_FT_Outline* stroke_outline = ft_outline_create(points, contours);
+    PVG_FT_Outline* stroke_outline = ft_outline_reserve(&rasterizer->outline, points, contours);
     PVG_FT_Stroker_Export(stroker, stroke_outline);
-
-    PVG_FT_Stroker_Done(stroker);
-    ft_outline_destroy(outline);
     return stroke_outline;
 }
 
@@ -359,12 +357,45 @@ static void spans_generation_callback(int count, const PVG_FT_Span* spans, void*
     plutovg_array_append_data_span(span_buffer->spans, spans, count);
 }
 
-void plutovg_rasterize(plutovg_span_buffer_t* span_buffer, const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_rect_t* clip_rect, const plutovg_stroke_data_t* stroke_data, plutovg_fill_rule_t winding)
+void plutovg_rasterizer_init(plutovg_rasterizer_t* rasterizer)
+{
+    rasterizer->outline.outline = NULL;
+    rasterizer->outline.max_points = 0;
+    rasterizer->outline.max_contours = 0;
+    rasterizer->stroke_source = rasterizer->outline;
+    rasterizer->stroker = NULL;
+    plutovg_cell_pool_init(&rasterizer->cells);
+}
+
+void plutovg_rasterizer_destroy(plutovg_rasterizer_t* rasterizer)
+{
+    free(rasterizer->outline.outline);
+    free(rasterizer->stroke_source.outline);
+    if(rasterizer->stroker)
+        PVG_FT_Stroker_Done(rasterizer->stroker);
+    plutovg_cell_pool_destroy(&rasterizer->cells);
+}
+
+void plutovg_cell_pool_init(plutovg_cell_pool_t* cells)
+{
+    cells->data = NULL;
+    cells->size = 0;
+}
+
+void plutovg_cell_pool_destroy(plutovg_cell_pool_t* cells)
+{
+    free(cells->data);
+    plutovg_cell_pool_init(cells);
+}
+
+const struct PVG_FT_Outline_* plutovg_rasterizer_convert(plutovg_rasterizer_t* rasterizer, const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_stroke_data_t* stroke_data, plutovg_fill_rule_t winding)
 {
-    PVG_FT_Outline* outline = ft_outline_convert(path, matrix, stroke_data);
+    PVG_FT_Outline* outline;
     if(stroke_data) {
+        outline = ft_outline_convert_stroke(rasterizer, path, matrix, stroke_data);
         outline->flags = PVG_FT_OUTLINE_NONE;
     } else {
+        outline = ft_outline_convert(&rasterizer->outline, path, matrix);
         switch(winding) {
         case PLUTOVG_FILL_RULE_EVEN_ODD:
             outline->flags = PVG_FT_OUTLINE_EVEN_ODD_FILL;
@@ -375,11 +406,55 @@ void plutovg_rasterize(plutovg_span_buffer_t* span_buffer, const plutovg_path_t*
         }
     }
 
+    return outline;
+}
+
+void plutovg_outline_extents(const struct PVG_FT_Outline_* outline, const plutovg_rect_t* clip_rect, plutovg_rect_t* extents)
+{
+    extents->x = extents->y = extents->w = extents->h = 0.f;
+    if(outline->n_points <= 0)
+        return;
+    PVG_FT_Pos x1 = outline->points[0].x;
+    PVG_FT_Pos y1 = outline->points[0].y;
+    PVG_FT_Pos x2 = x1;
+    PVG_FT_Pos y2 = y1;
+    for(int i = 1; i < outline->n_points; i++) {
+        const PVG_FT_Vector* point = &outline->points[i];
+        if(point->x < x1) x1 = point->x;
+        if(point->x > x2) x2 = point->x;
+        if(point->y < y1) y1 = point->y;
+        if(point->y > y2) y2 = point->y;
+    }
+
+    // whole pixels, as the rasterizer rounds its bounding box
+    x1 >>= 6;
+    y1 >>= 6;
+    x2 = (x2 + 63) >> 6;
+    y2 = (y2 + 63) >> 6;
+    if(clip_rect) {
+        x1 = plutovg_max(x1, (PVG_FT_Pos)clip_rect->x);
+        y1 = plutovg_max(y1, (PVG_FT_Pos)clip_rect->y);
+        x2 = plutovg_min(x2, (PVG_FT_Pos)(clip_rect->x + clip_rect->w));
+        y2 = plutovg_min(y2, (PVG_FT_Pos)(clip_rect->y + clip_rect->h));
+    }
+
+    if(x2 > x1 && y2 > y1) {
+        extents->x = (float)x1;
+        extents->y = (float)y1;
+        extents->w = (float)(x2 - x1);
+        extents->h = (float)(y2 - y1);
+    }
+}
+
+static void ft_render_rows(const PVG_FT_Outline* outline, const plutovg_rect_t* clip_rect, int min_row, int max_row, plutovg_cell_pool_t* cells, PVG_FT_SpanFunc callback, void* user)
+{
     PVG_FT_Raster_Params params;
-    params.flags = PVG_FT_RASTER_FLAG_DIRECT | PVG_FT_RASTER_FLAG_AA;
-    params.gray_spans = spans_generation_callback;
-    params.user = span_buffer;
+    params.flags = PVG_FT_RASTER_FLAG_DIRECT | PVG_FT_RASTER_FLAG_AA | PVG_FT_RASTER_FLAG_ROWS;
+    params.gray_spans = callback;
+    params.user = user;
     params.source = outline;
+    params.min_row = min_row;
+    params.max_row = max_row;
     if(clip_rect) {
         params.flags |= PVG_FT_RASTER_FLAG_CLIP;
         params.clip_box.xMin = (PVG_FT_Pos)clip_rect->x;
@@ -388,7 +463,34 @@ void plutovg_rasterize(plutovg_span_buffer_t* span_buffer, const plutovg_path_t*
         params.clip_box.yMax = (PVG_FT_Pos)(clip_rect->y + clip_rect->h);
     }
 
+    PVG_FT_Raster_Render(&params, &cells->data, &cells->size);
+}
+
+void plutovg_outline_rasterize(plutovg_span_buffer_t* span_buffer, const struct PVG_FT_Outline_* outline, const plutovg_rect_t* clip_rect, int min_row, int max_row, plutovg_cell_pool_t* cells)
+{
     plutovg_span_buffer_reset(span_buffer);
-    PVG_FT_Raster_Render(&params);
-    ft_outline_destroy(outline);
+    ft_render_rows(outline, clip_rect, min_row, max_row, cells, spans_generation_callback, span_buffer);
+}
+
+static void spans_blend_callback(int count, const PVG_FT_Span* spans, void* user)
+{
+    // the spans the rasterizer hands out are laid out as plutovg_span_t, and blending them a batch at a time gives the same pixels
+    plutovg_span_buffer_t batch;
+    batch.spans.data = (plutovg_span_t*)(spans);
+    batch.spans.size = count;
+    batch.spans.capacity = count;
+    batch.x = batch.y = 0;
+    batch.w = batch.h = -1;
+    plutovg_blend((plutovg_canvas_t*)(user), &batch);
+}
+
+void plutovg_outline_blend(plutovg_canvas_t* canvas, const struct PVG_FT_Outline_* outline, const plutovg_rect_t* clip_rect, int min_row, int max_row, plutovg_cell_pool_t* cells)
+{
+    ft_render_rows(outline, clip_rect, min_row, max_row, cells, spans_blend_callback, canvas);
+}
+
+void plutovg_rasterize(plutovg_rasterizer_t* rasterizer, plutovg_span_buffer_t* span_buffer, const plutovg_path_t* path, const plutovg_matrix_t* matrix, const plutovg_rect_t* clip_rect, const plutovg_stroke_data_t* stroke_data, plutovg_fill_rule_t winding)
+{
+    const PVG_FT_Outline* outline = plutovg_rasterizer_convert(rasterizer, path, matrix, stroke_data, winding);
+    plutovg_outline_rasterize(span_buffer, outline, clip_rect, INT_MIN, INT_MAX, &rasterizer->cells);
 }
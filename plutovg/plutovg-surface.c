@@ -9,12 +9,14 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "plutovg-stb-image.h"
 
-static plutovg_surface_t* plutovg_surface_create_uninitialized(int width, int height)
+static plutovg_surface_t* plutovg_surface_create_uninitialized_with_capacity(int width, int height, int capacity)
 {
     static const int kMaxSize = 1 << 15;
     if(width <= 0 || height <= 0 || width >= kMaxSize || height >= kMaxSize)
         return NULL;
-    const size_t size = width * height * 4;
+    if(capacity < width * height)
+        capacity = width * height;
+    const size_t size = (size_t)capacity * 4;
     plutovg_surface_t* surface = (plutovg_surface_t*)malloc(size + sizeof(plutovg_surface_t));
     if(surface == NULL)
         return NULL;
@@ -22,10 +24,16 @@ static plutovg_surface_t* plutovg_surface_create_uninitialized(int width, int he
     surface->width = width;
     surface->height = height;
     surface->stride = width * 4;
+    surface->capacity = capacity;
     surface->data = (uint8_t*)(surface + 1);
     return surface;
 }
 
+static plutovg_surface_t* plutovg_surface_create_uninitialized(int width, int height)
+{
+    return plutovg_surface_create_uninitialized_with_capacity(width, height, 0);
+}
+
 plutovg_surface_t* plutovg_surface_create(int width, int height)
 {
     plutovg_surface_t* surface = (plutovg_surface_t*)plutovg_surface_create_uninitialized(width, height);
@@ -41,10 +49,37 @@ plutovg_surface_t* plutovg_surface_create_for_data(unsigned char* data, int widt
     surface->width = width;
     surface->height = height;
     surface->stride = stride;
+    surface->capacity = 0;
     surface->data = data;
     return surface;
 }
 
+plutovg_surface_t* plutovg_surface_create_with_capacity(int width, int height, int capacity)
+{
+    plutovg_surface_t* surface = plutovg_surface_create_uninitialized_with_capacity(width, height, capacity);
+    if(surface)
+        memset(surface->data, 0, surface->height * surface->stride);
+    return surface;
+}
+
+int plutovg_surface_get_capacity(const plutovg_surface_t* surface)
+{
+    return surface->capacity;
+}
+
+bool plutovg_surface_reshape(plutovg_surface_t* surface, int width, int height)
+{
+    if(width <= 0 || height <= 0 || width * height > surface->capacity)
+        return false;
+    if(plutovg_get_reference_count(surface) != 1)
+        return false;
+    surface->width = width;
+    surface->height = height;
+    surface->stride = width * 4;
+    memset(surface->data, 0, surface->height * surface->stride);
+    return true;
+}
+
 static plutovg_surface_t* plutovg_surface_load_from_image(stbi_uc* image, int width, int height)
 {
     plutovg_surface_t* surface = plutovg_surface_create_uninitialized(width, height);
@@ -237,12 +272,83 @@ bool plutovg_surface_write_to_jpg_stream(const plutovg_surface_t* surface, pluto
     return success;
 }
 
+#ifdef PLUTOVG_HAS_SSE2
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+// un-premultiplies in single precision: n * 255 / a is never close enough to an integer for the correctly rounded
+// quotient to truncate differently from the integer division, so the bytes match the scalar loop exactly
+// returns how many pixels were converted; the rest is left to the scalar loop
+static int convert_argb_to_rgba_row_sse2(unsigned char* dst, const uint32_t* src, int width)
+{
+    __m128i mask = _mm_set1_epi32(0xFF);
+    int x = 0;
+    for(; x + 4 <= width; x += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src + x));
+        __m128i a = _mm_srli_epi32(p, 24);
+        __m128 af = _mm_cvtepi32_ps(a);
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+        __m128i b = _mm_and_si128(p, mask);
+        r = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_slli_epi32(r, 8), r)), af));
+        g = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_slli_epi32(g, 8), g)), af));
+        b = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_slli_epi32(b, 8), b)), af));
+        __m128i out = _mm_or_si128(_mm_and_si128(r, mask), _mm_slli_epi32(_mm_and_si128(g, mask), 8));
+        out = _mm_or_si128(out, _mm_slli_epi32(_mm_and_si128(b, mask), 16));
+        out = _mm_or_si128(out, _mm_slli_epi32(a, 24));
+        out = _mm_andnot_si128(_mm_cmpeq_epi32(a, _mm_setzero_si128()), out);
+        _mm_storeu_si128((__m128i*)(dst + 4 * x), out);
+    }
+
+    return x;
+}
+
+static int convert_argb_to_rgba_row_avx2(unsigned char* dst, const uint32_t* src, int width) PLUTOVG_TARGET_AVX2;
+static int convert_argb_to_rgba_row_avx2(unsigned char* dst, const uint32_t* src, int width)
+{
+    __m256i mask = _mm256_set1_epi32(0xFF);
+    int x = 0;
+    for(; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(src + x));
+        __m256i a = _mm256_srli_epi32(p, 24);
+        __m256 af = _mm256_cvtepi32_ps(a);
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);
+        __m256i b = _mm256_and_si256(p, mask);
+        r = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_slli_epi32(r, 8), r)), af));
+        g = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_slli_epi32(g, 8), g)), af));
+        b = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_slli_epi32(b, 8), b)), af));
+        __m256i out = _mm256_or_si256(_mm256_and_si256(r, mask), _mm256_slli_epi32(_mm256_and_si256(g, mask), 8));
+        out = _mm256_or_si256(out, _mm256_slli_epi32(_mm256_and_si256(b, mask), 16));
+        out = _mm256_or_si256(out, _mm256_slli_epi32(a, 24));
+        out = _mm256_andnot_si256(_mm256_cmpeq_epi32(a, _mm256_setzero_si256()), out);
+        _mm256_storeu_si256((__m256i*)(dst + 4 * x), out);
+    }
+
+    return x;
+}
+
+#endif // PLUTOVG_HAS_SSE2
+
 void plutovg_convert_argb_to_rgba(unsigned char* dst, const unsigned char* src, int width, int height, int stride)
 {
+#ifdef PLUTOVG_HAS_SSE2
+    int features = plutovg_cpu_features();
+#endif
     for(int y = 0; y < height; y++) {
         const uint32_t* src_row = (const uint32_t*)(src + stride * y);
         unsigned char* dst_row = dst + stride * y;
-        for(int x = 0; x < width; x++) {
+        int x = 0;
+#ifdef PLUTOVG_HAS_SSE2
+        if(features & PLUTOVG_CPU_AVX2) {
+            x = convert_argb_to_rgba_row_avx2(dst_row, src_row, width);
+        } else if(features & PLUTOVG_CPU_SSE2) {
+            x = convert_argb_to_rgba_row_sse2(dst_row, src_row, width);
+        }
+        dst_row += 4 * x;
+#endif
+        for(; x < width; x++) {
             uint32_t pixel = src_row[x];
             uint32_t a = (pixel >> 24) & 0xFF;
             if(a == 0) {
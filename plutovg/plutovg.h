@@ -73,6 +73,41 @@ PLUTOVG_API int plutovg_version(void);
  */
 PLUTOVG_API const char* plutovg_version_string(void);
 
+/**
+ * @brief Enables or disables the vectorized pixel kernels.
+ *
+ * They are used by default when the processor supports them. The scalar kernels produce
+ * identical pixels, so disabling them is only useful for comparisons and benchmarks.
+ *
+ * @param enabled `true` to use the vectorized kernels where the processor supports them.
+ */
+PLUTOVG_API void plutovg_set_simd_enabled(bool enabled);
+
+/**
+ * @brief A function pointer type for running a set of tasks in parallel.
+ *
+ * It must call `task(data, index)` once for every index from `0` to `count - 1`, on any threads,
+ * and return only once all of them have finished.
+ *
+ * @param closure The pointer given to `plutovg_set_parallel_func`.
+ * @param count The number of tasks.
+ * @param task The function that runs one task.
+ * @param data A pointer that is passed on to `task`.
+ */
+typedef void (*plutovg_parallel_func_t)(void* closure, int count, void (*task)(void* data, int index), void* data);
+
+/**
+ * @brief Lets large fills, strokes and paints be split into bands of rows that are drawn in parallel.
+ *
+ * Each band is rasterized and blended on its own, and the pixels are identical to drawing the whole
+ * path on the calling thread. Small paths are always drawn on the calling thread.
+ *
+ * @param func The function that runs the bands, or `NULL` to draw everything on the calling thread.
+ * @param closure A pointer passed on to `func`.
+ * @param concurrency The number of threads that `func` runs tasks on, which decides how many bands a path is split into.
+ */
+PLUTOVG_API void plutovg_set_parallel_func(plutovg_parallel_func_t func, void* closure, int concurrency);
+
 /**
  * @brief A function pointer type for a cleanup callback.
  * @param closure A pointer to the resource to be cleaned up.
@@ -1159,6 +1194,40 @@ PLUTOVG_API plutovg_surface_t* plutovg_surface_create(int width, int height);
  */
 PLUTOVG_API plutovg_surface_t* plutovg_surface_create_for_data(unsigned char* data, int width, int height, int stride);
 
+/**
+ * @brief Creates a new image surface with room for more pixels than its dimensions need.
+ *
+ * The extra room lets `plutovg_surface_reshape` give the surface other dimensions later
+ * without allocating, which is what surface pools rely on.
+ *
+ * @param width The width of the surface in pixels.
+ * @param height The height of the surface in pixels.
+ * @param capacity The number of pixels to make room for; raised to `width * height` if smaller.
+ * @return A pointer to the newly created `plutovg_surface_t` object, or `NULL` on failure.
+ */
+PLUTOVG_API plutovg_surface_t* plutovg_surface_create_with_capacity(int width, int height, int capacity);
+
+/**
+ * @brief Gets the number of pixels that a surface has room for.
+ *
+ * @param surface Pointer to the `plutovg_surface_t` object.
+ * @return The capacity in pixels, or `0` when the surface uses pixel data that it does not own.
+ */
+PLUTOVG_API int plutovg_surface_get_capacity(const plutovg_surface_t* surface);
+
+/**
+ * @brief Gives a surface new dimensions and clears it to transparent black.
+ *
+ * Only a surface that owns its pixels, has room for the new dimensions and is not
+ * referenced from anywhere else can be reshaped.
+ *
+ * @param surface Pointer to the `plutovg_surface_t` object.
+ * @param width The new width in pixels.
+ * @param height The new height in pixels.
+ * @return `true` if the surface was reshaped, `false` otherwise.
+ */
+PLUTOVG_API bool plutovg_surface_reshape(plutovg_surface_t* surface, int width, int height);
+
 /**
  * @brief Loads an image surface from a file.
  *
@@ -1533,6 +1602,17 @@ PLUTOVG_API int plutovg_canvas_get_reference_count(const plutovg_canvas_t* canva
  */
 PLUTOVG_API plutovg_surface_t* plutovg_canvas_get_surface(const plutovg_canvas_t* canvas);
 
+/**
+ * @brief Returns a canvas to the state it was created in and binds it to another surface.
+ *
+ * The saved states, path and span storage of the canvas are kept for reuse, so that a
+ * pooled canvas can draw on a new surface without allocating.
+ *
+ * @param canvas A pointer to a `plutovg_canvas_t` object.
+ * @param surface The surface to draw on, or `NULL` to release the current one while the canvas is unused.
+ */
+PLUTOVG_API void plutovg_canvas_reset(plutovg_canvas_t* canvas, plutovg_surface_t* surface);
+
 /**
  * @brief Saves the current state of the canvas.
  *
@@ -2423,6 +2503,50 @@ PLUTOVG_API void plutovg_canvas_stroke_rect(plutovg_canvas_t* canvas, float x, f
  */
 PLUTOVG_API void plutovg_canvas_stroke_path(plutovg_canvas_t* canvas, const plutovg_path_t* path);
 
+/**
+ * @brief The pixels that a path covers, and how much of each, as rasterized for a canvas.
+ *
+ * Keeping the coverage of a stroke lets it be drawn again, in any paint, without stroking and
+ * rasterizing the path again.
+ */
+typedef struct plutovg_coverage plutovg_coverage_t;
+
+/**
+ * @brief Rasterizes the stroke of a path with the current matrix and stroke settings, without drawing it.
+ *
+ * The coverage is limited to the surface of the canvas, but not to its clipping region, which is applied
+ * when the coverage is drawn. The current path is not affected.
+ *
+ * @param canvas A pointer to a `plutovg_canvas_t` object.
+ * @param path The `plutovg_path_t` object.
+ * @return A new `plutovg_coverage_t`, which is freed with `plutovg_coverage_destroy`.
+ */
+PLUTOVG_API plutovg_coverage_t* plutovg_canvas_stroke_coverage(plutovg_canvas_t* canvas, const plutovg_path_t* path);
+
+/**
+ * @brief Draws coverage with the current paint, operator and clipping region.
+ *
+ * Drawing the coverage of a stroke gives the same pixels as stroking its path with the matrix and settings it
+ * was made with, on a canvas of the same size.
+ *
+ * @param canvas A pointer to a `plutovg_canvas_t` object.
+ * @param coverage The coverage to draw.
+ */
+PLUTOVG_API void plutovg_canvas_fill_coverage(plutovg_canvas_t* canvas, const plutovg_coverage_t* coverage);
+
+/**
+ * @brief Gets the memory that coverage takes, in bytes.
+ * @param coverage A pointer to a `plutovg_coverage_t` object.
+ * @return The size in bytes.
+ */
+PLUTOVG_API int plutovg_coverage_get_size(const plutovg_coverage_t* coverage);
+
+/**
+ * @brief Frees coverage made by `plutovg_canvas_stroke_coverage`.
+ * @param coverage A pointer to a `plutovg_coverage_t` object.
+ */
+PLUTOVG_API void plutovg_coverage_destroy(plutovg_coverage_t* coverage);
+
 /**
  * @brief Intersects the current clipping region with a rectangle according to the current fill rule.
  *
@@ -0,0 +1,364 @@
+#include <vector>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include "filesystem.hpp"
+#include "stools.hpp"
+#include "asvg.hpp"
+#include "templateproject.hpp"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+// Headless tool: loads a .tui, rasterizes every background and icon combination that is requested, and writes a single
+// packed atlas (<output>.png) together with an index of where each render ended up (<output>.idx). Needs no GL context.
+
+enum class request_type : uint8_t {
+	background, icon
+};
+
+struct render_request {
+	request_type type = request_type::background;
+	int32_t index = 0;
+	float size_x = 0.0f; // in grid units for backgrounds, pixels for icons
+	float size_y = 0.0f;
+	int32_t grid_size = 0;
+	float r = 0.0f;
+	float g = 0.0f;
+	float b = 0.0f;
+
+	bool operator==(render_request const& o) const noexcept {
+		return type == o.type && index == o.index && size_x == o.size_x && size_y == o.size_y && grid_size == o.grid_size && r == o.r && g == o.g && b == o.b;
+	}
+};
+
+struct baked_render {
+	render_request request;
+	lunasvg::Bitmap pixels;
+	int32_t x = 0;
+	int32_t y = 0;
+};
+
+constexpr int32_t atlas_padding = 1;
+constexpr int32_t max_atlas_size = 16384;
+
+static void print_usage() {
+	std::fprintf(stderr,
+		"usage: prerender <project.tui> <output name> [options]\n"
+		"  --scale S        ui scale to render at (default 1)\n"
+		"  --grid N         grid size to render backgrounds at (repeatable, default 8)\n"
+		"  --size WxH       background size in grid units (repeatable)\n"
+		"  --icon-size WxH  icon size in pixels (repeatable)\n"
+		"  --requests FILE  explicit list of renders, one per line:\n"
+		"                     background <file name> <width> <height> <grid size> [r g b]\n"
+		"                     icon <file name> <width> <height> [r g b]\n"
+		"When no request file is given, every background is rendered at every --size and --grid, and every icon at every\n"
+		"--icon-size in each color that a template uses for icons.\n");
+}
+
+static bool parse_float(std::string_view text, float& out) {
+	auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+	return result.ec == std::errc{ } && result.ptr == text.data() + text.size();
+}
+
+static bool parse_size(std::string_view text, float& x, float& y) {
+	auto sep = text.find('x');
+	if(sep == std::string_view::npos)
+		return false;
+	return parse_float(text.substr(0, sep), x) && parse_float(text.substr(sep + 1), y);
+}
+
+static void add_request(std::vector<render_request>& requests, render_request const& r) {
+	for(auto& existing : requests) {
+		if(existing == r)
+			return;
+	}
+	requests.push_back(r);
+}
+
+static bool read_request_file(std::string const& file_name, template_project::project_view const& p, std::vector<render_request>& requests) {
+	fs::file request_file{ fs::utf8_to_native(file_name) };
+	if(!request_file.content().data) {
+		std::fprintf(stderr, "could not open request file %s\n", file_name.c_str());
+		return false;
+	}
+	std::string_view content(request_file.content().data, request_file.content().file_size);
+	int32_t line_number = 0;
+	while(!content.empty()) {
+		auto line_end = content.find('\n');
+		auto line = content.substr(0, line_end);
+		content.remove_prefix(line_end == std::string_view::npos ? content.size() : line_end + 1);
+		++line_number;
+
+		std::vector<std::string_view> words;
+		while(!line.empty()) {
+			auto start = line.find_first_not_of(" \t\r");
+			if(start == std::string_view::npos)
+				break;
+			line.remove_prefix(start);
+			auto end = line.find_first_of(" \t\r");
+			words.push_back(line.substr(0, end));
+			line.remove_prefix(end == std::string_view::npos ? line.size() : end);
+		}
+		if(words.empty() || words[0].front() == '#')
+			continue;
+
+		render_request r;
+		bool valid = false;
+		if(words[0] == "background" && (words.size() == 5 || words.size() == 8)) {
+			r.type = request_type::background;
+			r.index = p.find(template_project::template_type::background, words[1]);
+			float grid = 0.0f;
+			valid = r.index != -1 && parse_float(words[2], r.size_x) && parse_float(words[3], r.size_y) && parse_float(words[4], grid);
+			r.grid_size = int32_t(grid);
+			if(valid && words.size() == 8)
+				valid = parse_float(words[5], r.r) && parse_float(words[6], r.g) && parse_float(words[7], r.b);
+		} else if(words[0] == "icon" && (words.size() == 4 || words.size() == 7)) {
+			r.type = request_type::icon;
+			r.index = p.find(template_project::template_type::icon, words[1]);
+			valid = r.index != -1 && parse_float(words[2], r.size_x) && parse_float(words[3], r.size_y);
+			if(valid && words.size() == 7)
+				valid = parse_float(words[4], r.r) && parse_float(words[5], r.g) && parse_float(words[6], r.b);
+		}
+		if(!valid) {
+			std::fprintf(stderr, "%s:%d: invalid request\n", file_name.c_str(), line_number);
+			return false;
+		}
+		add_request(requests, r);
+	}
+	return true;
+}
+
+static void collect_icon_colors(template_project::project_view const& p, std::vector<color3f>& colors) {
+	auto add_color = [&](int32_t c) {
+		color3f v{ };
+		if(0 <= c && c < int32_t(p.count(template_project::template_type::color))) {
+			auto color = p.color(uint32_t(c));
+			v = color3f{ color.r, color.g, color.b };
+		}
+		for(auto& existing : colors) {
+			if(existing == v)
+				return;
+		}
+		colors.push_back(v);
+	};
+	for(uint32_t i = 0; i < p.count(template_project::template_type::iconic_button); ++i) {
+		auto t = p.iconic_button(i);
+		add_color(t.primary.icon_color);
+		add_color(t.active.icon_color);
+		add_color(t.disabled.icon_color);
+	}
+	for(uint32_t i = 0; i < p.count(template_project::template_type::mixed_button); ++i) {
+		auto t = p.mixed_button(i);
+		add_color(t.primary.shared_color);
+		add_color(t.active.shared_color);
+		add_color(t.disabled.shared_color);
+	}
+	if(colors.empty())
+		add_color(-1);
+}
+
+// tries square-ish atlases of increasing size until every render fits
+static bool pack_renders(std::vector<baked_render>& renders, int32_t& atlas_w, int32_t& atlas_h) {
+	std::vector<stbrp_rect> rects(renders.size());
+	for(size_t i = 0; i < renders.size(); ++i) {
+		rects[i].id = int(i);
+		rects[i].w = renders[i].pixels.width() + atlas_padding;
+		rects[i].h = renders[i].pixels.height() + atlas_padding;
+	}
+	atlas_w = 256;
+	atlas_h = 256;
+	while(atlas_w <= max_atlas_size) {
+		std::vector<stbrp_node> nodes(static_cast<size_t>(atlas_w));
+		stbrp_context context;
+		stbrp_init_target(&context, atlas_w, atlas_h, nodes.data(), int(nodes.size()));
+		if(stbrp_pack_rects(&context, rects.data(), int(rects.size())) != 0) {
+			for(auto& r : rects) {
+				renders[r.id].x = r.x;
+				renders[r.id].y = r.y;
+			}
+			return true;
+		}
+		if(atlas_h < atlas_w)
+			atlas_h *= 2;
+		else
+			atlas_w *= 2;
+	}
+	return false;
+}
+
+int main(int argc, char** argv) {
+	if(argc < 3) {
+		print_usage();
+		return 1;
+	}
+	std::string project_file = argv[1];
+	std::string output_name = argv[2];
+	float scale = 1.0f;
+	std::vector<int32_t> grid_sizes;
+	std::vector<std::pair<float, float>> bg_sizes;
+	std::vector<std::pair<float, float>> icon_sizes;
+	std::string request_file;
+
+	for(int i = 3; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		bool has_value = i + 1 < argc;
+		float x = 0.0f;
+		float y = 0.0f;
+		if(arg == "--scale" && has_value && parse_float(argv[i + 1], scale)) {
+			++i;
+		} else if(arg == "--grid" && has_value && parse_float(argv[i + 1], x)) {
+			grid_sizes.push_back(int32_t(x));
+			++i;
+		} else if(arg == "--size" && has_value && parse_size(argv[i + 1], x, y)) {
+			bg_sizes.emplace_back(x, y);
+			++i;
+		} else if(arg == "--icon-size" && has_value && parse_size(argv[i + 1], x, y)) {
+			icon_sizes.emplace_back(x, y);
+			++i;
+		} else if(arg == "--requests" && has_value) {
+			request_file = argv[i + 1];
+			++i;
+		} else {
+			print_usage();
+			return 1;
+		}
+	}
+	if(grid_sizes.empty())
+		grid_sizes.push_back(8);
+
+	auto native_project_file = fs::utf8_to_native(project_file);
+	template_project::project_view open_project{ native_project_file };
+	if(!open_project.is_open()) {
+		std::fprintf(stderr, "could not open %s\n", project_file.c_str());
+		return 1;
+	}
+
+	auto breakpt = native_project_file.find_last_of(L"\\/");
+	auto svg_root = (breakpt == std::wstring::npos ? std::wstring{ } : native_project_file.substr(0, breakpt + 1)) + open_project.svg_directory();
+	asvg::common_file_bank::bank.set_root_directory(svg_root);
+
+	std::vector<render_request> requests;
+	if(!request_file.empty()) {
+		if(!read_request_file(request_file, open_project, requests))
+			return 1;
+	} else {
+		for(int32_t i = 0; i < int32_t(open_project.count(template_project::template_type::background)); ++i) {
+			for(auto sz : bg_sizes) {
+				for(auto g : grid_sizes) {
+					add_request(requests, render_request{ request_type::background, i, sz.first, sz.second, g });
+				}
+			}
+		}
+		std::vector<color3f> icon_colors;
+		collect_icon_colors(open_project, icon_colors);
+		for(int32_t i = 0; i < int32_t(open_project.count(template_project::template_type::icon)); ++i) {
+			for(auto sz : icon_sizes) {
+				for(auto c : icon_colors) {
+					add_request(requests, render_request{ request_type::icon, i, sz.first, sz.second, 0, c.r, c.g, c.b });
+				}
+			}
+		}
+	}
+	if(requests.empty()) {
+		std::fprintf(stderr, "nothing to render; pass --size / --icon-size or --requests\n");
+		return 1;
+	}
+
+	// only the icons and backgrounds that are asked for are decoded and parsed
+	std::vector<std::optional<template_project::icon_definition>> icons(open_project.count(template_project::template_type::icon));
+	std::vector<std::optional<template_project::background_definition>> backgrounds(open_project.count(template_project::template_type::background));
+	for(auto& r : requests) {
+		if(r.type == request_type::background && !backgrounds[r.index]) {
+			auto& b = backgrounds[r.index].emplace(open_project.background(uint32_t(r.index)));
+			fs::file svg_file{ svg_root + fs::utf8_to_native(b.file_name) };
+			b.renders = asvg::svg(svg_file.content().data, size_t(svg_file.content().file_size), b.base_x, b.base_y);
+		} else if(r.type == request_type::icon && !icons[r.index]) {
+			auto& i = icons[r.index].emplace(open_project.icon(uint32_t(r.index)));
+			fs::file svg_file{ svg_root + fs::utf8_to_native(i.file_name) };
+			i.renders = asvg::simple_svg(svg_file.content().data, size_t(svg_file.content().file_size));
+		}
+	}
+
+	std::vector<baked_render> renders;
+	renders.reserve(requests.size());
+	for(auto& r : requests) {
+		baked_render br;
+		br.request = r;
+		if(r.type == request_type::background) {
+			br.pixels = backgrounds[r.index]->renders.rasterize(r.size_x, r.size_y, r.grid_size, scale, r.r, r.g, r.b);
+		} else {
+			br.pixels = icons[r.index]->renders.rasterize(int32_t(r.size_x), int32_t(r.size_y), scale, r.r, r.g, r.b);
+		}
+		if(br.pixels.isNull() || br.pixels.width() == 0 || br.pixels.height() == 0) {
+			std::fprintf(stderr, "skipping empty render of %s\n", r.type == request_type::background ? backgrounds[r.index]->file_name.c_str() : icons[r.index]->file_name.c_str());
+			continue;
+		}
+		renders.push_back(std::move(br));
+	}
+
+	int32_t atlas_w = 0;
+	int32_t atlas_h = 0;
+	if(!pack_renders(renders, atlas_w, atlas_h)) {
+		std::fprintf(stderr, "renders do not fit in a %dx%d atlas\n", max_atlas_size, max_atlas_size);
+		return 1;
+	}
+
+	lunasvg::Bitmap atlas(atlas_w, atlas_h);
+	atlas.clear(0);
+	for(auto& br : renders) {
+		auto row_bytes = size_t(br.pixels.width()) * 4;
+		for(int32_t row = 0; row < br.pixels.height(); ++row) {
+			std::memcpy(atlas.data() + size_t(br.y + row) * size_t(atlas.stride()) + size_t(br.x) * 4,
+				br.pixels.data() + size_t(row) * size_t(br.pixels.stride()), row_bytes);
+		}
+	}
+	auto png_name = output_name + ".png";
+	if(!atlas.writeToPng(png_name)) {
+		std::fprintf(stderr, "could not write %s\n", png_name.c_str());
+		return 1;
+	}
+
+	// index layout: header section (atlas file name, width, height, scale), then a section of renders, each its own
+	// section containing type, file name, size x, size y, grid size, r, g, b, and the x, y, width, height in the atlas
+	serialization::out_buffer index;
+	index.start_section();
+	auto slash = png_name.find_last_of("\\/");
+	index.write(slash == std::string::npos ? png_name : png_name.substr(slash + 1));
+	index.write(atlas_w);
+	index.write(atlas_h);
+	index.write(scale);
+	index.finish_section();
+
+	index.start_section();
+	for(auto& br : renders) {
+		index.start_section();
+		index.write(br.request.type);
+		if(br.request.type == request_type::background)
+			index.write(backgrounds[br.request.index]->file_name);
+		else
+			index.write(icons[br.request.index]->file_name);
+		index.write(br.request.size_x);
+		index.write(br.request.size_y);
+		index.write(br.request.grid_size);
+		index.write(br.request.r);
+		index.write(br.request.g);
+		index.write(br.request.b);
+		index.write(br.x);
+		index.write(br.y);
+		index.write(int32_t(br.pixels.width()));
+		index.write(int32_t(br.pixels.height()));
+		index.finish_section();
+	}
+	index.finish_section();
+
+	fs::write_file(fs::utf8_to_native(output_name + ".idx"), index.data(), uint32_t(index.size()));
+
+	std::printf("baked %d renders into a %dx%d atlas\n", int32_t(renders.size()), atlas_w, atlas_h);
+	return 0;
+}
@@ -0,0 +1,149 @@
+#include "profiler.hpp"
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include "filesystem.hpp"
+
+namespace profiler {
+
+recorder common_recorder::instance{ };
+
+char const* counter_name(counter c) {
+	switch(c) {
+		case counter::cache_hits: return "cache hits";
+		case counter::cache_misses: return "cache misses";
+		case counter::renders_alive: return "renders alive";
+		case counter::textures_alive: return "textures alive";
+		case counter::bytes_uploaded: return "bytes uploaded";
+		case counter::raster_us: return "raster us";
+		default: return "";
+	}
+}
+
+bool is_gauge(counter c) {
+	return c == counter::renders_alive || c == counter::textures_alive;
+}
+
+uint32_t current_thread_id() {
+	static std::atomic<uint32_t> last_id{ 0 };
+	thread_local uint32_t id = ++last_id;
+	return id;
+}
+
+recorder::recorder() {
+	origin = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	for(auto& c : current_counters)
+		c.store(0, std::memory_order_relaxed);
+}
+
+uint64_t recorder::now_ns() const {
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()) - origin;
+}
+
+void recorder::record_zone(char const* name, uint64_t start_ns, uint64_t end_ns) {
+	auto thread = current_thread_id();
+	std::lock_guard lock(guard);
+	current_zones.push_back(zone_event{ name, start_ns, end_ns - start_ns, thread });
+}
+
+void recorder::add(counter c, int64_t value) {
+	current_counters[size_t(c)].fetch_add(value, std::memory_order_relaxed);
+}
+
+void recorder::set(counter c, int64_t value) {
+	current_counters[size_t(c)].store(value, std::memory_order_relaxed);
+}
+
+void recorder::begin_frame() {
+	current_frame_start = now_ns();
+}
+
+void recorder::end_frame() {
+	frame_record f;
+	f.start_ns = current_frame_start;
+	f.duration_ns = now_ns() - current_frame_start;
+	f.thread = current_thread_id();
+	for(int32_t i = 0; i < counter_count; ++i) {
+		if(is_gauge(counter(i)))
+			f.counters[i] = current_counters[i].load(std::memory_order_relaxed);
+		else
+			f.counters[i] = current_counters[i].exchange(0, std::memory_order_relaxed);
+	}
+
+	std::lock_guard lock(guard);
+	frames[next_frame] = f;
+	next_frame = (next_frame + 1) % frame_history;
+	frames_recorded = std::min(frames_recorded + 1, frame_history);
+	if(capturing) {
+		captured_frames.push_back(f);
+		auto room = max_capture_zones - std::min(max_capture_zones, captured_zones.size());
+		captured_zones.insert(captured_zones.end(), current_zones.begin(), current_zones.begin() + std::min(room, current_zones.size()));
+	}
+	last_frame_zones.swap(current_zones);
+	current_zones.clear();
+}
+
+frame_record const& recorder::frame(uint32_t i) const {
+	return frames[(next_frame + frame_history - 1 - i) % frame_history];
+}
+
+void recorder::start_capture() {
+	std::lock_guard lock(guard);
+	captured_zones.clear();
+	captured_frames.clear();
+	capturing = true;
+}
+
+namespace {
+
+void append_escaped(std::string& out, char const* text) {
+	for(; *text; ++text) {
+		if(*text == '\"' || *text == '\\')
+			out += '\\';
+		out += *text;
+	}
+}
+
+void append_event(std::string& out, char const* name, uint64_t start_ns, uint64_t duration_ns, uint32_t thread) {
+	char buffer[128];
+	out += "{\"name\":\"";
+	append_escaped(out, name);
+	std::snprintf(buffer, sizeof(buffer), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u},\n",
+		double(start_ns) / 1000.0, double(duration_ns) / 1000.0, thread);
+	out += buffer;
+}
+
+}
+
+void recorder::write_capture(std::wstring const& file_name) {
+	std::vector<zone_event> zones;
+	std::vector<frame_record> frames_out;
+	{
+		std::lock_guard lock(guard);
+		capturing = false;
+		zones.swap(captured_zones);
+		frames_out.swap(captured_frames);
+	}
+
+	// complete ("X") events for frames and zones, and one counter ("C") event per frame
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	char buffer[128];
+	for(auto& f : frames_out) {
+		append_event(out, "frame", f.start_ns, f.duration_ns, f.thread);
+		for(int32_t i = 0; i < counter_count; ++i) {
+			std::snprintf(buffer, sizeof(buffer), "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"value\":%lld}},\n",
+				counter_name(counter(i)), double(f.start_ns + f.duration_ns) / 1000.0, (long long)(f.counters[i]));
+			out += buffer;
+		}
+	}
+	for(auto& z : zones) {
+		append_event(out, z.name, z.start_ns, z.duration_ns, z.thread);
+	}
+	if(out.back() == '\n' && out[out.size() - 2] == ',')
+		out.erase(out.size() - 2, 1);
+	out += "]}\n";
+
+	fs::write_file(file_name, out.data(), uint32_t(out.size()));
+}
+
+}
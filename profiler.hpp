@@ -0,0 +1,121 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+
+namespace profiler {
+
+enum class counter : uint8_t {
+	cache_hits, cache_misses, renders_alive, textures_alive, bytes_uploaded, raster_us,
+	count
+};
+constexpr int32_t counter_count = int32_t(counter::count);
+
+char const* counter_name(counter c);
+// gauges hold a level (set once per frame) rather than a total that starts over every frame
+bool is_gauge(counter c);
+
+struct zone_event {
+	char const* name = nullptr; // always a string literal
+	uint64_t start_ns = 0; // since the recorder was created
+	uint64_t duration_ns = 0;
+	uint32_t thread = 0;
+};
+
+struct frame_record {
+	uint64_t start_ns = 0;
+	uint64_t duration_ns = 0;
+	uint32_t thread = 0;
+	std::array<int64_t, counter_count> counters = { };
+};
+
+// collects timed zones (from any thread) and counters, grouped by the frame of the ui thread they finished in
+// nothing is recorded unless enabled is set, so that a zone costs a single load when the profiler is not in use
+class recorder {
+public:
+	static constexpr uint32_t frame_history = 240;
+	static constexpr size_t max_capture_zones = size_t(1) << 20;
+
+	std::atomic<bool> enabled{ false };
+	std::mutex guard;
+
+	std::array<frame_record, frame_history> frames; // ring buffer of finished frames
+	uint32_t next_frame = 0;
+	uint32_t frames_recorded = 0;
+	std::vector<zone_event> current_zones; // finished since the current frame began
+	std::vector<zone_event> last_frame_zones;
+	uint64_t current_frame_start = 0;
+
+	// a capture keeps every frame and zone until it is written out as a trace
+	bool capturing = false;
+	std::vector<zone_event> captured_zones;
+	std::vector<frame_record> captured_frames;
+
+	recorder();
+
+	uint64_t now_ns() const;
+	void record_zone(char const* name, uint64_t start_ns, uint64_t end_ns);
+	void add(counter c, int64_t value);
+	void set(counter c, int64_t value);
+
+	// called by the ui thread around each frame that it draws
+	void begin_frame();
+	void end_frame();
+	// the finished frame i frames back (0 is the most recent); only valid for i < frames_recorded
+	frame_record const& frame(uint32_t i) const;
+
+	void start_capture();
+	// stops the capture and writes it in the chrome trace event format (as read by chrome://tracing and Perfetto)
+	void write_capture(std::wstring const& file_name);
+private:
+	uint64_t origin = 0;
+	std::array<std::atomic<int64_t>, counter_count> current_counters;
+};
+
+class common_recorder {
+public:
+	static recorder instance;
+};
+
+uint32_t current_thread_id();
+
+inline void count(counter c, int64_t value = 1) {
+	if(common_recorder::instance.enabled.load(std::memory_order_relaxed))
+		common_recorder::instance.add(c, value);
+}
+inline void set_level(counter c, int64_t value) {
+	if(common_recorder::instance.enabled.load(std::memory_order_relaxed))
+		common_recorder::instance.set(c, value);
+}
+
+// times the enclosing scope; when given a counter, the elapsed microseconds are added to it as well
+class scoped_zone {
+	char const* name = nullptr;
+	uint64_t start = 0;
+	counter time_counter = counter::count;
+public:
+	explicit scoped_zone(char const* name) {
+		if(common_recorder::instance.enabled.load(std::memory_order_relaxed)) {
+			this->name = name;
+			start = common_recorder::instance.now_ns();
+		}
+	}
+	scoped_zone(char const* name, counter time_counter) : scoped_zone(name) {
+		this->time_counter = time_counter;
+	}
+	scoped_zone(scoped_zone const&) = delete;
+	scoped_zone& operator=(scoped_zone const&) = delete;
+	~scoped_zone() {
+		if(!name)
+			return;
+		auto end = common_recorder::instance.now_ns();
+		common_recorder::instance.record_zone(name, start, end);
+		if(time_counter != counter::count)
+			common_recorder::instance.add(time_counter, int64_t((end - start) / 1000));
+	}
+};
+
+}
@@ -4,15 +4,42 @@
 
 namespace template_project {
 
+// the order in which the entry lists follow the header; files without a table of contents depend on it
+static constexpr template_type section_order[] = {
+	template_type::color, template_type::icon, template_type::background, template_type::label, template_type::button,
+	template_type::progress_bar, template_type::window, template_type::iconic_button, template_type::layout_region,
+	template_type::mixed_button, template_type::toggle_button
+};
+static constexpr uint32_t section_count = uint32_t(std::size(section_order)) + 1;
+static constexpr size_t type_count = size_t(template_type::toggle_button) + 1;
+
+static void write_table_row(serialization::out_buffer& buffer, size_t table_position, uint32_t row, template_type type, size_t section_start, uint32_t count) {
+	auto row_position = table_position + size_t(row) * 4 * sizeof(uint32_t);
+	buffer.write_at(row_position, uint32_t(type));
+	buffer.write_at(row_position + sizeof(uint32_t), uint32_t(section_start));
+	buffer.write_at(row_position + 2 * sizeof(uint32_t), uint32_t(buffer.get_data_position() - section_start));
+	buffer.write_at(row_position + 3 * sizeof(uint32_t), count);
+}
+
 void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
+	buffer.write(tui_magic);
+	buffer.write(tui_format_version);
+	buffer.write(uint32_t(section_count));
+	auto table_position = buffer.get_data_position();
+	for(uint32_t i = 0; i < section_count * 4; ++i)
+		buffer.write(uint32_t(0));
+
 	// header info
+	auto header_start = buffer.get_data_position();
 	buffer.start_section();
 	buffer.write(p.svg_directory);
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 0, template_type::none, header_start, 1);
 
 	auto& t = p;
 
 	//colors
+	auto color_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& c : t.colors) {
 		buffer.start_section();
@@ -24,8 +51,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 1, template_type::color, color_start, uint32_t(t.colors.size()));
 
 	//icons
+	auto icon_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.icons) {
 		buffer.start_section();
@@ -33,8 +62,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 2, template_type::icon, icon_start, uint32_t(t.icons.size()));
 
 	//backgrounds
+	auto background_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.backgrounds) {
 		buffer.start_section();
@@ -44,8 +75,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 3, template_type::background, background_start, uint32_t(t.backgrounds.size()));
 
 	//labels
+	auto label_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.label_t) {
 		buffer.start_section();
@@ -61,8 +94,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 4, template_type::label, label_start, uint32_t(t.label_t.size()));
 
 	//buttons
+	auto button_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.button_t) {
 		buffer.start_section();
@@ -95,8 +130,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 5, template_type::button, button_start, uint32_t(t.button_t.size()));
 
 	//progress bars
+	auto progress_bar_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.progress_bar_t) {
 		buffer.start_section();
@@ -113,8 +150,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 6, template_type::progress_bar, progress_bar_start, uint32_t(t.progress_bar_t.size()));
 
 	//windows
+	auto window_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.window_t) {
 		buffer.start_section();
@@ -128,8 +167,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 7, template_type::window, window_start, uint32_t(t.window_t.size()));
 
 	//iconic buttons
+	auto iconic_button_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.iconic_button_t) {
 		buffer.start_section();
@@ -156,8 +197,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 8, template_type::iconic_button, iconic_button_start, uint32_t(t.iconic_button_t.size()));
 
 	//layout regions
+	auto layout_region_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.layout_region_t) {
 		buffer.start_section();
@@ -178,8 +221,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 9, template_type::layout_region, layout_region_start, uint32_t(t.layout_region_t.size()));
 
 	//mixed buttons
+	auto mixed_button_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.mixed_button_t) {
 		buffer.start_section();
@@ -227,8 +272,10 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 10, template_type::mixed_button, mixed_button_start, uint32_t(t.mixed_button_t.size()));
 	
 	// toggle buttons
+	auto toggle_button_start = buffer.get_data_position();
 	buffer.start_section();
 	for(auto& i : t.toggle_button_t) {
 		buffer.start_section();
@@ -268,255 +315,380 @@ void project_to_bytes(project const& p, serialization::out_buffer& buffer) {
 		buffer.finish_section();
 	}
 	buffer.finish_section();
+	write_table_row(buffer, table_position, 11, template_type::toggle_button, toggle_button_start, uint32_t(t.toggle_button_t.size()));
+}
+
+static void read_entry(serialization::in_buffer& section, color_definition& out) {
+	section.read(out.display_name);
+	section.read(out.r);
+	section.read(out.g);
+	section.read(out.b);
+	section.read(out.a);
+}
+
+static void read_entry(serialization::in_buffer& section, icon_definition& out) {
+	section.read(out.file_name);
+}
+
+static void read_entry(serialization::in_buffer& section, background_definition& out) {
+	section.read(out.file_name);
+	section.read(out.base_x);
+	section.read(out.base_y);
+}
+
+static void read_entry(serialization::in_buffer& section, label_template& out) {
+	section.read(out.display_name);
+	section.read(out.primary.bg);
+	section.read(out.primary.text_color);
+	section.read(out.primary.font_choice);
+	section.read(out.primary.font_scale);
+	section.read(out.primary.h_text_margins);
+	section.read(out.primary.v_text_margins);
+	section.read(out.primary.h_text_alignment);
+	section.read(out.primary.v_text_alignment);
+}
+
+static void read_entry(serialization::in_buffer& section, button_template& out) {
+	section.read(out.display_name);
+	section.read(out.animate_active_transition);
+	section.read(out.primary.bg);
+	section.read(out.primary.text_color);
+	section.read(out.primary.font_choice);
+	section.read(out.primary.font_scale);
+	section.read(out.primary.h_text_margins);
+	section.read(out.primary.v_text_margins);
+	section.read(out.primary.h_text_alignment);
+	section.read(out.primary.v_text_alignment);
+	section.read(out.active.bg);
+	section.read(out.active.text_color);
+	section.read(out.active.font_choice);
+	section.read(out.active.font_scale);
+	section.read(out.active.h_text_margins);
+	section.read(out.active.v_text_margins);
+	section.read(out.active.h_text_alignment);
+	section.read(out.active.v_text_alignment);
+	section.read(out.disabled.bg);
+	section.read(out.disabled.text_color);
+	section.read(out.disabled.font_choice);
+	section.read(out.disabled.font_scale);
+	section.read(out.disabled.h_text_margins);
+	section.read(out.disabled.v_text_margins);
+	section.read(out.disabled.h_text_alignment);
+	section.read(out.disabled.v_text_alignment);
+}
+
+static void read_entry(serialization::in_buffer& section, progress_bar_template& out) {
+	section.read(out.display_name);
+	section.read(out.bg_a);
+	section.read(out.bg_b);
+	section.read(out.text_color);
+	section.read(out.font_choice);
+	section.read(out.h_text_margins);
+	section.read(out.v_text_margins);
+	section.read(out.h_text_alignment);
+	section.read(out.v_text_alignment);
+	section.read(out.display_percentage_text);
+}
+
+static void read_entry(serialization::in_buffer& section, window_template& out) {
+	section.read(out.display_name);
+	section.read(out.bg);
+	section.read(out.layout_region_definition);
+	section.read(out.close_button_definition);
+	section.read(out.close_button_icon);
+	section.read(out.h_close_button_margin);
+	section.read(out.v_close_button_margin);
+}
+
+static void read_entry(serialization::in_buffer& section, iconic_button_template& out) {
+	section.read(out.display_name);
+	section.read(out.animate_active_transition);
+	section.read(out.primary.bg);
+	section.read(out.primary.icon_color);
+	section.read(out.primary.icon_top);
+	section.read(out.primary.icon_left);
+	section.read(out.primary.icon_bottom);
+	section.read(out.primary.icon_right);
+	section.read(out.active.bg);
+	section.read(out.active.icon_color);
+	section.read(out.active.icon_top);
+	section.read(out.active.icon_left);
+	section.read(out.active.icon_bottom);
+	section.read(out.active.icon_right);
+	section.read(out.disabled.bg);
+	section.read(out.disabled.icon_color);
+	section.read(out.disabled.icon_top);
+	section.read(out.disabled.icon_left);
+	section.read(out.disabled.icon_bottom);
+	section.read(out.disabled.icon_right);
+}
+
+static void read_entry(serialization::in_buffer& section, layout_region_template& out) {
+	section.read(out.display_name);
+	section.read(out.page_number_text.bg);
+	section.read(out.page_number_text.text_color);
+	section.read(out.page_number_text.font_choice);
+	section.read(out.page_number_text.font_scale);
+	section.read(out.page_number_text.h_text_margins);
+	section.read(out.page_number_text.v_text_margins);
+	section.read(out.page_number_text.h_text_alignment);
+	section.read(out.page_number_text.v_text_alignment);
+	section.read(out.bg);
+	section.read(out.left_button);
+	section.read(out.left_button_icon);
+	section.read(out.right_button);
+	section.read(out.right_button_icon);
+}
+
+static void read_entry(serialization::in_buffer& section, mixed_template& out) {
+	section.read(out.display_name);
+
+	section.read(out.primary.bg);
+	section.read(out.primary.shared_color);
+	section.read(out.primary.font_choice);
+	section.read(out.primary.font_scale);
+	section.read(out.primary.h_text_margins);
+	section.read(out.primary.v_text_margins);
+	section.read(out.primary.h_text_alignment);
+	section.read(out.primary.v_text_alignment);
+	section.read(out.primary.icon_top);
+	section.read(out.primary.icon_left);
+	section.read(out.primary.icon_bottom);
+	section.read(out.primary.icon_right);
+
+	section.read(out.active.bg);
+	section.read(out.active.shared_color);
+	section.read(out.active.font_choice);
+	section.read(out.active.font_scale);
+	section.read(out.active.h_text_margins);
+	section.read(out.active.v_text_margins);
+	section.read(out.active.h_text_alignment);
+	section.read(out.active.v_text_alignment);
+	section.read(out.active.icon_top);
+	section.read(out.active.icon_left);
+	section.read(out.active.icon_bottom);
+	section.read(out.active.icon_right);
+
+	section.read(out.disabled.bg);
+	section.read(out.disabled.shared_color);
+	section.read(out.disabled.font_choice);
+	section.read(out.disabled.font_scale);
+	section.read(out.disabled.h_text_margins);
+	section.read(out.disabled.v_text_margins);
+	section.read(out.disabled.h_text_alignment);
+	section.read(out.disabled.v_text_alignment);
+	section.read(out.disabled.icon_top);
+	section.read(out.disabled.icon_left);
+	section.read(out.disabled.icon_bottom);
+	section.read(out.disabled.icon_right);
+
+	section.read(out.animate_active_transition);
+}
+
+static void read_entry(serialization::in_buffer& section, toggle_button_template& out) {
+	section.read(out.display_name);
+	section.read(out.on_region.primary.bg);
+	section.read(out.on_region.primary.color);
+	section.read(out.on_region.active.bg);
+	section.read(out.on_region.active.color);
+	section.read(out.on_region.disabled.bg);
+	section.read(out.on_region.disabled.color);
+	section.read(out.on_region.font_choice);
+	section.read(out.on_region.font_scale);
+	section.read(out.on_region.h_text_alignment);
+	section.read(out.on_region.v_text_alignment);
+	section.read(out.on_region.text_margin_left);
+	section.read(out.on_region.text_margin_right);
+	section.read(out.on_region.text_margin_top);
+	section.read(out.on_region.text_margin_bottom);
+
+	section.read(out.off_region.primary.bg);
+	section.read(out.off_region.primary.color);
+	section.read(out.off_region.active.bg);
+	section.read(out.off_region.active.color);
+	section.read(out.off_region.disabled.bg);
+	section.read(out.off_region.disabled.color);
+	section.read(out.off_region.font_choice);
+	section.read(out.off_region.font_scale);
+	section.read(out.off_region.h_text_alignment);
+	section.read(out.off_region.v_text_alignment);
+	section.read(out.off_region.text_margin_left);
+	section.read(out.off_region.text_margin_right);
+	section.read(out.off_region.text_margin_top);
+	section.read(out.off_region.text_margin_bottom);
+
+	section.read(out.animate_active_transition);
+}
+
+namespace {
+// where each section starts (at its size prefix), indexed by template_type with the header under none
+struct section_table {
+	std::vector<serialization::in_buffer> starts;
+	std::array<uint32_t, type_count> counts = { };
+};
+}
+
+static section_table locate_sections(serialization::in_buffer const& buffer) {
+	section_table result;
+	result.starts.resize(type_count, serialization::in_buffer{ nullptr, 0 });
+
+	auto probe = buffer;
+	if(probe.read<uint32_t>() == tui_magic) {
+		probe.read<uint32_t>(); // format version: entries only ever gain trailing fields, which older readers skip
+		auto rows = probe.read<uint32_t>();
+		for(uint32_t i = 0; i < rows && probe; ++i) {
+			auto type = probe.read<uint32_t>();
+			auto start = probe.read_relocation();
+			probe.read<uint32_t>(); // length
+			auto count = probe.read<uint32_t>();
+			if(type < type_count) { // sections added by newer versions are skipped
+				result.starts[type] = start;
+				result.counts[type] = count;
+			}
+		}
+	} else { // written before the table of contents: the sections follow each other in a fixed order
+		auto position = buffer;
+		result.starts[size_t(template_type::none)] = position;
+		position.read_section();
+		for(auto t : section_order) {
+			result.starts[size_t(t)] = position;
+			position.read_section();
+		}
+	}
+	return result;
+}
+
+template<typename T>
+static void read_list(section_table const& table, template_type t, std::vector<T>& out) {
+	auto list_section = table.starts[size_t(t)];
+	auto section = list_section.read_section();
+	out.reserve(table.counts[size_t(t)]);
+	while(section) {
+		auto individual_entry = section.read_section();
+		read_entry(individual_entry, out.emplace_back());
+	}
 }
 
 project bytes_to_project(serialization::in_buffer& buffer) {
 	project result;
-	auto header_section = buffer.read_section();
-	header_section.read(result.svg_directory);
+	auto table = locate_sections(buffer);
 
+	auto header_start = table.starts[size_t(template_type::none)];
+	auto header_section = header_start.read_section();
+	header_section.read(result.svg_directory);
 
-		auto colors_section = buffer.read_section();
-		while(colors_section) {
-			result.colors.emplace_back();
-			auto individual_color = colors_section.read_section();
-			individual_color.read(result.colors.back().display_name);
-			individual_color.read(result.colors.back().r);
-			individual_color.read(result.colors.back().g);
-			individual_color.read(result.colors.back().b);
-			individual_color.read(result.colors.back().a);
-		}
+	read_list(table, template_type::color, result.colors);
+	read_list(table, template_type::icon, result.icons);
+	read_list(table, template_type::background, result.backgrounds);
+	read_list(table, template_type::label, result.label_t);
+	read_list(table, template_type::button, result.button_t);
+	read_list(table, template_type::progress_bar, result.progress_bar_t);
+	read_list(table, template_type::window, result.window_t);
+	read_list(table, template_type::iconic_button, result.iconic_button_t);
+	read_list(table, template_type::layout_region, result.layout_region_t);
+	read_list(table, template_type::mixed_button, result.mixed_button_t);
+	read_list(table, template_type::toggle_button, result.toggle_button_t);
 
-		auto icons_section = buffer.read_section();
-		while(icons_section) {
-			result.icons.emplace_back();
-			auto indv_icon = icons_section.read_section();
-			indv_icon.read(result.icons.back().file_name);
-		}
+	return result;
+}
 
-		auto bg_section = buffer.read_section();
-		while(bg_section) {
-			result.backgrounds.emplace_back();
-			auto indv_icon = bg_section.read_section();
-			indv_icon.read(result.backgrounds.back().file_name);
-			indv_icon.read(result.backgrounds.back().base_x);
-			indv_icon.read(result.backgrounds.back().base_y);
-		}
+project_view::project_view(std::wstring const& full_path) {
+	mapped_file.emplace(full_path);
+	data = mapped_file->content().data;
+	size = size_t(mapped_file->content().file_size);
+	build_index();
+}
 
-		auto labels_section = buffer.read_section();
-		while(labels_section) {
-			result.label_t.emplace_back();
-			auto indv_label = labels_section.read_section();
-			indv_label.read(result.label_t.back().display_name);
-			indv_label.read(result.label_t.back().primary.bg);
-			indv_label.read(result.label_t.back().primary.text_color);
-			indv_label.read(result.label_t.back().primary.font_choice);
-			indv_label.read(result.label_t.back().primary.font_scale);
-			indv_label.read(result.label_t.back().primary.h_text_margins);
-			indv_label.read(result.label_t.back().primary.v_text_margins);
-			indv_label.read(result.label_t.back().primary.h_text_alignment);
-			indv_label.read(result.label_t.back().primary.v_text_alignment);
-		}
+project_view::project_view(char const* data, size_t size) : data(data), size(size) {
+	build_index();
+}
 
-		auto buttons_section = buffer.read_section();
-		while(buttons_section) {
-			result.button_t.emplace_back();
-			auto indv_button = buttons_section.read_section();
-			indv_button.read(result.button_t.back().display_name);
-			indv_button.read(result.button_t.back().animate_active_transition);
-			indv_button.read(result.button_t.back().primary.bg);
-			indv_button.read(result.button_t.back().primary.text_color);
-			indv_button.read(result.button_t.back().primary.font_choice);
-			indv_button.read(result.button_t.back().primary.font_scale);
-			indv_button.read(result.button_t.back().primary.h_text_margins);
-			indv_button.read(result.button_t.back().primary.v_text_margins);
-			indv_button.read(result.button_t.back().primary.h_text_alignment);
-			indv_button.read(result.button_t.back().primary.v_text_alignment);
-			indv_button.read(result.button_t.back().active.bg);
-			indv_button.read(result.button_t.back().active.text_color);
-			indv_button.read(result.button_t.back().active.font_choice);
-			indv_button.read(result.button_t.back().active.font_scale);
-			indv_button.read(result.button_t.back().active.h_text_margins);
-			indv_button.read(result.button_t.back().active.v_text_margins);
-			indv_button.read(result.button_t.back().active.h_text_alignment);
-			indv_button.read(result.button_t.back().active.v_text_alignment);
-			indv_button.read(result.button_t.back().disabled.bg);
-			indv_button.read(result.button_t.back().disabled.text_color);
-			indv_button.read(result.button_t.back().disabled.font_choice);
-			indv_button.read(result.button_t.back().disabled.font_scale);
-			indv_button.read(result.button_t.back().disabled.h_text_margins);
-			indv_button.read(result.button_t.back().disabled.v_text_margins);
-			indv_button.read(result.button_t.back().disabled.h_text_alignment);
-			indv_button.read(result.button_t.back().disabled.v_text_alignment);
+void project_view::build_index() {
+	auto table = locate_sections(serialization::in_buffer{ data, size });
+	header_position = table.starts[size_t(template_type::none)].get_read_position();
+
+	for(auto t : section_order) {
+		auto list_start = table.starts[size_t(t)];
+		auto list_section = list_start.read_section();
+		auto& positions = entry_positions[size_t(t)];
+		positions.reserve(table.counts[size_t(t)]);
+		while(list_section) {
+			positions.push_back(uint32_t(list_section.get_read_position()));
+			list_section.read_section();
 		}
+	}
+}
 
-		auto pbs_section = buffer.read_section();
-		while(pbs_section) {
-			result.progress_bar_t.emplace_back();
-			auto indv_pb = pbs_section.read_section();
-			indv_pb.read(result.progress_bar_t.back().display_name);
-			indv_pb.read(result.progress_bar_t.back().bg_a);
-			indv_pb.read(result.progress_bar_t.back().bg_b);
-			indv_pb.read(result.progress_bar_t.back().text_color);
-			indv_pb.read(result.progress_bar_t.back().font_choice);
-			indv_pb.read(result.progress_bar_t.back().h_text_margins);
-			indv_pb.read(result.progress_bar_t.back().v_text_margins);
-			indv_pb.read(result.progress_bar_t.back().h_text_alignment);
-			indv_pb.read(result.progress_bar_t.back().v_text_alignment);
-			indv_pb.read(result.progress_bar_t.back().display_percentage_text);
-		}
+serialization::in_buffer project_view::entry(template_type t, uint32_t index) const {
+	serialization::in_buffer buffer{ data, size, entry_positions[size_t(t)][index] };
+	return buffer.read_section();
+}
 
-		auto windows_section = buffer.read_section();
-		while(windows_section) {
-			result.window_t.emplace_back();
-			auto indv_win = windows_section.read_section();
-			indv_win.read(result.window_t.back().display_name);
-			indv_win.read(result.window_t.back().bg);
-			indv_win.read(result.window_t.back().layout_region_definition);
-			indv_win.read(result.window_t.back().close_button_definition);
-			indv_win.read(result.window_t.back().close_button_icon);
-			indv_win.read(result.window_t.back().h_close_button_margin);
-			indv_win.read(result.window_t.back().v_close_button_margin);
-		}
+std::wstring project_view::svg_directory() const {
+	std::wstring result;
+	serialization::in_buffer buffer{ data, size, header_position };
+	auto header_section = buffer.read_section();
+	header_section.read(result);
+	return result;
+}
 
-		auto ibuttons_section = buffer.read_section();
-		while(ibuttons_section) {
-			result.iconic_button_t.emplace_back();
-			auto indv_ibutton = ibuttons_section.read_section();
-			indv_ibutton.read(result.iconic_button_t.back().display_name);
-			indv_ibutton.read(result.iconic_button_t.back().animate_active_transition);
-			indv_ibutton.read(result.iconic_button_t.back().primary.bg);
-			indv_ibutton.read(result.iconic_button_t.back().primary.icon_color);
-			indv_ibutton.read(result.iconic_button_t.back().primary.icon_top);
-			indv_ibutton.read(result.iconic_button_t.back().primary.icon_left);
-			indv_ibutton.read(result.iconic_button_t.back().primary.icon_bottom);
-			indv_ibutton.read(result.iconic_button_t.back().primary.icon_right);
-			indv_ibutton.read(result.iconic_button_t.back().active.bg);
-			indv_ibutton.read(result.iconic_button_t.back().active.icon_color);
-			indv_ibutton.read(result.iconic_button_t.back().active.icon_top);
-			indv_ibutton.read(result.iconic_button_t.back().active.icon_left);
-			indv_ibutton.read(result.iconic_button_t.back().active.icon_bottom);
-			indv_ibutton.read(result.iconic_button_t.back().active.icon_right);
-			indv_ibutton.read(result.iconic_button_t.back().disabled.bg);
-			indv_ibutton.read(result.iconic_button_t.back().disabled.icon_color);
-			indv_ibutton.read(result.iconic_button_t.back().disabled.icon_top);
-			indv_ibutton.read(result.iconic_button_t.back().disabled.icon_left);
-			indv_ibutton.read(result.iconic_button_t.back().disabled.icon_bottom);
-			indv_ibutton.read(result.iconic_button_t.back().disabled.icon_right);
-		}
+uint32_t project_view::count(template_type t) const {
+	return uint32_t(entry_positions[size_t(t)].size());
+}
 
-		auto layout_regions_section = buffer.read_section();
-		while(layout_regions_section) {
-			result.layout_region_t.emplace_back();
-			auto indv_lr = layout_regions_section.read_section();
-			indv_lr.read(result.layout_region_t.back().display_name);
-			indv_lr.read(result.layout_region_t.back().page_number_text.bg);
-			indv_lr.read(result.layout_region_t.back().page_number_text.text_color);
-			indv_lr.read(result.layout_region_t.back().page_number_text.font_choice);
-			indv_lr.read(result.layout_region_t.back().page_number_text.font_scale);
-			indv_lr.read(result.layout_region_t.back().page_number_text.h_text_margins);
-			indv_lr.read(result.layout_region_t.back().page_number_text.v_text_margins);
-			indv_lr.read(result.layout_region_t.back().page_number_text.h_text_alignment);
-			indv_lr.read(result.layout_region_t.back().page_number_text.v_text_alignment);
-			indv_lr.read(result.layout_region_t.back().bg);
-			indv_lr.read(result.layout_region_t.back().left_button);
-			indv_lr.read(result.layout_region_t.back().left_button_icon);
-			indv_lr.read(result.layout_region_t.back().right_button);
-			indv_lr.read(result.layout_region_t.back().right_button_icon);
-		}
+std::string_view project_view::name(template_type t, uint32_t index) const {
+	// every entry starts with its name
+	auto section = entry(t, index);
+	return section.read<std::string_view>();
+}
 
-		auto mb_section = buffer.read_section();
-		while(mb_section) {
-			result.mixed_button_t.emplace_back();
-			auto indv_mb = mb_section.read_section();
-			auto& i = result.mixed_button_t.back();
-
-			indv_mb.read(i.display_name);
-
-			indv_mb.read(i.primary.bg);
-			indv_mb.read(i.primary.shared_color);
-			indv_mb.read(i.primary.font_choice);
-			indv_mb.read(i.primary.font_scale);
-			indv_mb.read(i.primary.h_text_margins);
-			indv_mb.read(i.primary.v_text_margins);
-			indv_mb.read(i.primary.h_text_alignment);
-			indv_mb.read(i.primary.v_text_alignment);
-			indv_mb.read(i.primary.icon_top);
-			indv_mb.read(i.primary.icon_left);
-			indv_mb.read(i.primary.icon_bottom);
-			indv_mb.read(i.primary.icon_right);
-
-			indv_mb.read(i.active.bg);
-			indv_mb.read(i.active.shared_color);
-			indv_mb.read(i.active.font_choice);
-			indv_mb.read(i.active.font_scale);
-			indv_mb.read(i.active.h_text_margins);
-			indv_mb.read(i.active.v_text_margins);
-			indv_mb.read(i.active.h_text_alignment);
-			indv_mb.read(i.active.v_text_alignment);
-			indv_mb.read(i.active.icon_top);
-			indv_mb.read(i.active.icon_left);
-			indv_mb.read(i.active.icon_bottom);
-			indv_mb.read(i.active.icon_right);
-
-			indv_mb.read(i.disabled.bg);
-			indv_mb.read(i.disabled.shared_color);
-			indv_mb.read(i.disabled.font_choice);
-			indv_mb.read(i.disabled.font_scale);
-			indv_mb.read(i.disabled.h_text_margins);
-			indv_mb.read(i.disabled.v_text_margins);
-			indv_mb.read(i.disabled.h_text_alignment);
-			indv_mb.read(i.disabled.v_text_alignment);
-			indv_mb.read(i.disabled.icon_top);
-			indv_mb.read(i.disabled.icon_left);
-			indv_mb.read(i.disabled.icon_bottom);
-			indv_mb.read(i.disabled.icon_right);
-
-			indv_mb.read(i.animate_active_transition);
-		}
+int32_t project_view::find(template_type t, std::string_view entry_name) const {
+	for(uint32_t i = 0; i < count(t); ++i) {
+		if(name(t, i) == entry_name)
+			return int32_t(i);
+	}
+	return -1;
+}
 
-		auto tb_section = buffer.read_section();
-		while(tb_section) {
-			result.toggle_button_t.emplace_back();
-			auto indv_tb = tb_section.read_section();
-			auto& i = result.toggle_button_t.back();
-
-			indv_tb.read(i.display_name);
-			indv_tb.read(i.on_region.primary.bg);
-			indv_tb.read(i.on_region.primary.color);
-			indv_tb.read(i.on_region.active.bg);
-			indv_tb.read(i.on_region.active.color);
-			indv_tb.read(i.on_region.disabled.bg);
-			indv_tb.read(i.on_region.disabled.color);
-			indv_tb.read(i.on_region.font_choice);
-			indv_tb.read(i.on_region.font_scale);
-			indv_tb.read(i.on_region.h_text_alignment);
-			indv_tb.read(i.on_region.v_text_alignment);
-			indv_tb.read(i.on_region.text_margin_left);
-			indv_tb.read(i.on_region.text_margin_right);
-			indv_tb.read(i.on_region.text_margin_top);
-			indv_tb.read(i.on_region.text_margin_bottom);
-
-			indv_tb.read(i.off_region.primary.bg);
-			indv_tb.read(i.off_region.primary.color);
-			indv_tb.read(i.off_region.active.bg);
-			indv_tb.read(i.off_region.active.color);
-			indv_tb.read(i.off_region.disabled.bg);
-			indv_tb.read(i.off_region.disabled.color);
-			indv_tb.read(i.off_region.font_choice);
-			indv_tb.read(i.off_region.font_scale);
-			indv_tb.read(i.off_region.h_text_alignment);
-			indv_tb.read(i.off_region.v_text_alignment);
-			indv_tb.read(i.off_region.text_margin_left);
-			indv_tb.read(i.off_region.text_margin_right);
-			indv_tb.read(i.off_region.text_margin_top);
-			indv_tb.read(i.off_region.text_margin_bottom);
-
-			indv_tb.read(i.animate_active_transition);
-		}
-	
+template<typename T>
+static T decode_entry(serialization::in_buffer section) {
+	T result;
+	read_entry(section, result);
 	return result;
 }
 
+color_definition project_view::color(uint32_t index) const {
+	return decode_entry<color_definition>(entry(template_type::color, index));
+}
+icon_definition project_view::icon(uint32_t index) const {
+	return decode_entry<icon_definition>(entry(template_type::icon, index));
+}
+background_definition project_view::background(uint32_t index) const {
+	return decode_entry<background_definition>(entry(template_type::background, index));
+}
+label_template project_view::label(uint32_t index) const {
+	return decode_entry<label_template>(entry(template_type::label, index));
+}
+button_template project_view::button(uint32_t index) const {
+	return decode_entry<button_template>(entry(template_type::button, index));
+}
+progress_bar_template project_view::progress_bar(uint32_t index) const {
+	return decode_entry<progress_bar_template>(entry(template_type::progress_bar, index));
+}
+window_template project_view::window(uint32_t index) const {
+	return decode_entry<window_template>(entry(template_type::window, index));
+}
+iconic_button_template project_view::iconic_button(uint32_t index) const {
+	return decode_entry<iconic_button_template>(entry(template_type::iconic_button, index));
+}
+layout_region_template project_view::layout_region(uint32_t index) const {
+	return decode_entry<layout_region_template>(entry(template_type::layout_region, index));
+}
+mixed_template project_view::mixed_button(uint32_t index) const {
+	return decode_entry<mixed_template>(entry(template_type::mixed_button, index));
+}
+toggle_button_template project_view::toggle_button(uint32_t index) const {
+	return decode_entry<toggle_button_template>(entry(template_type::toggle_button, index));
 }
 
+}
@@ -0,0 +1,137 @@
+#include "quad_batch.hpp"
+#include "glew.h"
+#include <cstddef>
+
+namespace ogl {
+
+void quad_batch::attach(uint32_t va) {
+	vertex_array = va;
+	auto total_size = GLsizeiptr(sizeof(quad_instance) * segment_capacity * segment_count);
+
+	glGenBuffers(1, &instance_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+	if(GLEW_ARB_buffer_storage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, total_size, nullptr, flags);
+		mapped = static_cast<quad_instance*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, total_size, flags));
+		if(!mapped) { // storage is immutable, so start over with a plain buffer
+			glDeleteBuffers(1, &instance_buffer);
+			glGenBuffers(1, &instance_buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+		}
+	}
+	if(!mapped) {
+		glBufferData(GL_ARRAY_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+		staging.resize(segment_capacity);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(vertex_array);
+	for(GLuint i = 2; i <= 6; ++i) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribBinding(i, 1);
+	}
+	glVertexAttribFormat(2, 4, GL_FLOAT, GL_FALSE, GLuint(offsetof(quad_instance, rect)));
+	glVertexAttribFormat(3, 4, GL_FLOAT, GL_FALSE, GLuint(offsetof(quad_instance, uv_rect)));
+	glVertexAttribFormat(4, 3, GL_FLOAT, GL_FALSE, GLuint(offsetof(quad_instance, color)));
+	glVertexAttribFormat(5, 2, GL_FLOAT, GL_FALSE, GLuint(offsetof(quad_instance, border_size))); // border size, grid size
+	glVertexAttribIFormat(6, 1, GL_UNSIGNED_INT, GLuint(offsetof(quad_instance, subroutine)));
+	glVertexBindingDivisor(1, 1);
+	glBindVertexBuffer(1, instance_buffer, 0, sizeof(quad_instance));
+	glBindVertexArray(0);
+}
+
+void quad_batch::wait_for_segment() {
+	auto fence = static_cast<GLsync>(fences[segment]);
+	if(!fence)
+		return;
+	while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+	}
+	glDeleteSync(fence);
+	fences[segment] = nullptr;
+}
+
+void quad_batch::begin_frame() {
+	wait_for_segment();
+	count = 0;
+	first_unflushed = 0;
+	bound_texture = 0;
+	draw_calls = 0;
+	quads = 0;
+}
+
+void quad_batch::push(quad_instance const& q, uint32_t texture_handle) {
+	if(texture_handle != 0 && texture_handle != bound_texture) {
+		if(bound_texture != 0)
+			flush();
+		bound_texture = texture_handle;
+	}
+	if(count == segment_capacity) {
+		// out of room for this frame: wait until the gpu is done with what was already drawn from this segment
+		flush();
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		wait_for_segment();
+		count = 0;
+		first_unflushed = 0;
+	}
+	if(mapped)
+		mapped[segment * segment_capacity + count] = q;
+	else
+		staging[count] = q;
+	++count;
+	++quads;
+}
+
+void quad_batch::flush() {
+	if(count == first_unflushed)
+		return;
+
+	auto first = segment * segment_capacity + first_unflushed;
+	if(!mapped) {
+		glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(sizeof(quad_instance) * first), GLsizeiptr(sizeof(quad_instance) * (count - first_unflushed)), staging.data() + first_unflushed);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	glBindVertexArray(vertex_array);
+	glBindVertexBuffer(1, instance_buffer, GLintptr(sizeof(quad_instance) * first), sizeof(quad_instance));
+	if(bound_texture != 0) {
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, bound_texture);
+	}
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, GLsizei(count - first_unflushed));
+
+	first_unflushed = count;
+	++draw_calls;
+}
+
+void quad_batch::end_frame() {
+	flush();
+	if(mapped)
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	segment = (segment + 1) % segment_count;
+	last_frame_draw_calls = draw_calls;
+	last_frame_quads = quads;
+}
+
+void quad_batch::release() {
+	for(segment = 0; segment < segment_count; ++segment) {
+		if(fences[segment]) {
+			glDeleteSync(static_cast<GLsync>(fences[segment]));
+			fences[segment] = nullptr;
+		}
+	}
+	segment = 0;
+	if(instance_buffer) {
+		if(mapped) {
+			glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			mapped = nullptr;
+		}
+		glDeleteBuffers(1, &instance_buffer);
+		instance_buffer = 0;
+	}
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+namespace ogl {
+
+// per-quad attributes read by the ui shader; the layout must match quad_batch::attach
+struct quad_instance {
+	float rect[4] = { 0.0f, 0.0f, 0.0f, 0.0f }; // x, y, width, height in pixels
+	float uv_rect[4] = { 0.0f, 0.0f, 1.0f, 1.0f }; // u0, v0, u1, v1
+	float color[3] = { 0.0f, 0.0f, 0.0f };
+	float border_size = 0.0f;
+	float grid_size = 0.0f;
+	uint32_t subroutine = 0;
+};
+
+// collects ui quads into a persistently mapped instance buffer and draws them with one instanced draw per texture
+// the buffer is split into one segment per frame in flight, each guarded by a fence
+class quad_batch {
+public:
+	static constexpr uint32_t segment_capacity = 8192;
+	static constexpr uint32_t segment_count = 3;
+
+	uint32_t vertex_array = 0;
+	uint32_t instance_buffer = 0;
+	quad_instance* mapped = nullptr;
+	std::vector<quad_instance> staging; // used instead of mapping when buffer storage is unavailable
+	std::array<void*, segment_count> fences = { nullptr, nullptr, nullptr };
+
+	uint32_t segment = 0;
+	uint32_t first_unflushed = 0;
+	uint32_t count = 0;
+	uint32_t bound_texture = 0;
+
+	uint32_t draw_calls = 0;
+	uint32_t quads = 0;
+	uint32_t last_frame_draw_calls = 0;
+	uint32_t last_frame_quads = 0;
+
+	quad_batch() { }
+	quad_batch(quad_batch const&) = delete;
+	quad_batch& operator=(quad_batch const&) = delete;
+
+	// creates the instance buffer and adds the per-instance attributes (locations 2 - 6) to the given vertex array
+	void attach(uint32_t vertex_array);
+	void begin_frame();
+	// texture_handle 0 means the quad does not sample a texture and can join any batch
+	void push(quad_instance const& q, uint32_t texture_handle);
+	void flush();
+	void end_frame();
+	// must be called while the context is still current
+	void release();
+private:
+	void wait_for_segment();
+};
+
+}
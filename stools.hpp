@@ -88,6 +88,12 @@ public:
 	size_t get_data_position() const {
 		return data_.size();
 	}
+	// overwrites already written data, e.g. to fill in a table once the things it points to have been written
+	template<typename T>
+	void write_at(size_t position, T const& d) {
+		assert(position + sizeof(T) <= data_.size());
+		std::memcpy(data_.data() + position, &d, sizeof(T));
+	}
 	void write(std::string_view sv) {
 		write_variable(sv.data(), sv.length());
 	}
@@ -95,10 +101,26 @@ public:
 		write_variable(s.data(), s.length());
 	}
 	void write(std::wstring_view sv) {
-		write_variable(sv.data(), sv.length());
+		if constexpr(sizeof(wchar_t) == sizeof(char16_t)) {
+			write_variable(sv.data(), sv.length());
+		} else {
+			// wide strings are always stored as utf16, as they are on windows
+			std::u16string units;
+			for(auto c : sv) {
+				auto cp = uint32_t(c);
+				if(cp >= 0x10000) {
+					cp -= 0x10000;
+					units.push_back(char16_t(0xD800 + (cp >> 10)));
+					units.push_back(char16_t(0xDC00 + (cp & 0x3FF)));
+				} else {
+					units.push_back(char16_t(cp));
+				}
+			}
+			write_variable(units.data(), units.length());
+		}
 	}
 	void write(std::wstring const& s) {
-		write_variable(s.data(), s.length());
+		write(std::wstring_view(s));
 	}
 };
 
@@ -115,6 +137,9 @@ public:
 	operator bool() const noexcept {
 		return data && read_position < size;
 	}
+	size_t get_read_position() const {
+		return read_position;
+	}
 
 	template<typename T>
 	T read() {
@@ -155,24 +180,40 @@ public:
 		read_position += (section_size - 4);
 		return in_buffer(data, std::min(size_t(start_postion + section_size - 4), size), start_postion);
 	}
-	template<>
-	std::string_view read<std::string_view>() {
-		auto s = read_variable<char>();
-		return std::string_view(s.data(), s.size());
-	}
-	template<>
-	std::wstring_view read<std::wstring_view>() {
-		auto s = read_variable<wchar_t>();
-		return std::wstring_view(s.data(), s.size());
-	}
 	void read(std::string& out) {
 		auto s = read_variable<char>();
 		out = std::string(s.data(), s.size());
 	}
 	void read(std::wstring& out) {
-		auto s = read_variable<wchar_t>();
-		out = std::wstring(s.data(), s.size());
+		if constexpr(sizeof(wchar_t) == sizeof(char16_t)) {
+			auto s = read_variable<wchar_t>();
+			out = std::wstring(s.data(), s.size());
+		} else {
+			auto s = read_variable<char16_t>();
+			out.clear();
+			for(size_t i = 0; i < s.size(); ++i) {
+				uint32_t cp = s[i];
+				if(0xD800 <= cp && cp < 0xDC00 && i + 1 < s.size()) {
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (uint32_t(s[i + 1]) - 0xDC00);
+					++i;
+				}
+				out.push_back(wchar_t(cp));
+			}
+		}
 	}
 };
 
+template<>
+inline std::string_view in_buffer::read<std::string_view>() {
+	auto s = read_variable<char>();
+	return std::string_view(s.data(), s.size());
+}
+#ifdef _WIN32
+template<>
+inline std::wstring_view in_buffer::read<std::wstring_view>() {
+	auto s = read_variable<wchar_t>();
+	return std::wstring_view(s.data(), s.size());
+}
+#endif
+
 }
@@ -3,8 +3,19 @@
 #include <cstdint>
 #include <string>
 #include <variant>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <string_view>
+#include "filesystem.hpp"
 #include "asvg.hpp"
 
+namespace serialization {
+class out_buffer;
+class in_buffer;
+}
+
 struct color3f {
 	float r = 0.0f;
 	float g = 0.0f;
@@ -227,4 +238,58 @@ struct project {
 	std::vector<color_definition> colors;
 };
 
+// a .tui file starts with tui_magic, the format version and a table of contents with one row per section:
+// type id (template_type, none for the header), offset, length in bytes and entry count
+// files written before the table existed start directly with the header section, and are still read
+constexpr uint32_t tui_magic = 0x49555441; // "ATUI"
+constexpr uint32_t tui_format_version = 1;
+
+void project_to_bytes(project const& p, serialization::out_buffer& buffer);
+project bytes_to_project(serialization::in_buffer& buffer);
+
+// read-only access to a serialized project that decodes an entry only when it is asked for
+// construction just walks the section sizes to find where each entry starts; names are views into the file data
+class project_view {
+	std::optional<fs::file> mapped_file;
+	char const* data = nullptr;
+	size_t size = 0;
+	size_t header_position = 0;
+	std::array<std::vector<uint32_t>, size_t(template_type::toggle_button) + 1> entry_positions; // indexed by template_type
+
+	void build_index();
+	serialization::in_buffer entry(template_type t, uint32_t index) const;
+public:
+	// keeps the file mapped for as long as the view lives
+	project_view(std::wstring const& full_path);
+	// the data must outlive the view
+	project_view(char const* data, size_t size);
+	project_view(project_view const&) = delete;
+	project_view(project_view&&) noexcept = default;
+	project_view& operator=(project_view const&) = delete;
+	project_view& operator=(project_view&&) noexcept = default;
+
+	// false when the file could not be opened
+	bool is_open() const {
+		return data != nullptr;
+	}
+	std::wstring svg_directory() const;
+	uint32_t count(template_type t) const;
+	// the display name of a color or template, or the file name of an icon or background
+	std::string_view name(template_type t, uint32_t index) const;
+	// returns -1 when there is no entry with that name
+	int32_t find(template_type t, std::string_view entry_name) const;
+
+	color_definition color(uint32_t index) const;
+	icon_definition icon(uint32_t index) const;
+	background_definition background(uint32_t index) const;
+	label_template label(uint32_t index) const;
+	button_template button(uint32_t index) const;
+	progress_bar_template progress_bar(uint32_t index) const;
+	window_template window(uint32_t index) const;
+	iconic_button_template iconic_button(uint32_t index) const;
+	layout_region_template layout_region(uint32_t index) const;
+	mixed_template mixed_button(uint32_t index) const;
+	toggle_button_template toggle_button(uint32_t index) const;
+};
+
 }
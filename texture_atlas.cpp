@@ -0,0 +1,308 @@
+#include "texture_atlas.hpp"
+#include "glew.h"
+#include "profiler.hpp"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace ogl {
+
+struct texture_atlas::page {
+	uint32_t texture_handle = 0;
+	int32_t width = 0;
+	int32_t height = 0;
+	bool dedicated = false; // holds a single image that is too large for a shared page
+	int64_t used_area = 0;
+	int64_t freed_area = 0;
+	int64_t repack_failed_at = -1; // used_area when a repack of this page last failed
+	stbrp_context context;
+	std::vector<stbrp_node> nodes;
+};
+
+namespace {
+
+uint32_t create_page_texture(int32_t width, int32_t height) {
+	uint32_t handle = 0;
+	glGenTextures(1, &handle);
+	if(handle) {
+		glBindTexture(GL_TEXTURE_2D, handle);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	return handle;
+}
+
+// sets a rect of the texture to transparent black; pages start out undefined, and freed space keeps the pixels of old renders
+void clear_texture_rect(uint32_t handle, int32_t x, int32_t y, int32_t width, int32_t height) {
+	if(width <= 0 || height <= 0)
+		return;
+	if(GLEW_ARB_clear_texture) {
+		glClearTexSubImage(handle, 0, x, y, 0, width, height, 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+		return;
+	}
+	std::vector<uint32_t> zeros(size_t(width) * size_t(height), 0);
+	glBindTexture(GL_TEXTURE_2D, handle);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, zeros.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// clears the gutter around an allocation, so that filtering at its edges blends with transparency rather than a neighbour
+void clear_gutter(uint32_t handle, int32_t x, int32_t y, int32_t width, int32_t height, int32_t padding) {
+	clear_texture_rect(handle, x - padding, y - padding, width + 2 * padding, padding);
+	clear_texture_rect(handle, x - padding, y + height, width + 2 * padding, padding);
+	clear_texture_rect(handle, x - padding, y, padding, height);
+	clear_texture_rect(handle, x + width, y, padding, height);
+}
+
+}
+
+texture_atlas::texture_atlas() {
+	allocations.emplace_back();
+}
+
+texture_atlas::~texture_atlas() {
+	clear();
+}
+
+uint32_t texture_atlas::new_page(int32_t width, int32_t height, bool dedicated) {
+	auto p = std::make_unique<page>();
+	p->texture_handle = create_page_texture(width, height);
+	if(p->texture_handle == 0)
+		return uint32_t(-1);
+	p->width = width;
+	p->height = height;
+	p->dedicated = dedicated;
+	if(!dedicated) {
+		p->nodes.resize(size_t(width));
+		stbrp_init_target(&p->context, width, height, p->nodes.data(), int(p->nodes.size()));
+	}
+
+	for(uint32_t i = 0; i < pages.size(); ++i) {
+		if(!pages[i]) {
+			pages[i] = std::move(p);
+			return i;
+		}
+	}
+	pages.push_back(std::move(p));
+	return uint32_t(pages.size() - 1);
+}
+
+void texture_atlas::release_page(uint32_t index) {
+	if(pages[index]->texture_handle != 0)
+		retired_textures.push_back(pages[index]->texture_handle);
+	pages[index].reset();
+}
+
+void texture_atlas::release_retired() {
+	if(!retired_textures.empty())
+		glDeleteTextures(GLsizei(retired_textures.size()), retired_textures.data());
+	retired_textures.clear();
+}
+
+uint32_t texture_atlas::allocate(char const* pixels, int32_t width, int32_t height) {
+	if(width <= 0 || height <= 0)
+		return 0;
+
+	allocation a;
+	a.width = width;
+	a.height = height;
+	a.in_use = true;
+
+	// the packed rect has a gutter of padding on every side, and the allocation sits inside it
+	bool placed = false;
+	if(width + 2 * padding > page_size || height + 2 * padding > page_size) {
+		a.page = new_page(width, height, true);
+		if(a.page == uint32_t(-1))
+			return 0;
+		placed = true;
+	}
+	stbrp_rect r{ };
+	r.w = width + 2 * padding;
+	r.h = height + 2 * padding;
+	for(uint32_t i = 0; !placed && i < pages.size(); ++i) {
+		if(!pages[i] || pages[i]->dedicated)
+			continue;
+		if(stbrp_pack_rects(&pages[i]->context, &r, 1) != 0) {
+			a.page = i;
+			a.x = r.x + padding;
+			a.y = r.y + padding;
+			placed = true;
+		}
+	}
+	if(!placed) {
+		a.page = new_page(page_size, page_size, false);
+		if(a.page == uint32_t(-1))
+			return 0;
+		if(stbrp_pack_rects(&pages[a.page]->context, &r, 1) == 0)
+			return 0;
+		a.x = r.x + padding;
+		a.y = r.y + padding;
+	}
+
+	auto& p = *pages[a.page];
+	p.used_area += int64_t(width) * int64_t(height);
+	{
+		profiler::scoped_zone zone("texture upload");
+		// a dedicated page is exactly the size of its image and clamps at the edges instead
+		if(!p.dedicated)
+			clear_gutter(p.texture_handle, a.x, a.y, width, height, padding);
+		glBindTexture(GL_TEXTURE_2D, p.texture_handle);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, a.x, a.y, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, pixels);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	profiler::count(profiler::counter::bytes_uploaded, int64_t(width) * int64_t(height) * 4);
+
+	uint32_t id = 0;
+	if(!free_ids.empty()) {
+		id = free_ids.back();
+		free_ids.pop_back();
+		allocations[id] = a;
+	} else {
+		id = uint32_t(allocations.size());
+		allocations.push_back(a);
+	}
+	return id;
+}
+
+void texture_atlas::free(uint32_t id) {
+	if(id == 0 || id >= allocations.size() || !allocations[id].in_use)
+		return;
+
+	auto& a = allocations[id];
+	a.in_use = false;
+	free_ids.push_back(id);
+
+	auto index = a.page;
+	auto& p = *pages[index];
+	auto area = int64_t(a.width) * int64_t(a.height);
+	p.used_area -= area;
+	p.freed_area += area;
+
+	if(p.used_area == 0) {
+		if(p.dedicated || index != 0) {
+			release_page(index);
+		} else { // keep one page around rather than recreating it on the next allocation
+			p.freed_area = 0;
+			p.repack_failed_at = -1;
+			stbrp_init_target(&p.context, p.width, p.height, p.nodes.data(), int(p.nodes.size()));
+		}
+	} else if(needs_compaction(p)) {
+		compact_page(index);
+	}
+}
+
+atlas_region texture_atlas::region(uint32_t id) const {
+	if(id == 0 || id >= allocations.size() || !allocations[id].in_use)
+		return atlas_region{ };
+
+	auto& a = allocations[id];
+	auto& p = *pages[a.page];
+	return atlas_region{ p.texture_handle,
+		float(a.x) / float(p.width), float(a.y) / float(p.height),
+		float(a.x + a.width) / float(p.width), float(a.y + a.height) / float(p.height) };
+}
+
+// after a failed repack the same rectangles would fail again, so it waits until another sixteenth of the page has been
+// freed; otherwise every later free on the page would walk all the allocations only to fail
+bool texture_atlas::needs_compaction(page const& p) const {
+	auto page_area = int64_t(p.width) * int64_t(p.height);
+	if(p.repack_failed_at >= 0 && p.used_area > p.repack_failed_at - page_area / 16)
+		return false;
+	return float(p.freed_area) > compaction_threshold * float(page_area);
+}
+
+bool texture_atlas::compact_page(uint32_t index) {
+	auto& p = *pages[index];
+	if(p.dedicated)
+		return false;
+
+	profiler::scoped_zone zone("texture_atlas::compact_page");
+
+	std::vector<stbrp_rect> rects;
+	for(uint32_t i = 1; i < allocations.size(); ++i) {
+		if(allocations[i].in_use && allocations[i].page == index) {
+			stbrp_rect r{ };
+			r.id = int(i);
+			r.w = allocations[i].width + 2 * padding;
+			r.h = allocations[i].height + 2 * padding;
+			rects.push_back(r);
+		}
+	}
+
+	// packing everything at once lets rectpack sort by height, which is what recovers the space
+	// the context points into itself, so it is built in place inside the replacement page
+	auto fresh = std::make_unique<page>();
+	fresh->width = p.width;
+	fresh->height = p.height;
+	fresh->used_area = p.used_area;
+	fresh->nodes.resize(size_t(p.width));
+	stbrp_init_target(&fresh->context, p.width, p.height, fresh->nodes.data(), int(fresh->nodes.size()));
+	if(stbrp_pack_rects(&fresh->context, rects.data(), int(rects.size())) == 0) {
+		p.repack_failed_at = p.used_area;
+		return false;
+	}
+
+	fresh->texture_handle = create_page_texture(p.width, p.height);
+	if(fresh->texture_handle == 0) {
+		p.repack_failed_at = p.used_area;
+		return false;
+	}
+	// the gutters were cleared when their allocations were made, so copying them along keeps the new page clean around each one
+	for(auto& r : rects) {
+		auto& a = allocations[r.id];
+		glCopyImageSubData(p.texture_handle, GL_TEXTURE_2D, 0, a.x - padding, a.y - padding, 0,
+			fresh->texture_handle, GL_TEXTURE_2D, 0, r.x, r.y, 0,
+			r.w, r.h, 1);
+		a.x = r.x + padding;
+		a.y = r.y + padding;
+	}
+	release_page(index);
+	pages[index] = std::move(fresh);
+	return true;
+}
+
+void texture_atlas::compact() {
+	for(uint32_t i = 0; i < pages.size(); ++i) {
+		if(pages[i] && needs_compaction(*pages[i]))
+			compact_page(i);
+	}
+}
+
+void texture_atlas::clear() {
+	for(uint32_t i = 0; i < pages.size(); ++i) {
+		if(pages[i])
+			release_page(i);
+	}
+	pages.clear();
+	release_retired();
+	allocations.clear();
+	allocations.emplace_back();
+	free_ids.clear();
+}
+
+uint32_t texture_atlas::page_count() const {
+	uint32_t total = 0;
+	for(auto& p : pages) {
+		if(p)
+			++total;
+	}
+	return total;
+}
+
+size_t texture_atlas::page_bytes() const {
+	size_t total = 0;
+	for(auto& p : pages) {
+		if(p)
+			total += size_t(p->width) * size_t(p->height) * 4;
+	}
+	return total;
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <memory>
+
+namespace ogl {
+
+// where an allocation currently lives; only valid until the next allocate / free, since freeing can compact a page
+struct atlas_region {
+	uint32_t texture_handle = 0;
+	float u0 = 0.0f;
+	float v0 = 0.0f;
+	float u1 = 1.0f;
+	float v1 = 1.0f;
+};
+
+// packs images into a few large page textures (with imstb_rectpack) so that many of them can share one bind
+// space given back by free is recovered by repacking the page once enough of it is wasted
+class texture_atlas {
+public:
+	struct page;
+	struct allocation {
+		uint32_t page = 0;
+		int32_t x = 0;
+		int32_t y = 0;
+		int32_t width = 0;
+		int32_t height = 0;
+		bool in_use = false;
+	};
+
+	int32_t page_size = 2048;
+	int32_t padding = 1;
+	float compaction_threshold = 0.5f; // fraction of a page lost to frees before it is repacked
+
+	std::vector<std::unique_ptr<page>> pages;
+	std::vector<allocation> allocations; // indexed by allocation id; id 0 is never handed out
+	std::vector<uint32_t> free_ids;
+	std::vector<uint32_t> retired_textures; // textures of released pages, kept until draws queued against them are done
+
+	texture_atlas();
+	texture_atlas(texture_atlas const&) = delete;
+	texture_atlas& operator=(texture_atlas const&) = delete;
+	~texture_atlas();
+
+	// takes premultiplied ARGB in native-endian 32 bit pixels, as plutovg renders them, so no conversion pass is needed
+	// returns 0 if no texture could be created
+	uint32_t allocate(char const* pixels, int32_t width, int32_t height);
+	void free(uint32_t id);
+	atlas_region region(uint32_t id) const;
+	// repacks every page that has lost more than compaction_threshold of its area, except pages whose last repack failed
+	// and that have not freed another sixteenth of their area since
+	void compact();
+	void clear();
+	// deletes the textures of pages released since the last call
+	void release_retired();
+	size_t page_bytes() const;
+	uint32_t page_count() const;
+private:
+	uint32_t new_page(int32_t width, int32_t height, bool dedicated);
+	void release_page(uint32_t index);
+	bool needs_compaction(page const& p) const;
+	bool compact_page(uint32_t index);
+};
+
+}